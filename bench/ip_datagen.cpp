@@ -0,0 +1,145 @@
+/**
+ * @file ip_datagen.cpp
+ * @brief Синтетические журналы для бенчмарков и нагрузочных прогонов
+ */
+
+#include "ip_datagen.h"
+#include "ip_format.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t kNetworks = 64;
+
+/**
+ * @brief splitmix64: один шаг и перемешивание
+ */
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+Distribution parseDistribution(std::string_view name) {
+    if (name == "uniform") return Distribution::Uniform;
+    if (name == "clustered") return Distribution::Clustered;
+    if (name == "zipf") return Distribution::Zipf;
+    throw std::invalid_argument("Неизвестное распределение: " + std::string(name));
+}
+
+// ============================================================================
+// DataGenerator
+// ============================================================================
+
+DataGenerator::DataGenerator(const DataGenOptions& options)
+    : options_(options), state_(options.seed) {
+    if (!(options.duplicateRate >= 0.0 && options.duplicateRate <= 1.0)) {
+        throw std::invalid_argument("Доля повторов должна быть от 0 до 1");
+    }
+    // 2^64 * rate без переполнения: при rate = 1 порог - максимум
+    duplicateThreshold_ = options.duplicateRate >= 1.0
+        ? UINT64_MAX
+        : static_cast<uint64_t>(std::ldexp(options.duplicateRate, 64));
+
+    if (options.distribution == Distribution::Clustered) {
+        // сети стандартного отчета, чтобы фильтры находили совпадения, и случайные
+        networks_.push_back(static_cast<uint16_t>(1u << 8 | (random() & 0xFF)));
+        networks_.push_back(static_cast<uint16_t>(46u << 8 | 70u));
+        while (networks_.size() < kNetworks) {
+            networks_.push_back(static_cast<uint16_t>(random()));
+        }
+    }
+    history_.reserve(static_cast<size_t>(std::min<uint64_t>(options.rows, kHistory)));
+}
+
+uint64_t DataGenerator::random() {
+    return splitmix64(state_);
+}
+
+IpAddress DataGenerator::fresh() {
+    uint64_t r = random();
+    if (options_.distribution == Distribution::Clustered) {
+        uint32_t network = networks_[(r >> 32) % kNetworks];
+        return IpAddress::fromKey(network << 16 | static_cast<uint32_t>(r & 0xFFFF));
+    }
+    return IpAddress::fromKey(static_cast<uint32_t>(r));
+}
+
+/**
+ * @brief Индекс повторяемого адреса в history_
+ *
+ * Для Ципфа ранг r = floor(n^u) при равномерном u из [0, 1): P(r) ~ 1/r,
+ * чаще всего повторяются адреса из начала окна.
+ */
+size_t DataGenerator::pickRepeat() {
+    size_t n = history_.size();
+    uint64_t r = random();
+    if (options_.distribution != Distribution::Zipf) {
+        return static_cast<size_t>(r % n);
+    }
+    double u = static_cast<double>(r >> 11) * 0x1.0p-53;
+    size_t rank = static_cast<size_t>(std::pow(static_cast<double>(n), u));
+    return std::min(rank, n) - 1;
+}
+
+IpAddress DataGenerator::next() {
+    if (!history_.empty() && random() < duplicateThreshold_) {
+        return history_[pickRepeat()];
+    }
+
+    IpAddress ip = fresh();
+    if (history_.size() < kHistory) {
+        history_.push_back(ip);
+    } else {
+        // окно заполнено: первая половина ("горячие" для Ципфа) не меняется
+        size_t half = kHistory / 2;
+        history_[half + static_cast<size_t>(random() % half)] = ip;
+    }
+    return ip;
+}
+
+// ============================================================================
+// ЗАПИСЬ
+// ============================================================================
+
+void generateTsv(const DataGenOptions& options, std::ostream& os) {
+    constexpr size_t kCapacity = size_t{1} << 20;
+    constexpr size_t kMaxRow = kMaxIpTextLength + 1 + 1 + 20 + 1 + 20 + 1;
+
+    DataGenerator generator(options);
+    std::vector<char> buffer(kCapacity);
+    size_t used = 0;
+
+    for (uint64_t row = 0; row < options.rows; ++row) {
+        if (kCapacity - used < kMaxRow) {
+            os.write(buffer.data(), static_cast<std::streamsize>(used));
+            used = 0;
+        }
+        char* out = buffer.data() + used;
+        char* end = buffer.data() + kCapacity;
+
+        out += formatIp(generator.next(), out);
+        uint64_t r = generator.random();
+        *out++ = '\t';
+        out = std::to_chars(out, end, r % 1000).ptr;  // второй столбец: как в test_data, от 0 до 999
+        *out++ = '\t';
+        out = std::to_chars(out, end, (r >> 32) % 10).ptr;
+        *out++ = '\n';
+        used = static_cast<size_t>(out - buffer.data());
+    }
+    os.write(buffer.data(), static_cast<std::streamsize>(used));
+}
+
+std::string generateTsvText(const DataGenOptions& options) {
+    std::ostringstream os;
+    generateTsv(options, os);
+    return os.str();
+}
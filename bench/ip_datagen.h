@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+
+/**
+ * @brief Распределение новых адресов синтетического журнала
+ */
+enum class Distribution {
+    Uniform,    ///< Адреса равномерно по всему пространству IPv4, повторы равновероятны
+    Clustered,  ///< Адреса из 64 сетей /16 (среди них 1.x и 46.70), повторы равновероятны
+    Zipf        ///< Адреса равномерно, повторы по закону Ципфа (s = 1): немного "горячих" адресов
+};
+
+/**
+ * @brief Разбор имени распределения: "uniform", "clustered", "zipf"
+ *
+ * @throws std::invalid_argument если имя неизвестно
+ */
+Distribution parseDistribution(std::string_view name);
+
+/**
+ * @brief Параметры генератора
+ */
+struct DataGenOptions {
+    uint64_t rows = 1000000;      ///< Число строк
+    uint64_t seed = 1;            ///< Зерно: одинаковые параметры дают одинаковый файл
+    double duplicateRate = 0.5;   ///< Доля строк, повторяющих уже выданный адрес (0..1)
+    Distribution distribution = Distribution::Uniform;
+};
+
+/**
+ * @brief Детерминированный генератор строк журнала "ip\tc2\tc3"
+ *
+ * Используется только splitmix64 и целочисленная арифметика (кроме обратной
+ * функции для Ципфа), поэтому вывод не зависит от реализации <random>
+ * и совпадает на всех платформах. Для повторов хранится окно из последних
+ * различных адресов (не больше kHistory), так что память не растет с числом строк.
+ */
+class DataGenerator {
+public:
+    static constexpr size_t kHistory = size_t{1} << 22;
+
+    explicit DataGenerator(const DataGenOptions& options);
+
+    /**
+     * @brief Адрес следующей строки
+     */
+    IpAddress next();
+
+    /**
+     * @brief Псевдослучайное 64-битное число из того же потока
+     */
+    uint64_t random();
+
+private:
+    IpAddress fresh();
+    size_t pickRepeat();
+
+    DataGenOptions options_;
+    uint64_t state_;
+    uint64_t duplicateThreshold_;       ///< duplicateRate в масштабе 2^64
+    std::vector<uint16_t> networks_;    ///< Сети /16 для Distribution::Clustered
+    std::vector<IpAddress> history_;    ///< Выданные различные адреса
+};
+
+/**
+ * @brief Записать options.rows строк журнала в поток
+ */
+void generateTsv(const DataGenOptions& options, std::ostream& os);
+
+/**
+ * @brief То же в строку (для бенчмарков, которым нужен текст в памяти)
+ */
+std::string generateTsvText(const DataGenOptions& options);
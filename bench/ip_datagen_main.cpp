@@ -0,0 +1,120 @@
+/**
+ * @file ip_datagen_main.cpp
+ * @brief ip_filter_datagen: запись синтетического журнала
+ *
+ * Пример:
+ *   ip_filter_datagen --rows 10M --dup-rate 0.3 --dist zipf --seed 7 -o big.tsv
+ */
+
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "ip_datagen.h"
+
+namespace {
+
+std::string_view takeValue(std::string_view arg, int& i, int argc, char* argv[]) {
+    if (i + 1 >= argc) {
+        throw std::invalid_argument("Не указано значение для " + std::string(arg));
+    }
+    return argv[++i];
+}
+
+/**
+ * @brief Число строк с необязательным суффиксом K/M: "10M" -> 10000000
+ */
+uint64_t parseRows(std::string_view value) {
+    uint64_t multiplier = 1;
+    if (!value.empty() && (value.back() == 'K' || value.back() == 'k')) multiplier = 1000;
+    if (!value.empty() && (value.back() == 'M' || value.back() == 'm')) multiplier = 1000000;
+    std::string_view digits = multiplier == 1 ? value : value.substr(0, value.size() - 1);
+
+    uint64_t result = 0;
+    auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), result);
+    if (ec != std::errc() || ptr != digits.data() + digits.size() || digits.empty()) {
+        throw std::invalid_argument("Некорректное число строк: " + std::string(value));
+    }
+    return result * multiplier;
+}
+
+uint64_t parseSeed(std::string_view value) {
+    uint64_t result = 0;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc() || ptr != value.data() + value.size()) {
+        throw std::invalid_argument("Некорректное зерно: " + std::string(value));
+    }
+    return result;
+}
+
+double parseRate(std::string_view value) {
+    std::string text(value);
+    char* end = nullptr;
+    double result = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0') {
+        throw std::invalid_argument("Некорректная доля повторов: " + text);
+    }
+    return result;
+}
+
+void printUsage() {
+    std::cout << "Использование: ip_filter_datagen [опции]\n"
+              << "  --rows N       число строк, допустимы суффиксы K и M (по умолчанию 1M)\n"
+              << "  --seed N       зерно генератора (по умолчанию 1)\n"
+              << "  --dup-rate R   доля строк-повторов от 0 до 1 (по умолчанию 0.5)\n"
+              << "  --dist NAME    uniform, clustered или zipf (по умолчанию uniform)\n"
+              << "  -o FILE        файл вывода (по умолчанию stdout)\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::ios::sync_with_stdio(false);
+
+    try {
+        DataGenOptions options;
+        std::string outputPath;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            if (arg == "--rows") {
+                options.rows = parseRows(takeValue(arg, i, argc, argv));
+            } else if (arg == "--seed") {
+                options.seed = parseSeed(takeValue(arg, i, argc, argv));
+            } else if (arg == "--dup-rate") {
+                options.duplicateRate = parseRate(takeValue(arg, i, argc, argv));
+            } else if (arg == "--dist") {
+                options.distribution = parseDistribution(takeValue(arg, i, argc, argv));
+            } else if (arg == "-o" || arg == "--output") {
+                outputPath = std::string(takeValue(arg, i, argc, argv));
+            } else if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else {
+                throw std::invalid_argument("Неизвестный аргумент: " + std::string(arg));
+            }
+        }
+
+        if (outputPath.empty()) {
+            generateTsv(options, std::cout);
+            std::cout.flush();
+        } else {
+            std::ofstream file(outputPath, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Не удалось открыть файл: " + outputPath);
+            }
+            generateTsv(options, file);
+            if (!file.flush()) {
+                throw std::runtime_error("Ошибка записи: " + outputPath);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Ошибка: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
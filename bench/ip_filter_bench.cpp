@@ -0,0 +1,430 @@
+/**
+ * @file ip_filter_bench.cpp
+ * @brief Микробенчмарки фильтрации
+ *
+ * Цикл countPrefixMatches без ветвлений векторизуется компилятором:
+ * при сборке с -DIP_FILTER_VEC_REPORT=ON GCC печатает "loop vectorized"
+ * для этого цикла (-fopt-info-vec-optimized), а BM_PrefixCount* обрабатывает
+ * адреса в несколько раз быстрее поэлементной проверки через checkOctets.
+ *
+ * Бенчмарки этапов конвейера (разбор, сортировка, фильтры, вывод) работают
+ * на журнале из ip_datagen: тот же текст, что пишет ip_filter_datagen, поэтому
+ * результаты сопоставимы с прогонами на файлах из цели bench_data.
+ */
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "ip_address.h"
+#include "ip_datagen.h"
+#include "ip_filter.h"
+#include "ip_format.h"
+#include "ip_input.h"
+#include "ip_match.h"
+#include "ip_pool.h"
+#include "ip_query.h"
+#include "ip_runs.h"
+#include "ip_sort.h"
+
+namespace {
+
+std::vector<IpAddress> makePool(size_t count) {
+    std::vector<IpAddress> ipPool;
+    ipPool.reserve(count);
+    uint32_t state = 2463534242u;
+    for (size_t i = 0; i < count; ++i) {
+        // xorshift32: детерминированные псевдослучайные адреса
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        ipPool.push_back(IpAddress::fromKey(state));
+    }
+    return ipPool;
+}
+
+/**
+ * @brief Текст журнала на count строк (половина строк - повторы)
+ */
+const std::string& tsvText(size_t count) {
+    static std::string text;
+    static size_t rows = 0;
+    if (rows != count) {
+        DataGenOptions options;
+        options.rows = count;
+        text = generateTsvText(options);
+        rows = count;
+    }
+    return text;
+}
+
+std::vector<std::string_view> splitLines(std::string_view text) {
+    std::vector<std::string_view> lines;
+    while (!text.empty()) {
+        size_t eol = text.find('\n');
+        lines.push_back(text.substr(0, eol));
+        text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+    }
+    return lines;
+}
+
+// ============================================================================
+// ЭТАПЫ КОНВЕЙЕРА
+// ============================================================================
+
+// Первый столбец строки
+void BM_ExtractFirstColumn(benchmark::State& state) {
+    auto lines = splitLines(tsvText(static_cast<size_t>(state.range(0))));
+    for (auto _ : state) {
+        for (auto line : lines) {
+            benchmark::DoNotOptimize(extractFirstColumn(line));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ExtractFirstColumn)->Arg(1 << 20);
+
+// Разбор одного адреса (скалярный путь с проверками)
+void BM_ParseIp(benchmark::State& state) {
+    std::vector<std::string_view> columns;
+    for (auto line : splitLines(tsvText(static_cast<size_t>(state.range(0))))) {
+        columns.push_back(extractFirstColumn(line));
+    }
+    for (auto _ : state) {
+        for (auto column : columns) {
+            benchmark::DoNotOptimize(parseIp(column));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseIp)->Arg(1 << 20);
+
+// Весь текст пакетным разбором, как в main
+void BM_ReadIpAddresses(benchmark::State& state) {
+    const std::string& text = tsvText(static_cast<size_t>(state.range(0)));
+    std::vector<IpAddress> ipPool;
+    for (auto _ : state) {
+        ipPool.clear();
+        readIpAddresses(text, ipPool);
+        benchmark::DoNotOptimize(ipPool.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+}
+BENCHMARK(BM_ReadIpAddresses)->Arg(1 << 20);
+
+// Разбор в новый пул, как при запуске: 0 - std::vector (рост с переносом), 1 - IpPool по размеру текста
+void BM_IngestPool(benchmark::State& state) {
+    const std::string& text = tsvText(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        if (state.range(1) == 0) {
+            std::vector<IpAddress> ipPool;
+            readIpAddresses(text, ipPool);
+            benchmark::DoNotOptimize(ipPool.data());
+        } else {
+            IpPool ipPool(IpPool::maxRowsFor(text.size()));
+            readIpAddresses(text, ipPool);
+            benchmark::DoNotOptimize(ipPool.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+}
+BENCHMARK(BM_IngestPool)->Args({1 << 22, 0})->Args({1 << 22, 1});
+
+// Сортировка из processIpAddresses: 0 - radixSort, 1 - std::sort (эталон)
+void BM_SortPool(benchmark::State& state) {
+    std::vector<IpAddress> source;
+    readIpAddresses(tsvText(static_cast<size_t>(state.range(0))), source);
+    std::vector<IpAddress> ipPool;
+    for (auto _ : state) {
+        state.PauseTiming();
+        ipPool = source;
+        state.ResumeTiming();
+        if (state.range(1) == 0) {
+            radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+        } else {
+            std::sort(ipPool.begin(), ipPool.end());
+        }
+        benchmark::DoNotOptimize(ipPool.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SortPool)->Args({1 << 20, 0})->Args({1 << 20, 1});
+
+// Дописать порцию range(1) адресов к отсортированному пулу range(0):
+// 0 - сортировка порции и слияние (--append, append сервера), 1 - полная пересортировка
+void BM_AppendBatch(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    const auto batch = makePool(static_cast<size_t>(state.range(1)));
+    for (auto _ : state) {
+        if (state.range(2) == 0) {
+            std::vector<IpAddress> sorted = batch;
+            radixSort(sorted.data(), sorted.data() + sorted.size());
+            std::vector<IpAddress> merged = mergeSorted(ipPool, sorted);
+            benchmark::DoNotOptimize(merged.data());
+        } else {
+            std::vector<IpAddress> merged = ipPool;
+            merged.insert(merged.end(), batch.begin(), batch.end());
+            radixSort(merged.data(), merged.data() + merged.size());
+            benchmark::DoNotOptimize(merged.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+BENCHMARK(BM_AppendBatch)->Args({1 << 22, 1 << 14, 0})->Args({1 << 22, 1 << 14, 1});
+
+// Вывод всего пула: 0 - operator<< в поток, 1 - OutputBuffer
+void BM_Output(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    std::ostringstream sink;
+    for (auto _ : state) {
+        sink.str({});
+        if (state.range(1) == 0) {
+            for (const auto& ip : ipPool) {
+                sink << ip << '\n';
+            }
+        } else {
+            OutputBuffer out(sink);
+            for (const auto& ip : ipPool) {
+                out.append(ip);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Output)->Args({1 << 20, 0})->Args({1 << 20, 1});
+
+// Полный filter_any с выводом в память
+void BM_FilterAny(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    std::ostringstream sink;
+    auto old = std::cout.rdbuf(sink.rdbuf());
+    for (auto _ : state) {
+        sink.str({});
+        filter_any(ipPool, 46);
+    }
+    std::cout.rdbuf(old);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FilterAny)->Arg(1 << 20);
+
+// ============================================================================
+// ФИЛЬТРЫ
+// ============================================================================
+
+// Эталон: рекурсивная проверка октетов по одному
+void BM_CheckOctets(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        size_t count = 0;
+        for (const auto& ip : ipPool) {
+            count += checkOctets(ip, 0, 46, 70) ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CheckOctets)->Arg(1 << 20);
+
+// Маска, известная только во время выполнения
+void BM_PrefixCountRuntime(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    int a = 46, b = 70;
+    benchmark::DoNotOptimize(a);
+    benchmark::DoNotOptimize(b);
+    for (auto _ : state) {
+        size_t count = countPrefixMatches(ipPool.data(), ipPool.data() + ipPool.size(), makePrefixMask(a, b));
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PrefixCountRuntime)->Arg(1 << 20);
+
+// Маска-константа времени компиляции
+void BM_PrefixCountConstexpr(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    constexpr PrefixMask prefix = makePrefixMask(46, 70);
+    for (auto _ : state) {
+        size_t count = countPrefixMatches(ipPool.data(), ipPool.data() + ipPool.size(), prefix);
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PrefixCountConstexpr)->Arg(1 << 20);
+
+// Полный filter с выводом в память
+void BM_FilterLiteral(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    std::ostringstream sink;
+    auto old = std::cout.rdbuf(sink.rdbuf());
+    for (auto _ : state) {
+        sink.str({});
+        filter<46>(ipPool);
+    }
+    std::cout.rdbuf(old);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FilterLiteral)->Arg(1 << 20);
+
+// Поэлементная проверка любого октета (как было в filter_any)
+void BM_AnyContains(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        size_t count = 0;
+        for (const auto& ip : ipPool) {
+            count += ip.contains(46) ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AnyContains)->Arg(1 << 20);
+
+// Векторное ядро карты совпадений: 0 - SWAR, 1 - SSE, 2 - AVX2
+void BM_AnyKernel(benchmark::State& state) {
+    auto level = static_cast<SimdLevel>(state.range(1));
+    if (static_cast<int>(level) > static_cast<int>(detectSimdLevel())) {
+        state.SkipWithError("SIMD level is not supported");
+        return;
+    }
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    std::vector<uint64_t> bitmap(bitmapWords(ipPool.size()));
+    for (auto _ : state) {
+        matchAnyOctetWith(level, ipPool.data(), ipPool.size(), 46, bitmap.data());
+        benchmark::DoNotOptimize(bitmap.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AnyKernel)->Args({1 << 20, 0})->Args({1 << 20, 1})->Args({1 << 20, 2});
+
+// ============================================================================
+// ЗАПРОСЫ -q ПРОТИВ ШАБЛОНОВ
+// ============================================================================
+
+// Шаблонный filter<46, 70> с выводом в память - эталон для запросов
+void BM_QueryBaselineTemplate(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    std::ostringstream sink;
+    auto old = std::cout.rdbuf(sink.rdbuf());
+    for (auto _ : state) {
+        sink.str({});
+        filter<46, 70>(ipPool);
+    }
+    std::cout.rdbuf(old);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_QueryBaselineTemplate)->Arg(1 << 20);
+
+// Тот же префикс запросом "o1==46 && o2==70" (склеивается в одну маску)
+void BM_QueryPrefix(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    FilterBatch batch;
+    batch.add(IpPredicate::query("o1==46 && o2==70"));
+    std::ostringstream sink;
+    for (auto _ : state) {
+        sink.str({});
+        batch.run(ipPool, sink);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_QueryPrefix)->Arg(1 << 20);
+
+// Составное условие, написанное вручную и известное при компиляции
+void BM_QueryBaselineCompound(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    std::ostringstream sink;
+    for (auto _ : state) {
+        sink.str({});
+        OutputBuffer out(sink);
+        for (const auto& ip : ipPool) {
+            if (ip.octets[0] == 46 && (ip.octets[1] < 50 || ip.octets[3] >= 250) && !ip.contains(70)) {
+                out.append(ip);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_QueryBaselineCompound)->Arg(1 << 20);
+
+// То же условие байт-кодом QueryProgram
+void BM_QueryCompound(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    FilterBatch batch;
+    batch.add(IpPredicate::query("o1==46 && (o2<50 || o4>=250) && !any==70"));
+    std::ostringstream sink;
+    for (auto _ : state) {
+        sink.str({});
+        batch.run(ipPool, sink);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_QueryCompound)->Arg(1 << 20);
+
+// Ключ IPv4 после перехода на BasicIpAddress<4>: тот же bswap, что и раньше
+void BM_KeyIp4(benchmark::State& state) {
+    auto ipPool = makePool(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (const auto& ip : ipPool) {
+            sum += ip.key();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_KeyIp4)->Arg(1 << 20);
+
+std::vector<Ip6Address> makePool6(size_t count) {
+    std::vector<Ip6Address> ip6Pool;
+    ip6Pool.reserve(count);
+    for (const auto& ip : makePool(count)) {
+        // старшие 32 бита случайные, в младших - редкие ненулевые группы, как у реальных адресов
+        ip6Pool.push_back(Ip6Address::fromKey((Uint128(ip.key()) << 96) | (ip6Pool.size() * 2654435761u)));
+    }
+    return ip6Pool;
+}
+
+// Разбор текстовых адресов IPv6 (с сокращением "::")
+void BM_ParseIp6(benchmark::State& state) {
+    std::vector<std::string> lines;
+    for (const auto& ip : makePool6(static_cast<size_t>(state.range(0)))) {
+        std::ostringstream os;
+        os << ip;
+        lines.push_back(os.str());
+    }
+    for (auto _ : state) {
+        for (const auto& line : lines) {
+            benchmark::DoNotOptimize(parseIp6(line));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseIp6)->Arg(1 << 16);
+
+// Поразрядная сортировка 128-битных ключей
+void BM_SortIp6(benchmark::State& state) {
+    auto source = makePool6(static_cast<size_t>(state.range(0)));
+    std::vector<Ip6Address> ip6Pool;
+    for (auto _ : state) {
+        state.PauseTiming();
+        ip6Pool = source;
+        state.ResumeTiming();
+        radixSort(ip6Pool.data(), ip6Pool.data() + ip6Pool.size());
+        benchmark::DoNotOptimize(ip6Pool.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SortIp6)->Arg(1 << 20);
+
+} // namespace
+
+BENCHMARK_MAIN();
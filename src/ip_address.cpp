@@ -4,55 +4,28 @@
  * 
  * Этот модуль содержит базовые операции для работы с IP-адресами:
  * - Парсинг из строки
- * - Сравнение для сортировки
  * - Проверка условий (для использования в предикатах)
  * - Вывод в поток
  */
 
 #include "ip_address.h"
+#include "ip_format.h"
+#include <algorithm>
+#include <charconv>
 #include <stdexcept>
+#include <string>
 #include <ostream>
 
 // ============================================================================
-// МЕТОДЫ СТРУКТУРЫ IpAddress
+// МЕТОДЫ СТРУКТУРЫ BasicIpAddress
 // ============================================================================
 
-/**
- * @brief Оператор сравнения для сортировки в обратном лексикографическом порядке
- * 
- * ВАЖНО: Это обратное сравнение (по убыванию), а не обычное (по возрастанию).
- * 
- * Логика работы:
- * - Сравниваем октеты слева направо (от первого к четвертому)
- * - Если октеты различаются, возвращаем true, если левый БОЛЬШЕ правого
- * - Это создает сортировку по убыванию: 46.70.1.1 > 1.10.1.1 > 1.2.1.1 > 1.1.1.1
- * 
- * Пример:
- *   IpAddress(1, 10, 1, 1) < IpAddress(1, 2, 1, 1)  // true, т.к. 10 > 2
- *   Результат сортировки: [1.10.1.1, 1.2.1.1, 1.1.1.1]
- * 
- * @param other Другой IP-адрес для сравнения
- * @return true если this должен идти ПЕРЕД other при сортировке (this > other)
- */
-bool IpAddress::operator<(const IpAddress& other) const {
-    // Сравниваем октеты по порядку
-    for (int i = 0; i < 4; ++i) {
-        if (octets[i] != other.octets[i]) {
-            // Обратное сравнение: возвращаем true, если наш октет БОЛЬШЕ
-            // Это создает сортировку по убыванию
-            return octets[i] > other.octets[i];
-        }
-    }
-    // Все октеты равны - адреса одинаковые
-    return false;
-}
-
 /**
  * @brief Проверяет, равен ли октет под указанным индексом заданному значению
  * 
  * Используется в предикатах для проверки конкретных октетов.
  * 
- * @param idx Индекс октета (0-3, где 0 - первый октет)
+ * @param idx Индекс октета (0..N-1, где 0 - первый октет)
  * @param value Значение для сравнения
  * @return true если октет[idx] == value
  * 
@@ -60,14 +33,15 @@ bool IpAddress::operator<(const IpAddress& other) const {
  *   ip.octetEquals(0, 1)  // Проверяет, равен ли первый октет единице
  *   ip.octetEquals(1, 46) // Проверяет, равен ли второй октет 46
  */
-bool IpAddress::octetEquals(int idx, uint8_t value) const {
+template<size_t N>
+bool BasicIpAddress<N>::octetEquals(int idx, uint8_t value) const {
     return octets[idx] == value;
 }
 
 /**
  * @brief Проверяет, содержит ли адрес октет с заданным значением
  * 
- * Проверяет все 4 октета, возвращает true, если хотя бы один равен value.
+ * Проверяет все N октетов, возвращает true, если хотя бы один равен value.
  * Используется для фильтрации адресов, содержащих определенное значение в любом месте.
  * 
  * @param value Значение для поиска
@@ -78,13 +52,17 @@ bool IpAddress::octetEquals(int idx, uint8_t value) const {
  *   IpAddress(46, 70, 1, 1).contains(46)   // true (первый октет = 46)
  *   IpAddress(1, 1, 1, 1).contains(46)     // false
  */
-bool IpAddress::contains(uint8_t value) const {
-    for (int i = 0; i < 4; ++i) {
+template<size_t N>
+bool BasicIpAddress<N>::contains(uint8_t value) const {
+    for (size_t i = 0; i < N; ++i) {
         if (octets[i] == value) return true;
     }
     return false;
 }
 
+template struct BasicIpAddress<4>;
+template struct BasicIpAddress<16>;
+
 // ============================================================================
 // ВСПОМОГАТЕЛЬНЫЕ ФУНКЦИИ
 // ============================================================================
@@ -113,58 +91,185 @@ std::ostream& operator<<(std::ostream& os, const IpAddress& ip) {
     return os;
 }
 
+std::ostream& operator<<(std::ostream& os, const Ip6Address& ip) {
+    char text[kMaxIp6TextLength + 1];
+    return os.write(text, static_cast<std::streamsize>(formatIp6(ip, text)));
+}
+
+const char* describeParseError(IpParseError error) {
+    switch (error) {
+        case IpParseError::None: return "нет ошибки";
+        case IpParseError::Empty: return "пустой адрес";
+        case IpParseError::BadOctet: return "октет не число или больше 255";
+        case IpParseError::MissingDot: return "меньше четырех октетов";
+        case IpParseError::TrailingData: return "лишние символы после адреса";
+    }
+    return "неизвестная ошибка";
+}
+
 /**
- * @brief Парсинг IP-адреса из строки вида "a.b.c.d"
+ * @brief Разбор IP-адреса "a.b.c.d" с кодом ошибки вместо исключения
  * 
- * Упрощенный и эффективный парсинг через string::find вместо stringstream.
+ * Разбор идет указателем прямо по байтам строки, без substr и std::stoi:
+ * октет читает std::from_chars в uint8_t (не больше трех цифр), значение
+ * больше 255 он сам отвергает как result_out_of_range. Ни на корректных,
+ * ни на испорченных данных нет ни одной аллокации и ни одного исключения.
  * Алгоритм:
- * 1. Ищем точки в строке последовательно
- * 2. Извлекаем подстроки между точками
- * 3. Преобразуем каждую подстроку в число (октет)
- * 
- * @param ipStr Строка с IP-адресом в формате "a.b.c.d"
- * @return Структура IpAddress с распарсенными октетами
- * @throws std::invalid_argument если формат строки неверный
+ * 1. Октет - от 1 до 3 цифр, значение не больше 255
+ * 2. После первых трех октетов обязательна точка
+ * 3. После четвертого октета строка должна закончиться
  * 
  * Примеры:
- *   parseIp("192.168.1.1")  -> IpAddress(192, 168, 1, 1)
- *   parseIp("1.2.3")        -> исключение (не хватает октета)
- *   parseIp("1.2.3.4.5")    -> исключение (лишние октеты)
+ *   tryParseIp("192.168.1.1", ip)  -> None, ip = 192.168.1.1
+ *   tryParseIp("1.2.3", ip)        -> MissingDot (не хватает октета)
+ *   tryParseIp("1.2.3.4.5", ip)    -> TrailingData (лишние октеты)
+ *   tryParseIp("1.2.3.256", ip)    -> BadOctet (октет больше 255)
  */
-IpAddress parseIp(const std::string& ipStr) {
+IpParseError tryParseIp(std::string_view ipStr, IpAddress& ip) noexcept {
+    if (ipStr.empty()) return IpParseError::Empty;
+
     uint8_t octets[4];
-    size_t start = 0;  // Позиция начала текущего октета
+    const char* p = ipStr.data();
+    const char* end = p + ipStr.size();
     
-    // Парсим 4 октета
     for (int i = 0; i < 4; ++i) {
-        size_t dotPos = ipStr.find('.', start);
+        // Для первых трех октетов точка-разделитель обязательна
+        if (i > 0) {
+            if (p == end || *p != '.') return IpParseError::MissingDot;
+            ++p;
+        }
         
-        // Для последнего (четвертого) октета точки быть не должно
-        if (i == 3) {
-            // Если нашли точку после четвертого октета - это ошибка
-            if (dotPos != std::string::npos) {
-                throw std::invalid_argument("Неверный формат IP-адреса: " + ipStr);
-            }
-            // Извлекаем последний октет до конца строки
-            std::string part = ipStr.substr(start);
-            octets[i] = static_cast<uint8_t>(std::stoi(part));
+        // Цифры октета: от одной до трех (четвертая цифра - уже не октет)
+        const char* last = end - p > 3 ? p + 3 : end;
+        auto [next, ec] = std::from_chars(p, last, octets[i]);
+        if (ec != std::errc()) return IpParseError::BadOctet;
+        p = next;
+    }
+    
+    // После четвертого октета ничего быть не должно (в т.ч. пятого октета)
+    if (p != end) return IpParseError::TrailingData;
+    
+    ip = IpAddress(octets[0], octets[1], octets[2], octets[3]);
+    return IpParseError::None;
+}
+
+/**
+ * @brief Парсинг IP-адреса из строки вида "a.b.c.d"
+ * 
+ * Для строгих мест (аргументы, диапазоны): ошибка - исключение.
+ * 
+ * @param ipStr Строка с IP-адресом в формате "a.b.c.d"
+ * @return Структура IpAddress с распарсенными октетами
+ * @throws std::invalid_argument если формат строки неверный
+ */
+IpAddress parseIp(std::string_view ipStr) {
+    IpAddress ip(0, 0, 0, 0);
+    if (tryParseIp(ipStr, ip) != IpParseError::None) {
+        throw std::invalid_argument("Неверный формат IP-адреса: " + std::string(ipStr));
+    }
+    return ip;
+}
+
+bool mappedIpv4(const Ip6Address& ip6, IpAddress& ip) {
+    static constexpr uint8_t kMappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+    if (std::memcmp(ip6.octets, kMappedPrefix, sizeof(kMappedPrefix)) != 0) {
+        return false;
+    }
+    ip = IpAddress::fromOctets(ip6.octets + 12);
+    return true;
+}
+
+namespace {
+
+/**
+ * @brief Значение шестнадцатеричной цифры или -1
+ */
+inline int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = static_cast<char>(c | 0x20);  // в нижний регистр
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+} // namespace
+
+/**
+ * @brief Парсинг адреса IPv6 за один проход
+ * 
+ * Группы накапливаются по порядку, позиция "::" запоминается. В конце
+ * группы после "::" сдвигаются в хвост, а пропуск заполняется нулями.
+ * Если за группой следует точка, остаток строки - адрес IPv4 (две последние группы).
+ * 
+ * Примеры:
+ *   parseIp6("2001:db8::1")       -> 2001:0db8:0:0:0:0:0:1
+ *   parseIp6("::ffff:10.0.0.1")   -> 0:0:0:0:0:ffff:0a00:0001
+ *   parseIp6("1:2:3:4:5:6:7")     -> исключение (не хватает группы)
+ *   parseIp6("1::2::3")           -> исключение (два сокращения)
+ */
+Ip6Address parseIp6(std::string_view ipStr) {
+    auto fail = [&]() {
+        return std::invalid_argument("Неверный формат IPv6-адреса: " + std::string(ipStr));
+    };
+
+    uint16_t groups[8] = {};
+    int count = 0;
+    int gap = -1;  // число групп перед "::" (-1 - сокращения нет)
+    const char* p = ipStr.data();
+    const char* end = p + ipStr.size();
+
+    if (end - p >= 2 && p[0] == ':' && p[1] == ':') {
+        gap = 0;
+        p += 2;
+    }
+
+    while (p != end) {
+        const char* start = p;
+        unsigned value = 0;
+        int digits = 0;
+        for (int d; p != end && digits < 5 && (d = hexDigit(*p)) >= 0; ++p, ++digits) {
+            value = value << 4 | static_cast<unsigned>(d);
+        }
+
+        if (p != end && *p == '.') {
+            // IPv4 в последних 32 битах
+            if (count > 6) throw fail();
+            uint32_t v4 = parseIp(std::string_view(start, static_cast<size_t>(end - start))).key();
+            groups[count++] = static_cast<uint16_t>(v4 >> 16);
+            groups[count++] = static_cast<uint16_t>(v4);
+            p = end;
             break;
         }
-        
-        // Для первых трех октетов точка обязательна
-        if (dotPos == std::string::npos) {
-            throw std::invalid_argument("Неверный формат IP-адреса: " + ipStr);
+        if (digits == 0 || digits > 4 || count == 8) throw fail();
+        groups[count++] = static_cast<uint16_t>(value);
+
+        if (p == end) break;
+        if (*p != ':') throw fail();
+        ++p;
+        if (p != end && *p == ':') {
+            if (gap >= 0) throw fail();
+            gap = count;
+            ++p;
+        } else if (p == end) {
+            throw fail();  // одиночное ':' в конце
         }
-        
-        // Извлекаем подстроку от start до точки (не включая точку)
-        std::string part = ipStr.substr(start, dotPos - start);
-        octets[i] = static_cast<uint8_t>(std::stoi(part));
-        
-        // Следующий октет начинается после точки
-        start = dotPos + 1;
     }
-    
-    return IpAddress(octets[0], octets[1], octets[2], octets[3]);
+
+    if (gap < 0 ? count != 8 : count > 7) throw fail();
+
+    uint16_t full[8] = {};
+    if (gap < 0) {
+        std::copy(groups, groups + 8, full);
+    } else {
+        std::copy(groups, groups + gap, full);
+        std::copy(groups + gap, groups + count, full + 8 - (count - gap));
+    }
+
+    uint8_t bytes[16];
+    for (int i = 0; i < 8; ++i) {
+        bytes[2 * i] = static_cast<uint8_t>(full[i] >> 8);
+        bytes[2 * i + 1] = static_cast<uint8_t>(full[i]);
+    }
+    return Ip6Address::fromOctets(bytes);
 }
 
 /**
@@ -174,19 +279,18 @@ IpAddress parseIp(const std::string& ipStr) {
  * Нам нужен только первый столбец (IP-адрес).
  * 
  * @param line Строка с данными, разделенными табуляцией
- * @return Первый столбец (подстрока до первой табуляции или вся строка, если табуляции нет)
+ * @return Первый столбец (представление до первой табуляции или вся строка, если табуляции нет)
  * 
  * Примеры:
  *   extractFirstColumn("192.168.1.1\t111\t0")  -> "192.168.1.1"
  *   extractFirstColumn("192.168.1.1")          -> "192.168.1.1"
  */
-std::string extractFirstColumn(const std::string& line) {
+std::string_view extractFirstColumn(std::string_view line) {
     size_t tabPos = line.find('\t');
-    if (tabPos != std::string::npos) {
-        // Нашли табуляцию - возвращаем подстроку до неё
+    if (tabPos != std::string_view::npos) {
+        // Нашли табуляцию - возвращаем представление до неё
         return line.substr(0, tabPos);
     }
     // Табуляции нет - возвращаем всю строку
     return line;
 }
-
@@ -1,22 +1,112 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iosfwd>
-#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 /**
- * @brief Структура IP-адреса
+ * @brief 128-битное целое без знака (расширение GCC/Clang) - ключ адреса IPv6
  */
-struct IpAddress {
-    uint8_t octets[4];  ///< Октеты адреса
+__extension__ typedef unsigned __int128 Uint128;
 
-    IpAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) 
-        : octets{a, b, c, d} {}
+/**
+ * @brief Тип ключа адреса из N байт: целое без знака той же ширины
+ */
+template<size_t N> struct AddressKey;
+template<> struct AddressKey<4> { using type = uint32_t; };
+template<> struct AddressKey<16> { using type = Uint128; };
+
+/**
+ * @brief Структура IP-адреса из N октетов (4 - IPv4, 16 - IPv6)
+ *
+ * Все операции выражены через ключ - число той же ширины, что и адрес,
+ * с первым октетом в старшем байте. Поэтому правило сортировки
+ * (обратный лексикографический порядок октетов) одно для обеих версий.
+ */
+template<size_t N>
+struct BasicIpAddress {
+    using Key = typename AddressKey<N>::type;
+
+    static constexpr size_t kOctets = N;
+
+    uint8_t octets[N];  ///< Октеты адреса
+
+    /**
+     * @brief Адрес из N значений октетов: IpAddress(192, 168, 1, 1)
+     */
+    template<typename... Args, typename = std::enable_if_t<sizeof...(Args) == N>>
+    BasicIpAddress(Args... args)
+        : octets{static_cast<uint8_t>(args)...} {}
+    
+    /**
+     * @brief Адрес как одно число (big-endian: первый октет - старший байт)
+     * 
+     * Порядок ключей совпадает с лексикографическим порядком октетов,
+     * поэтому сравнение и сортировка сводятся к операциям над целыми.
+     */
+    Key key() const {
+        if constexpr (N == 4) {
+            return (static_cast<uint32_t>(octets[0]) << 24) | (static_cast<uint32_t>(octets[1]) << 16)
+                 | (static_cast<uint32_t>(octets[2]) << 8) | static_cast<uint32_t>(octets[3]);
+        } else {
+            Key k = 0;
+            for (size_t i = 0; i < N; ++i) {
+                k = (k << 8) | octets[i];
+            }
+            return k;
+        }
+    }
+    
+    /**
+     * @brief Октеты, прочитанные как число в порядке байт памяти
+     * 
+     * В отличие от key() не требует перестановки байт, поэтому циклы
+     * сравнения по маске (см. BasicPrefixMask::inMemoryOrder) векторизуются.
+     */
+    Key raw() const {
+        Key value;
+        std::memcpy(&value, octets, sizeof(value));
+        return value;
+    }
+    
+    /**
+     * @brief Восстановление адреса из ключа
+     */
+    static BasicIpAddress fromKey(Key key) {
+        if constexpr (N == 4) {
+            return BasicIpAddress(static_cast<uint8_t>(key >> 24), static_cast<uint8_t>(key >> 16),
+                                  static_cast<uint8_t>(key >> 8), static_cast<uint8_t>(key));
+        } else {
+            BasicIpAddress ip;
+            for (size_t i = N; i-- > 0; key >>= 8) {
+                ip.octets[i] = static_cast<uint8_t>(key);
+            }
+            return ip;
+        }
+    }
+
+    /**
+     * @brief Адрес из массива N октетов
+     */
+    static BasicIpAddress fromOctets(const uint8_t* bytes) {
+        BasicIpAddress ip;
+        std::memcpy(ip.octets, bytes, N);
+        return ip;
+    }
     
     /**
      * @brief Сравнение для сортировки по убыванию (обратный лексикографический порядок)
+     * 
+     * Определено в заголовке, чтобы компаратор встраивался в std::sort:
+     * одно сравнение ключей вместо цикла по октетам.
      */
-    bool operator<(const IpAddress& other) const;
+    bool operator<(const BasicIpAddress& other) const {
+        return key() > other.key();
+    }
     
     /**
      * @brief Проверка, равен ли октет под номером idx значению value
@@ -27,25 +117,182 @@ struct IpAddress {
      * @brief Проверка, содержит ли адрес октет со значением value
      */
     bool contains(uint8_t value) const;
+
+private:
+    BasicIpAddress() = default;  // октеты не инициализированы - только для fromKey/fromOctets
 };
 
+using IpAddress = BasicIpAddress<4>;
+using Ip6Address = BasicIpAddress<16>;
+
+// octetEquals/contains определены в ip_address.cpp для обеих ширин
+extern template struct BasicIpAddress<4>;
+extern template struct BasicIpAddress<16>;
+
+static_assert(sizeof(Ip6Address) == 16, "Ip6Address must be packed into 16 bytes");
+
+// Пул адресов - плотный массив по 4 байта (используется векторными ядрами и снимками)
+static_assert(sizeof(IpAddress) == 4, "IpAddress must be packed into 4 bytes");
+
+/**
+ * @brief Непрерывный массив адресов без владения
+ *
+ * Запросы к пулу принимают IpSpan, поэтому работают одинаково над
+ * std::vector и над адресами снимка, отображенного в память (ip_snapshot.h).
+ */
+class IpSpan {
+public:
+    IpSpan() = default;
+    IpSpan(const IpAddress* data, size_t size) : data_(data), size_(size) {}
+    IpSpan(const std::vector<IpAddress>& pool) : data_(pool.data()), size_(pool.size()) {}  // NOLINT: неявно из пула
+
+    const IpAddress* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const IpAddress* begin() const { return data_; }
+    const IpAddress* end() const { return data_ + size_; }
+    const IpAddress& operator[](size_t i) const { return data_[i]; }
+
+private:
+    const IpAddress* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/**
+ * @brief Префикс октетов как пара маска/значение над BasicIpAddress::key()
+ * 
+ * Проверка адреса сводится к одному AND и одному сравнению.
+ * Пример: префикс 46.70 -> mask = 0xFFFF0000, value = 0x2E460000
+ */
+template<size_t N>
+struct BasicPrefixMask {
+    using Key = typename AddressKey<N>::type;
+
+    Key mask = 0;   ///< Единицы в байтах проверяемых октетов
+    Key value = 0;  ///< Ожидаемые значения этих октетов
+    
+    constexpr bool matches(Key key) const {
+        return (key & mask) == value;
+    }
+    
+    /**
+     * @brief Та же маска для сравнения с BasicIpAddress::raw() (порядок байт памяти)
+     */
+    constexpr BasicPrefixMask inMemoryOrder() const {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return BasicPrefixMask{byteSwap(mask), byteSwap(value)};
+#else
+        return *this;
+#endif
+    }
+    
+    /**
+     * @brief Маска по первым count октетам из массива (для значений, известных во время выполнения)
+     */
+    static constexpr BasicPrefixMask of(const uint8_t* octets, size_t count) {
+        BasicPrefixMask result;
+        for (size_t i = 0; i < count; ++i) {
+            unsigned shift = static_cast<unsigned>(8 * (N - 1 - i));
+            result.mask |= Key{0xFF} << shift;
+            result.value |= static_cast<Key>(octets[i]) << shift;
+        }
+        return result;
+    }
+
+private:
+    static constexpr Key byteSwap(Key x) {
+        if constexpr (N == 4) {
+            return __builtin_bswap32(x);
+        } else {
+            return (static_cast<Key>(__builtin_bswap64(static_cast<uint64_t>(x))) << 64)
+                 | __builtin_bswap64(static_cast<uint64_t>(x >> 64));
+        }
+    }
+};
+
+using PrefixMask = BasicPrefixMask<4>;
+
+/**
+ * @brief Маска префикса из значений первых октетов
+ * 
+ * constexpr: для литералов (filter<46, 70>) маска считается при компиляции.
+ * Ширина адреса N по умолчанию - IPv4: makePrefixMask<16>(0x20, 0x01) - префикс IPv6.
+ */
+template<size_t N = 4, typename... Args>
+constexpr BasicPrefixMask<N> makePrefixMask(Args... args) {
+    static_assert(sizeof...(args) <= N, "Too many arguments for IP address (more than octets in address)");
+    const uint8_t octets[] = {static_cast<uint8_t>(args)..., 0};
+    return BasicPrefixMask<N>::of(octets, sizeof...(args));
+}
+
 /**
  * @brief Вывод IP-адреса в поток
+ * 
+ * Удобен для отладки; массовый вывод идет через OutputBuffer (ip_format.h).
  */
 std::ostream& operator<<(std::ostream& os, const IpAddress& ip);
 
+/**
+ * @brief Вывод адреса IPv6 в каноническом виде (RFC 5952), см. formatIp6
+ */
+std::ostream& operator<<(std::ostream& os, const Ip6Address& ip);
+
+/**
+ * @brief Причина, по которой строка не разобрана как адрес IPv4
+ */
+enum class IpParseError : uint8_t {
+    None,         ///< Адрес корректный
+    Empty,        ///< Пустая строка
+    BadOctet,     ///< Нет цифр октета или октет больше 255
+    MissingDot,   ///< Меньше четырех октетов: нет точки-разделителя
+    TrailingData  ///< Лишние символы после четвертого октета
+};
+
+/**
+ * @brief Текст причины для сообщений: "октет больше 255 или не число", ...
+ */
+const char* describeParseError(IpParseError error);
+
+/**
+ * @brief Разбор адреса "a.b.c.d" без исключений и выделений памяти (в духе std::from_chars)
+ * @param ipStr Строка с адресом
+ * @param ip Результат; при ошибке не меняется
+ * @return IpParseError::None или причина ошибки
+ */
+IpParseError tryParseIp(std::string_view ipStr, IpAddress& ip) noexcept;
+
 /**
  * @brief Парсинг IP-адреса из строки вида "a.b.c.d"
- * @param ipStr Строка с IP-адресом
+ * @param ipStr Строка с IP-адресом (без копирования, разбор по указателям)
  * @return IpAddress
+ * @throws std::invalid_argument если формат неверный (обертка над tryParseIp)
+ */
+IpAddress parseIp(std::string_view ipStr);
+
+/**
+ * @brief Парсинг адреса IPv6
+ *
+ * Поддерживаются 8 групп по 1-4 шестнадцатеричные цифры (регистр не важен),
+ * сокращение "::" (один раз) и IPv4 в последних 32 битах ("::ffff:1.2.3.4").
+ *
+ * @param ipStr Строка с адресом
+ * @return Ip6Address
  * @throws std::invalid_argument если формат неверный
  */
-IpAddress parseIp(const std::string& ipStr);
+Ip6Address parseIp6(std::string_view ipStr);
+
+/**
+ * @brief Адрес IPv4, отображенный в IPv6: ::ffff:a.b.c.d (RFC 4291, 2.5.5.2)
+ * @param ip6 Адрес IPv6
+ * @param ip Вложенный адрес IPv4, если ip6 - отображенный
+ * @return true если ip6 - отображенный адрес IPv4
+ */
+bool mappedIpv4(const Ip6Address& ip6, IpAddress& ip);
 
 /**
  * @brief Извлечение первого столбца из строки (разделенной табуляцией)
  * @param line Строка с данными
- * @return Первый столбец до табуляции
+ * @return Первый столбец до табуляции (представление внутри line, без копирования)
  */
-std::string extractFirstColumn(const std::string& line);
+std::string_view extractFirstColumn(std::string_view line);
 
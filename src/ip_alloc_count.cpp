@@ -0,0 +1,44 @@
+/**
+ * @file ip_alloc_count.cpp
+ * @brief Замена глобального operator new для подсчета выделений в --stats
+ *
+ * Собирается только в исполняемый файл ip_filter: библиотека не навязывает
+ * замену распределителя программам, которые ее подключают.
+ */
+
+#include "ip_stats.h"
+#include <cstdlib>
+#include <new>
+
+// Пока сбор не включен - одна загрузка флага внутри countAllocation.
+// Варианты nothrow и new[] в libstdc++ вызывают этот же operator new(size_t).
+void* operator new(std::size_t size) {
+    countAllocation(size);
+    if (size == 0) size = 1;
+    for (;;) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
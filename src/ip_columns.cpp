@@ -0,0 +1,260 @@
+/**
+ * @file ip_columns.cpp
+ * @brief Числовые столбцы строк: разбор в параллельные массивы, условия и свертка по адресу
+ */
+
+#include "ip_columns.h"
+#include "ip_format.h"
+#include "ip_invalid.h"
+#include "ip_sort.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+std::invalid_argument badCondition(std::string_view text) {
+    return std::invalid_argument("Некорректное условие на столбец: " + std::string(text));
+}
+
+/**
+ * @brief Целое число со знаком целиком из строки
+ */
+bool parseInt(std::string_view text, int64_t& value) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    if (first != last && *first == '+') ++first;  // from_chars не принимает '+'
+    auto [ptr, ec] = std::from_chars(first, last, value);
+    return ec == std::errc() && ptr == last && first != last;
+}
+
+/**
+ * @brief Перестановка массива по order: result[i] = values[order[i]]
+ */
+template<typename T>
+void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+    std::vector<T> result(values.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        result[i] = values[order[i]];
+    }
+    values.swap(result);
+}
+
+} // namespace
+
+// ============================================================================
+// УСЛОВИЯ
+// ============================================================================
+
+unsigned parseColumnName(std::string_view text) {
+    unsigned number = 0;
+    if (text.size() < 2 || (text[0] != 'c' && text[0] != 'C')) {
+        throw std::invalid_argument("Некорректный номер столбца: " + std::string(text));
+    }
+    auto [ptr, ec] = std::from_chars(text.data() + 1, text.data() + text.size(), number);
+    if (ec != std::errc() || ptr != text.data() + text.size() || number < 2) {
+        throw std::invalid_argument("Некорректный номер столбца: " + std::string(text));
+    }
+    return number;
+}
+
+/**
+ * @brief "c2>1000" -> {2, Greater, 1000}
+ *
+ * Оператор ищется по первому символу из "<>=!", двухсимвольные операторы
+ * проверяются раньше односимвольных.
+ */
+ColumnPredicate parseColumnPredicate(std::string_view text) {
+    size_t pos = text.find_first_of("<>=!");
+    if (pos == std::string_view::npos) {
+        throw badCondition(text);
+    }
+
+    static constexpr std::pair<std::string_view, ColumnPredicate::Op> kOps[] = {
+        {"<=", ColumnPredicate::Op::LessEqual}, {">=", ColumnPredicate::Op::GreaterEqual},
+        {"==", ColumnPredicate::Op::Equal},     {"!=", ColumnPredicate::Op::NotEqual},
+        {"<", ColumnPredicate::Op::Less},       {">", ColumnPredicate::Op::Greater},
+        {"=", ColumnPredicate::Op::Equal},
+    };
+
+    std::string_view rest = text.substr(pos);
+    for (const auto& [symbol, op] : kOps) {
+        if (rest.substr(0, symbol.size()) != symbol) continue;
+
+        ColumnPredicate predicate;
+        predicate.column = parseColumnName(text.substr(0, pos));
+        predicate.op = op;
+        if (!parseInt(rest.substr(symbol.size()), predicate.value)) {
+            throw badCondition(text);
+        }
+        return predicate;
+    }
+    throw badCondition(text);
+}
+
+// ============================================================================
+// ColumnTable
+// ============================================================================
+
+ColumnTable::ColumnTable(std::vector<unsigned> columns) : numbers_(std::move(columns)) {
+    std::sort(numbers_.begin(), numbers_.end());
+    numbers_.erase(std::unique(numbers_.begin(), numbers_.end()), numbers_.end());
+    columns_.resize(numbers_.size());
+}
+
+size_t ColumnTable::slotOf(unsigned number) const {
+    auto it = std::lower_bound(numbers_.begin(), numbers_.end(), number);
+    if (it == numbers_.end() || *it != number) {
+        throw std::invalid_argument("Столбец c" + std::to_string(number) + " не загружен");
+    }
+    return static_cast<size_t>(it - numbers_.begin());
+}
+
+const std::vector<int64_t>& ColumnTable::column(unsigned number) const {
+    return columns_[slotOf(number)];
+}
+
+/**
+ * @brief Разбор строк по указателям: адрес, затем поля до последнего нужного столбца
+ *
+ * С --skip-invalid (InvalidLines::active) строка с некорректным адресом или
+ * столбцом пропускается целиком: уже добавленные поля этой строки снимаются.
+ */
+void ColumnTable::parse(std::string_view data) {
+    InvalidLines* invalid = InvalidLines::active();
+    const char* p = data.data();
+    const char* end = p + data.size();
+
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        std::string_view line(p, static_cast<size_t>((eol ? eol : end) - p));
+        p = eol ? eol + 1 : end;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+
+        const std::string_view fullLine = line;
+        size_t tab = line.find('\t');
+        IpAddress ip(0, 0, 0, 0);
+        IpParseError error = tryParseIp(line.substr(0, tab), ip);
+        if (error != IpParseError::None) {
+            if (invalid == nullptr) {
+                throw std::invalid_argument("Неверный формат IP-адреса: " + std::string(line.substr(0, tab)));
+            }
+            invalid->add(fullLine, describeParseError(error));
+            continue;
+        }
+
+        // Столбцы строки; при пропуске строки снимаются уже добавленные поля [0, slot)
+        auto skip = [&](size_t slot) {
+            for (size_t k = 0; k < slot; ++k) columns_[k].pop_back();
+            invalid->add(fullLine, "некорректный столбец");
+        };
+
+        unsigned number = 1;
+        bool rejected = false;
+        for (size_t slot = 0; slot < numbers_.size(); ++slot) {
+            // переходим к полю numbers_[slot]
+            while (number < numbers_[slot] && tab != std::string_view::npos) {
+                line.remove_prefix(tab + 1);
+                tab = line.find('\t');
+                ++number;
+            }
+            if (number < numbers_[slot]) {
+                if (invalid == nullptr) {
+                    throw std::invalid_argument("Нет столбца c" + std::to_string(numbers_[slot])
+                                                + " в строке: " + std::string(fullLine));
+                }
+                skip(slot);
+                rejected = true;
+                break;
+            }
+            std::string_view field = line.substr(0, tab);
+
+            int64_t value = 0;
+            if (!parseInt(field, value)) {
+                if (invalid == nullptr) {
+                    throw std::invalid_argument("Некорректное значение столбца c" + std::to_string(numbers_[slot])
+                                                + ": " + std::string(field));
+                }
+                skip(slot);
+                rejected = true;
+                break;
+            }
+            columns_[slot].push_back(value);
+        }
+        if (!rejected) addresses_.push_back(ip);
+    }
+}
+
+void ColumnTable::filter(const std::vector<ColumnPredicate>& predicates) {
+    // номера слотов заранее, чтобы в цикле по строкам не искать столбцы
+    std::vector<size_t> slots;
+    for (const auto& predicate : predicates) {
+        slots.push_back(slotOf(predicate.column));
+    }
+
+    size_t kept = 0;
+    for (size_t row = 0; row < addresses_.size(); ++row) {
+        bool pass = true;
+        for (size_t i = 0; i < predicates.size() && pass; ++i) {
+            pass = predicates[i].matches(columns_[slots[i]][row]);
+        }
+        if (!pass) continue;
+
+        addresses_[kept] = addresses_[row];
+        for (auto& column : columns_) {
+            column[kept] = column[row];
+        }
+        ++kept;
+    }
+
+    addresses_.resize(kept, IpAddress(0, 0, 0, 0));
+    for (auto& column : columns_) {
+        column.resize(kept);
+    }
+}
+
+void ColumnTable::sortByAddress() {
+    std::vector<uint32_t> order = radixSortOrder(addresses_.data(), addresses_.size());
+
+    // у IpAddress нет конструктора по умолчанию - адреса собираются через reserve/push_back
+    std::vector<IpAddress> sorted;
+    sorted.reserve(addresses_.size());
+    for (uint32_t row : order) {
+        sorted.push_back(addresses_[row]);
+    }
+    addresses_.swap(sorted);
+    for (auto& column : columns_) {
+        permute(column, order);
+    }
+}
+
+// ============================================================================
+// СВЕРТКА ПО АДРЕСУ
+// ============================================================================
+
+ColumnAggregate aggregateByAddress(const ColumnTable& sorted, unsigned sumColumn) {
+    ColumnAggregate result;
+    const auto& addresses = sorted.addresses();
+    const std::vector<int64_t>* values = sumColumn != 0 ? &sorted.column(sumColumn) : nullptr;
+
+    for (size_t row = 0; row < addresses.size(); ++row) {
+        bool same = !result.addresses.empty() && result.addresses.back().key() == addresses[row].key();
+        if (!same) {
+            result.addresses.push_back(addresses[row]);
+            result.counts.push_back(0);
+            if (values != nullptr) result.sums.push_back(0);
+        }
+        ++result.counts.back();
+        if (values != nullptr && __builtin_add_overflow(result.sums.back(), (*values)[row], &result.sums.back())) {
+            char text[16];
+            std::string address(text, formatIp(addresses[row], text));
+            throw std::runtime_error("сумма столбца c" + std::to_string(sumColumn)
+                                     + " для адреса " + address + " выходит за int64");
+        }
+    }
+    return result;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+
+/**
+ * @brief Условие на числовой столбец строки: "c2>1000"
+ *
+ * Столбцы нумеруются как в файле: 1 - адрес, 2 и дальше - числовые.
+ */
+struct ColumnPredicate {
+    enum class Op { Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual };
+
+    unsigned column = 2;  ///< Номер столбца (от 2)
+    Op op = Op::Equal;
+    int64_t value = 0;
+
+    bool matches(int64_t x) const {
+        switch (op) {
+            case Op::Less: return x < value;
+            case Op::LessEqual: return x <= value;
+            case Op::Greater: return x > value;
+            case Op::GreaterEqual: return x >= value;
+            case Op::Equal: return x == value;
+            case Op::NotEqual: return x != value;
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief Разбор условия "cN OP VALUE", OP - один из < <= > >= = == !=
+ *
+ * @throws std::invalid_argument если условие некорректно
+ */
+ColumnPredicate parseColumnPredicate(std::string_view text);
+
+/**
+ * @brief Разбор номера столбца "cN" (N >= 2)
+ *
+ * @throws std::invalid_argument если номер некорректен
+ */
+unsigned parseColumnName(std::string_view text);
+
+/**
+ * @brief Адреса вместе с числовыми столбцами строк
+ *
+ * Разбираются только нужные столбцы, каждый - в отдельный плотный массив
+ * int64_t, параллельный массиву адресов (строка i - addresses()[i] и column(c)[i]).
+ * Строки целиком не копируются. Путь "только адреса" (parseIpBatch)
+ * этой структурой не пользуется и не замедляется.
+ */
+class ColumnTable {
+public:
+    /**
+     * @param columns Номера нужных столбцов (от 2, в любом порядке, повторы допустимы)
+     */
+    explicit ColumnTable(std::vector<unsigned> columns);
+
+    /**
+     * @brief Добавить строки данных: "ip\tc2\tc3..."
+     *
+     * Пустые строки пропускаются. Столбцы после последнего нужного не просматриваются.
+     * С --skip-invalid (InvalidLines::active) некорректная строка пропускается целиком.
+     *
+     * @throws std::invalid_argument если адрес некорректен, нужного столбца нет
+     *         или он не является целым числом (в строгом режиме)
+     */
+    void parse(std::string_view data);
+
+    size_t size() const { return addresses_.size(); }
+
+    const std::vector<IpAddress>& addresses() const { return addresses_; }
+
+    /**
+     * @brief Значения столбца number для всех строк
+     * @throws std::invalid_argument если столбец не был запрошен в конструкторе
+     */
+    const std::vector<int64_t>& column(unsigned number) const;
+
+    /**
+     * @brief Оставить только строки, удовлетворяющие всем условиям
+     *
+     * Уплотнение на месте: один проход, без дополнительной памяти.
+     */
+    void filter(const std::vector<ColumnPredicate>& predicates);
+
+    /**
+     * @brief Переставить строки в порядок пула (IpAddress::operator<), устойчиво
+     */
+    void sortByAddress();
+
+private:
+    size_t slotOf(unsigned number) const;
+
+    std::vector<unsigned> numbers_;               ///< Номера загружаемых столбцов, по возрастанию
+    std::vector<IpAddress> addresses_;
+    std::vector<std::vector<int64_t>> columns_;  ///< columns_[k] - столбец numbers_[k]
+};
+
+/**
+ * @brief Итоги по адресу: число строк и сумма столбца
+ */
+struct ColumnAggregate {
+    std::vector<IpAddress> addresses;  ///< Различные адреса в порядке пула
+    std::vector<uint64_t> counts;      ///< Число строк с адресом
+    std::vector<int64_t> sums;         ///< Сумма столбца по строкам адреса (пусто, если столбец не задан)
+};
+
+/**
+ * @brief Свертка отсортированной таблицы по адресу
+ *
+ * Строки с одинаковым адресом после sortByAddress() идут подряд,
+ * поэтому достаточно одного линейного прохода.
+ *
+ * @param sorted Таблица после sortByAddress()
+ * @param sumColumn Столбец для суммирования (0 - только счетчики)
+ * @throws std::runtime_error если сумма по адресу не помещается в int64_t
+ */
+ColumnAggregate aggregateByAddress(const ColumnTable& sorted, unsigned sumColumn);
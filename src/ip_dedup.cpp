@@ -0,0 +1,164 @@
+/**
+ * @file ip_dedup.cpp
+ * @brief Подсчет различных адресов: хеш-таблица с открытой адресацией и битовая карта IPv4
+ */
+
+#include "ip_dedup.h"
+#include "ip_sort.h"
+#include <new>
+
+namespace {
+
+// Больше различных адресов без счетчиков - битовая карта (512 МиБ) компактнее таблицы
+constexpr size_t kBitmapThreshold = size_t{1} << 24;
+
+// Ключей во всем пространстве IPv4: больше ячеек таблице не нужно
+constexpr size_t kKeySpace = size_t{1} << 32;
+
+// Слов битовой карты на все пространство IPv4
+constexpr size_t kBitmapWords = kKeySpace / 64;
+
+/**
+ * @brief Хеш Фибоначчи: старшие биты произведения на 2^32 / phi
+ */
+inline size_t hashKey(uint32_t key, unsigned shift) {
+    return static_cast<size_t>((key * 0x9E3779B1u) >> shift);
+}
+
+} // namespace
+
+AddressCounter::AddressCounter(bool keepCounts, size_t expectedDistinct)
+    : keepCounts_(keepCounts) {
+    // емкость - степень двойки, заполнение не больше половины
+    size_t capacity = 16;
+    while (capacity < expectedDistinct * 2 && capacity < kKeySpace) {
+        capacity *= 2;
+    }
+    rehash(capacity);
+}
+
+/**
+ * @brief Ячейка с ключом key или первая пустая ячейка на пути пробирования
+ */
+size_t AddressCounter::findSlot(uint32_t key) const {
+    size_t mask = keys_.size() - 1;
+    size_t slot = hashKey(key, shift_);
+    while (counts_[slot] != 0 && keys_[slot] != key) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void AddressCounter::add(const IpAddress& ip) {
+    uint32_t key = ip.key();
+
+    if (bitmap_) {
+        uint64_t& word = bitmap_.get()[key >> 6];
+        uint64_t bit = uint64_t{1} << (key & 63);
+        size_ += (word & bit) == 0;
+        word |= bit;
+        return;
+    }
+
+    size_t slot = findSlot(key);
+    if (counts_[slot] != 0) {
+        ++counts_[slot];
+        return;
+    }
+
+    keys_[slot] = key;
+    counts_[slot] = 1;
+    ++size_;
+
+    if (!keepCounts_ && size_ > kBitmapThreshold) {
+        switchToBitmap();
+    } else if (size_ * 2 > keys_.size() && keys_.size() < kKeySpace) {
+        // в 2^32 ячеек помещаются все ключи: пробирование всегда найдет свой ключ,
+        // а больше 32 бит хеша (shift_) не бывает
+        rehash(keys_.size() * 2);
+    }
+}
+
+uint64_t AddressCounter::count(const IpAddress& ip) const {
+    uint32_t key = ip.key();
+    if (bitmap_) {
+        return (bitmap_.get()[key >> 6] >> (key & 63)) & 1;
+    }
+    return counts_[findSlot(key)];
+}
+
+/**
+ * @brief Перенос в таблицу новой емкости (степень двойки)
+ */
+void AddressCounter::rehash(size_t newCapacity) {
+    std::vector<uint32_t> oldKeys(newCapacity);
+    std::vector<uint64_t> oldCounts(newCapacity, 0);
+    oldKeys.swap(keys_);
+    oldCounts.swap(counts_);
+
+    unsigned bits = 0;
+    while ((size_t{1} << bits) < newCapacity) ++bits;
+    shift_ = 32 - bits;
+
+    for (size_t i = 0; i < oldKeys.size(); ++i) {
+        if (oldCounts[i] != 0) {
+            size_t slot = findSlot(oldKeys[i]);
+            keys_[slot] = oldKeys[i];
+            counts_[slot] = oldCounts[i];
+        }
+    }
+}
+
+/**
+ * @brief Переход на битовую карту всего пространства IPv4
+ *
+ * calloc большого блока дает нулевые страницы от ядра, физическая память
+ * выделяется только под реально затронутые участки.
+ */
+void AddressCounter::switchToBitmap() {
+    bitmap_.reset(static_cast<uint64_t*>(std::calloc(kBitmapWords, sizeof(uint64_t))));
+    if (!bitmap_) {
+        throw std::bad_alloc();
+    }
+    for (size_t i = 0; i < keys_.size(); ++i) {
+        if (counts_[i] != 0) {
+            bitmap_.get()[keys_[i] >> 6] |= uint64_t{1} << (keys_[i] & 63);
+        }
+    }
+    std::vector<uint32_t>().swap(keys_);
+    std::vector<uint64_t>().swap(counts_);
+}
+
+/**
+ * @brief Различные адреса по убыванию ключа
+ *
+ * Битовая карта обходится от старших слов к младшим - порядок получается сразу;
+ * ключи из таблицы сортируются поразрядно.
+ */
+std::vector<IpAddress> AddressCounter::sortedAddresses() const {
+    std::vector<IpAddress> result;
+    result.reserve(size_);
+
+    if (bitmap_) {
+        const uint64_t* words = bitmap_.get();
+        for (size_t w = kBitmapWords; w-- > 0;) {
+            for (uint64_t word = words[w]; word != 0;) {
+                unsigned bit = 63 - static_cast<unsigned>(__builtin_clzll(word));
+                result.push_back(IpAddress::fromKey(static_cast<uint32_t>(w * 64 + bit)));
+                word &= ~(uint64_t{1} << bit);
+            }
+        }
+        return result;
+    }
+
+    std::vector<uint32_t> keys;
+    keys.reserve(size_);
+    for (size_t i = 0; i < keys_.size(); ++i) {
+        if (counts_[i] != 0) keys.push_back(keys_[i]);
+    }
+    radixSortKeysDescending(keys.data(), keys.size());
+    for (uint32_t key : keys) {
+        result.push_back(IpAddress::fromKey(key));
+    }
+    return result;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "ip_address.h"
+
+/**
+ * @brief Схлопывание повторов адресов при чтении
+ *
+ * Плоская хеш-таблица с открытой адресацией (линейное пробирование) по
+ * 32-битному ключу адреса: ключи и счетчики в двух плотных массивах,
+ * пустая ячейка - нулевой счетчик. Если счетчики не нужны (только уникальные
+ * адреса) и различных адресов становится очень много, таблица заменяется
+ * битовой картой на все пространство IPv4 (2^32 бит = 512 МиБ, страницы
+ * выделяются лениво).
+ */
+class AddressCounter {
+public:
+    /**
+     * @param keepCounts Нужны ли счетчики вхождений (иначе допускается битовая карта)
+     * @param expectedDistinct Ожидаемое число различных адресов
+     */
+    explicit AddressCounter(bool keepCounts, size_t expectedDistinct = 1u << 16);
+
+    /**
+     * @brief Учесть одно вхождение адреса
+     */
+    void add(const IpAddress& ip);
+
+    /**
+     * @brief Учесть вхождения всех адресов массива
+     */
+    void add(const IpAddress* first, const IpAddress* last) {
+        for (; first != last; ++first) add(*first);
+    }
+
+    /**
+     * @brief Число различных адресов
+     */
+    size_t distinct() const { return size_; }
+
+    /**
+     * @brief Используется ли битовая карта вместо хеш-таблицы
+     */
+    bool usesBitmap() const { return bitmap_ != nullptr; }
+
+    /**
+     * @brief Число вхождений адреса (0 - не встречался; в режиме битовой карты - 0 или 1)
+     */
+    uint64_t count(const IpAddress& ip) const;
+
+    /**
+     * @brief Различные адреса в порядке IpAddress::operator< (по убыванию)
+     */
+    std::vector<IpAddress> sortedAddresses() const;
+
+private:
+    struct FreeDeleter {
+        void operator()(uint64_t* p) const { std::free(p); }
+    };
+
+    size_t findSlot(uint32_t key) const;
+    void rehash(size_t newCapacity);
+    void switchToBitmap();
+
+    bool keepCounts_;
+    std::vector<uint32_t> keys_;    ///< Ключи IpAddress::key()
+    std::vector<uint64_t> counts_;  ///< Счетчики, 0 - ячейка пуста
+    size_t size_ = 0;               ///< Число различных адресов
+    unsigned shift_ = 0;            ///< 32 - log2(емкость), для хеша Фибоначчи
+    std::unique_ptr<uint64_t, FreeDeleter> bitmap_;  ///< Битовая карта 2^32 бит
+};
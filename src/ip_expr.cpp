@@ -0,0 +1,507 @@
+/**
+ * @file ip_expr.cpp
+ * @brief Язык запросов -q: разбор, компиляция в байт-код и выполнение над кусками пула
+ */
+
+#include "ip_expr.h"
+#include "ip_match.h"
+#include "ip_range.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+using Instruction = QueryProgram::Instruction;
+using Op = Instruction::Op;
+using Code = std::vector<Instruction>;
+
+// Стек карт в matches() - биты одного uint64_t
+constexpr size_t kMaxDepth = 64;
+
+enum class Compare { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+// ============================================================================
+// ПОСТРОЕНИЕ КОДА С УПРОЩЕНИЯМИ
+// ============================================================================
+
+Code constant(bool value) {
+    Instruction ins;
+    ins.op = Op::Const;
+    ins.value = value ? 1 : 0;
+    return {ins};
+}
+
+bool isConst(const Code& code, bool value) {
+    return code.size() == 1 && code[0].op == Op::Const && (code[0].value != 0) == value;
+}
+
+bool isMask(const Code& code) {
+    return code.size() == 1 && code[0].op == Op::Mask;
+}
+
+Code makeNot(Code code) {
+    if (code.size() == 1 && code[0].op == Op::Const) {
+        return constant(code[0].value == 0);
+    }
+    if (code.back().op == Op::Not) {
+        code.pop_back();  // !!x -> x
+        return code;
+    }
+    Instruction ins;
+    ins.op = Op::Not;
+    code.push_back(ins);
+    return code;
+}
+
+Code makeBinary(Op op, Code left, Code right) {
+    bool absorbing = op == Op::Or;  // x || true = true, x && false = false
+    if (isConst(left, absorbing) || isConst(right, absorbing)) return constant(absorbing);
+    if (isConst(left, !absorbing)) return right;
+    if (isConst(right, !absorbing)) return left;
+
+    left.insert(left.end(), right.begin(), right.end());
+    Instruction ins;
+    ins.op = op;
+    left.push_back(ins);
+    return left;
+}
+
+/**
+ * @brief Конъюнкция: все равенства октетов склеиваются в одну маску, затем остальное через And
+ */
+Code makeConjunction(std::vector<Code> terms) {
+    Instruction merged;
+    merged.op = Op::Mask;
+    bool hasMask = false;
+    std::vector<Code> rest;
+
+    for (auto& term : terms) {
+        if (!isMask(term)) {
+            rest.push_back(std::move(term));
+            continue;
+        }
+        const Instruction& mask = term[0];
+        if (((merged.value ^ mask.value) & merged.mask & mask.mask) != 0) {
+            return constant(false);  // o1==1 && o1==2
+        }
+        merged.mask |= mask.mask;
+        merged.value |= mask.value;
+        hasMask = true;
+    }
+
+    // маска - самая дешевая проверка, она идет первой
+    Code result = hasMask ? Code{merged} : constant(true);
+    for (auto& term : rest) {
+        result = makeBinary(Op::And, std::move(result), std::move(term));
+    }
+    return result;
+}
+
+/**
+ * @brief (key & mask) в [first, last]; first и last - уже под маской
+ */
+Code maskedRange(uint32_t mask, uint32_t first, uint32_t last) {
+    if (first == 0 && last == mask) return constant(true);
+    Instruction ins;
+    ins.op = Op::Range;
+    ins.mask = mask;
+    ins.first = first;
+    ins.last = last;
+    return {ins};
+}
+
+Code keyRange(uint32_t first, uint32_t last) {
+    return maskedRange(UINT32_MAX, first, last);
+}
+
+Code octetCompare(unsigned octet, Compare compare, unsigned value) {
+    const unsigned shift = 24 - 8 * octet;
+    const uint32_t mask = 0xFFu << shift;
+    switch (compare) {
+        case Compare::Equal:
+        case Compare::NotEqual: {
+            Instruction ins;
+            ins.op = Op::Mask;
+            ins.mask = mask;
+            ins.value = value << shift;
+            return compare == Compare::Equal ? Code{ins} : makeNot(Code{ins});
+        }
+        case Compare::Less:
+            return value == 0 ? constant(false) : maskedRange(mask, 0, (value - 1) << shift);
+        case Compare::LessEqual:
+            return maskedRange(mask, 0, value << shift);
+        case Compare::Greater:
+            return value == 255 ? constant(false) : maskedRange(mask, (value + 1) << shift, mask);
+        case Compare::GreaterEqual:
+            return maskedRange(mask, value << shift, mask);
+    }
+    return constant(false);
+}
+
+Code keyCompare(Compare compare, uint32_t key) {
+    switch (compare) {
+        case Compare::Equal: return keyRange(key, key);
+        case Compare::NotEqual: return makeNot(keyRange(key, key));
+        case Compare::Less: return key == 0 ? constant(false) : keyRange(0, key - 1);
+        case Compare::LessEqual: return keyRange(0, key);
+        case Compare::Greater: return key == UINT32_MAX ? constant(false) : keyRange(key + 1, UINT32_MAX);
+        case Compare::GreaterEqual: return keyRange(key, UINT32_MAX);
+    }
+    return constant(false);
+}
+
+// ============================================================================
+// РАЗБОР
+// ============================================================================
+
+/**
+ * @brief Рекурсивный спуск; каждая функция сразу возвращает код своего подвыражения
+ */
+class Parser {
+public:
+    explicit Parser(std::string_view text) : text_(text) {}
+
+    Code parse() {
+        Code code = parseOr();
+        skipSpaces();
+        if (pos_ != text_.size()) {
+            throw error("лишний текст");
+        }
+        return code;
+    }
+
+private:
+    Code parseOr() {
+        Code code = parseAnd();
+        while (accept("||")) {
+            code = makeBinary(Op::Or, std::move(code), parseAnd());
+        }
+        return code;
+    }
+
+    Code parseAnd() {
+        std::vector<Code> terms;
+        terms.push_back(parseUnary());
+        while (accept("&&")) {
+            terms.push_back(parseUnary());
+        }
+        return terms.size() == 1 ? std::move(terms[0]) : makeConjunction(std::move(terms));
+    }
+
+    Code parseUnary() {
+        // '!' и '(' - рекурсия; без предела длинная строка из них переполнила бы стек
+        if (accept("!")) {
+            Nesting nesting(*this);
+            return makeNot(parseUnary());
+        }
+        if (accept("(")) {
+            Nesting nesting(*this);
+            Code code = parseOr();
+            if (!accept(")")) {
+                throw error("ожидается ')'");
+            }
+            return code;
+        }
+        return parseAtom();
+    }
+
+    Code parseAtom() {
+        skipSpaces();
+        size_t start = pos_;
+        std::string_view name = word();
+        if (name.empty()) {
+            throw error("ожидается условие");
+        }
+
+        if (name.size() == 2 && (name[0] == 'o' || name[0] == 'O') && name[1] >= '1' && name[1] <= '4') {
+            Compare compare = comparison();
+            return octetCompare(static_cast<unsigned>(name[1] - '1'), compare, number(255));
+        }
+        if (name == "any") {
+            Compare compare = comparison();
+            if (compare != Compare::Equal && compare != Compare::NotEqual) {
+                throw error("для any допустимы только == и !=");
+            }
+            Instruction ins;
+            ins.op = Op::Any;
+            ins.byte = static_cast<uint8_t>(number(255));
+            return compare == Compare::Equal ? Code{ins} : makeNot(Code{ins});
+        }
+        if (name == "ip") {
+            Compare compare = comparison();
+            return keyCompare(compare, address<uint32_t>([](std::string_view s) { return parseIp(s).key(); }));
+        }
+        if (name == "cidr") {
+            AddressRange range = address<AddressRange>(parseCidr);
+            return keyRange(range.first, range.last);
+        }
+        if (name == "range") {
+            AddressRange range = address<AddressRange>(parseRange);
+            return keyRange(range.first, range.last);
+        }
+        if (name == "all") {
+            return constant(true);
+        }
+        pos_ = start;
+        throw error("неизвестное условие '" + std::string(name) + "'");
+    }
+
+    Compare comparison() {
+        static constexpr std::pair<std::string_view, Compare> kOps[] = {
+            {"==", Compare::Equal}, {"!=", Compare::NotEqual}, {"<=", Compare::LessEqual},
+            {">=", Compare::GreaterEqual}, {"<", Compare::Less}, {">", Compare::Greater},
+        };
+        for (const auto& [symbol, compare] : kOps) {
+            if (accept(symbol)) return compare;
+        }
+        throw error("ожидается оператор сравнения");
+    }
+
+    unsigned number(unsigned max) {
+        skipSpaces();
+        std::string_view digits = word();
+        unsigned value = 0;
+        auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        if (digits.empty() || ec != std::errc() || ptr != digits.data() + digits.size() || value > max) {
+            throw error("ожидается число от 0 до " + std::to_string(max));
+        }
+        return value;
+    }
+
+    /**
+     * @brief Адрес, CIDR или диапазон: слово разбирается функцией из ip_range/ip_address
+     */
+    template<typename T, typename Parse>
+    T address(Parse parse) {
+        skipSpaces();
+        size_t start = pos_;
+        std::string_view spec = word();
+        try {
+            return parse(spec);
+        } catch (const std::invalid_argument& e) {
+            pos_ = start;
+            throw error(e.what());
+        }
+    }
+
+    void skipSpaces() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) ++pos_;
+    }
+
+    bool accept(std::string_view token) {
+        skipSpaces();
+        if (text_.substr(pos_, token.size()) != token) return false;
+        // "!" не должен съедать начало "!="
+        if (token == "!" && text_.substr(pos_, 2) == "!=") return false;
+        pos_ += token.size();
+        return true;
+    }
+
+    /**
+     * @brief Слово: буквы, цифры и символы адресов (". / -")
+     */
+    std::string_view word() {
+        size_t start = pos_;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '/' && c != '-') break;
+            ++pos_;
+        }
+        return text_.substr(start, pos_ - start);
+    }
+
+    std::invalid_argument error(const std::string& what) const {
+        return std::invalid_argument("Некорректный запрос \"" + std::string(text_) + "\" (позиция "
+                                     + std::to_string(pos_ + 1) + "): " + what);
+    }
+
+    /**
+     * @brief Уровень вложенности '!' и '(' на время разбора подвыражения
+     */
+    class Nesting {
+    public:
+        explicit Nesting(Parser& parser) : parser_(parser) {
+            if (++parser_.depth_ > kMaxDepth) {
+                throw parser_.error("слишком глубокая вложенность");
+            }
+        }
+        ~Nesting() { --parser_.depth_; }
+
+        Nesting(const Nesting&) = delete;
+        Nesting& operator=(const Nesting&) = delete;
+
+    private:
+        Parser& parser_;
+    };
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    size_t depth_ = 0;
+};
+
+// ============================================================================
+// ЛИСТЬЯ НАД КУСКОМ
+// ============================================================================
+
+uint64_t tailMask(size_t count) {
+    return count % 64 == 0 ? ~uint64_t{0} : (uint64_t{1} << (count % 64)) - 1;
+}
+
+// ============================================================================
+// ГРАНИЦЫ
+// ============================================================================
+
+/**
+ * @brief Начало операнда, который заканчивается перед end (постфиксная запись)
+ */
+size_t operandStart(const Code& code, size_t end) {
+    size_t need = 1;
+    while (need > 0) {
+        switch (code[--end].op) {
+            case Op::And: case Op::Or: ++need; break;
+            case Op::Not: break;
+            default: --need; break;
+        }
+    }
+    return end;
+}
+
+/**
+ * @brief Маска из старших единиц: условие на нее - диапазон ключей
+ */
+bool leadingMask(uint32_t mask) {
+    uint32_t low = ~mask;
+    return (low & (low + 1)) == 0;
+}
+
+/**
+ * @brief Диапазон ключей, вне которого подвыражение [begin, end) ложно
+ *
+ * && - пересечение границ операндов, || - объемлющий диапазон, остальное
+ * (any, младшие октеты, отрицание) границ не дает.
+ */
+AddressRange boundsOf(const Code& code, size_t begin, size_t end) {
+    const Instruction& ins = code[end - 1];
+    switch (ins.op) {
+        case Op::Mask:
+            if (leadingMask(ins.mask)) return {ins.value, ins.value | ~ins.mask};
+            break;
+        case Op::Range:
+            if (leadingMask(ins.mask)) return {ins.first, ins.last | ~ins.mask};
+            break;
+        case Op::Const:
+            if (ins.value == 0) return {UINT32_MAX, 0};
+            break;
+        case Op::And:
+        case Op::Or: {
+            size_t split = operandStart(code, end - 1);
+            AddressRange left = boundsOf(code, begin, split);
+            AddressRange right = boundsOf(code, split, end - 1);
+            if (ins.op == Op::And) return {std::max(left.first, right.first), std::min(left.last, right.last)};
+            if (left.first > left.last) return right;
+            if (right.first > right.last) return left;
+            return {std::min(left.first, right.first), std::max(left.last, right.last)};
+        }
+        default:
+            break;
+    }
+    return {0, UINT32_MAX};
+}
+
+} // namespace
+
+// ============================================================================
+// QueryProgram
+// ============================================================================
+
+QueryProgram QueryProgram::compile(std::string_view text) {
+    QueryProgram program;
+    program.source_ = std::string(text);
+    program.code_ = Parser(text).parse();
+
+    size_t depth = 0;
+    for (const auto& ins : program.code_) {
+        switch (ins.op) {
+            case Op::And: case Op::Or: --depth; break;
+            case Op::Not: break;
+            default: program.depth_ = std::max(program.depth_, ++depth); break;
+        }
+    }
+    if (program.depth_ > kMaxDepth) {
+        throw std::invalid_argument("Слишком сложный запрос: " + program.source_);
+    }
+    program.bounds_ = boundsOf(program.code_, 0, program.code_.size());
+    return program;
+}
+
+void QueryProgram::match(const IpAddress* first, size_t count, uint64_t* bitmap,
+                         std::vector<uint64_t>& scratch) const {
+    const size_t words = bitmapWords(count);
+    if (scratch.size() < depth_ * words) {
+        scratch.resize(depth_ * words);
+    }
+    // нижняя карта стека - сразу результат, остальные - в scratch
+    auto slot = [&](size_t i) { return i == 0 ? bitmap : scratch.data() + (i - 1) * words; };
+
+    size_t sp = 0;
+    for (const auto& ins : code_) {
+        switch (ins.op) {
+            case Op::Mask:
+                matchPrefix(first, count, PrefixMask{ins.mask, ins.value}, slot(sp++));
+                break;
+            case Op::Any:
+                matchAnyOctet(first, count, ins.byte, slot(sp++));
+                break;
+            case Op::Range:
+                matchKeyRange(first, count, ins.mask, ins.first, ins.last, slot(sp++));
+                break;
+            case Op::Const: {
+                uint64_t* dst = slot(sp++);
+                std::fill(dst, dst + words, ins.value != 0 ? ~uint64_t{0} : 0);
+                if (words > 0) dst[words - 1] &= tailMask(count);
+                break;
+            }
+            case Op::And: {
+                --sp;
+                uint64_t* dst = slot(sp - 1);
+                const uint64_t* src = slot(sp);
+                for (size_t w = 0; w < words; ++w) dst[w] &= src[w];
+                break;
+            }
+            case Op::Or: {
+                --sp;
+                uint64_t* dst = slot(sp - 1);
+                const uint64_t* src = slot(sp);
+                for (size_t w = 0; w < words; ++w) dst[w] |= src[w];
+                break;
+            }
+            case Op::Not: {
+                uint64_t* dst = slot(sp - 1);
+                for (size_t w = 0; w < words; ++w) dst[w] = ~dst[w];
+                if (words > 0) dst[words - 1] &= tailMask(count);
+                break;
+            }
+        }
+    }
+}
+
+bool QueryProgram::matches(const IpAddress& ip) const {
+    uint64_t stack = 0;  // вершина - младший бит
+    for (const auto& ins : code_) {
+        bool bit = false;
+        switch (ins.op) {
+            case Op::Mask: bit = (ip.key() & ins.mask) == ins.value; break;
+            case Op::Any: bit = ip.contains(ins.byte); break;
+            case Op::Range: bit = (ip.key() & ins.mask) - ins.first <= ins.last - ins.first; break;
+            case Op::Const: bit = ins.value != 0; break;
+            case Op::And: stack = (stack >> 1) & (stack | ~uint64_t{1}); continue;
+            case Op::Or: stack = (stack >> 1) | (stack & 1); continue;
+            case Op::Not: stack ^= 1; continue;
+        }
+        stack = stack << 1 | static_cast<uint64_t>(bit);
+    }
+    return (stack & 1) != 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+#include "ip_range.h"
+
+/**
+ * @brief Выражение запроса (-q), скомпилированное в байт-код над битовыми картами
+ *
+ * Язык:
+ *   expr  := and ('||' and)*
+ *   and   := unary ('&&' unary)*
+ *   unary := '!' unary | '(' expr ')' | atom
+ *   atom  := oN OP NUM            N = 1..4, OP - одно из == != < <= > >=
+ *          | any == NUM | any != NUM
+ *          | ip OP A.B.C.D
+ *          | cidr A.B.C.D/LEN | range A.B.C.D-E.F.G.H
+ *          | all
+ *
+ * Примеры: "o1==46 && o2==70", "any==46", "cidr 10.0.0.0/8 && !(o4==0 || o4==255)".
+ *
+ * Программа - постфиксная последовательность инструкций. Интерпретатор
+ * выполняет ее не для каждого адреса, а для куска пула: лист заполняет
+ * битовую карту куска тем же векторным ядром, что и FilterBatch (matchPrefix,
+ * matchAnyOctet) или простым циклом сравнения, а &&, ||, ! работают с картами
+ * по 64 адреса за операцию. Стоимость разбора инструкции делится на весь кусок.
+ *
+ * При компиляции равенства октетов внутри одного && склеиваются в одну маску
+ * ("o1==46 && o2==70" - одна инструкция Mask, как префикс --filter 46.70).
+ * Из условий на старшие октеты и адрес выводятся границы bounds(): на
+ * отсортированном пуле выражение вычисляется только для строк этого диапазона.
+ */
+class QueryProgram {
+public:
+    /**
+     * @brief Инструкция байт-кода
+     *
+     * Сравнения октетов и адреса - одна инструкция Range над ключом: o2 в [a, b]
+     * - это (key & 0x00FF0000) в [a << 16, b << 16], ip в [x, y] - маска 0xFFFFFFFF.
+     */
+    struct Instruction {
+        enum class Op : uint8_t {
+            Mask,        ///< (key & mask) == value
+            Any,         ///< хотя бы один октет равен byte
+            Range,       ///< (key & mask) в [first, last]
+            Const,       ///< все адреса (value != 0) или ни одного
+            And,         ///< две верхние карты -> их пересечение
+            Or,          ///< две верхние карты -> объединение
+            Not          ///< верхняя карта -> дополнение
+        };
+
+        Op op = Op::Const;
+        uint8_t byte = 0;
+        uint32_t mask = 0;
+        uint32_t value = 0;
+        uint32_t first = 0;
+        uint32_t last = 0;
+    };
+
+    /**
+     * @brief Разбор и компиляция выражения
+     *
+     * @throws std::invalid_argument с позицией ошибки, если выражение некорректно
+     */
+    static QueryProgram compile(std::string_view text);
+
+    const std::vector<Instruction>& code() const { return code_; }
+
+    /**
+     * @brief Исходный текст выражения
+     */
+    const std::string& source() const { return source_; }
+
+    /**
+     * @brief Диапазон адресов, вне которого выражение ложно
+     *
+     * Для "o1==46 && ..." - 46.0.0.0-46.255.255.255; если ограничений нет -
+     * весь диапазон адресов. Пустой диапазон (first > last) - выражение ложно всегда.
+     */
+    const AddressRange& bounds() const { return bounds_; }
+
+    /**
+     * @brief Сужают ли границы диапазон адресов
+     */
+    bool bounded() const { return bounds_.first != 0 || bounds_.last != UINT32_MAX; }
+
+    /**
+     * @brief Карта совпадений куска адресов
+     *
+     * @param first Начало куска
+     * @param count Количество адресов
+     * @param bitmap Карта из (count + 63) / 64 слов
+     * @param scratch Рабочая память для стека карт (переиспользуется между вызовами)
+     */
+    void match(const IpAddress* first, size_t count, uint64_t* bitmap, std::vector<uint64_t>& scratch) const;
+
+    /**
+     * @brief Проверка одного адреса (потоковый режим и слияние внешней сортировки)
+     */
+    bool matches(const IpAddress& ip) const;
+
+private:
+    std::vector<Instruction> code_;
+    size_t depth_ = 0;  ///< Наибольшая глубина стека карт
+    AddressRange bounds_{0, UINT32_MAX};
+    std::string source_;
+};
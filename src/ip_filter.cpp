@@ -4,8 +4,18 @@
  */
 
 #include "ip_filter.h"
+#include "ip_match.h"
+#include "ip_query.h"
+#include "ip_sort.h"
 #include <algorithm>
 
+namespace {
+
+// Кусок пула для векторной проверки: 16 КиБ адресов помещаются в L1
+constexpr size_t kMatchChunk = 4096;
+
+} // namespace
+
 // ============================================================================
 // ФИЛЬТРАЦИЯ ПО ЛЮБОМУ ОКТЕТУ
 // ============================================================================
@@ -13,19 +23,48 @@
 /**
  * @brief Фильтрация адресов, содержащих указанное значение в любом октете
  * 
- * проверяет октеты адреса, возвращает true, если хотя бы один равен
+ * Пул проверяется кусками по kMatchChunk адресов векторным ядром matchAnyOctet
+ * (8 адресов за инструкцию на AVX2), карта совпадений куска сразу выводится.
  * 
  * @param ipPool Вектор IP-адресов для фильтрации
  * @param value Значение для поиска в любом из октетов
  */
 void filter_any(const std::vector<IpAddress>& ipPool, uint8_t value) {
+    OutputBuffer out(std::cout);
+    uint64_t bitmap[bitmapWords(kMatchChunk)];
+    for (size_t offset = 0; offset < ipPool.size(); offset += kMatchChunk) {
+        size_t count = std::min(kMatchChunk, ipPool.size() - offset);
+        matchAnyOctet(ipPool.data() + offset, count, value, bitmap);
+        out.appendSelected(ipPool.data() + offset, bitmap, count);
+    }
+}
+
+/**
+ * @brief Фильтрация IPv6 по значению в любом октете (поэлементная проверка)
+ */
+void filter_any(const std::vector<Ip6Address>& ipPool, uint8_t value) {
+    OutputBuffer out(std::cout);
     for (const auto& ip : ipPool) {
         if (ip.contains(value)) {
-            std::cout << ip << '\n';
+            out.append(ip);
         }
     }
 }
 
+/**
+ * @brief Фильтрация по индексу: адреса, содержащие значение в любом октете
+ * 
+ * @param index индекс по отсортированному пулу
+ * @param value Значение для поиска в любом из октетов
+ */
+void filter_any(const IpIndex& index, uint8_t value) {
+    IpSpan ipPool = index.pool();
+    OutputBuffer out(std::cout);
+    for (uint32_t row : index.any(value)) {
+        out.append(ipPool[row]);
+    }
+}
+
 // ============================================================================
 // ОСНОВНАЯ ОБРАБОТКА
 // ============================================================================
@@ -35,7 +74,7 @@ void filter_any(const std::vector<IpAddress>& ipPool, uint8_t value) {
  * 
  * Алгоритм:
  * 1. Проверяем, что пул не пуст
- * 2. Сортируем адреса в обратном лексикографическом
+ * 2. Сортируем адреса в обратном лексикографическом (поразрядно, по 32-битным ключам)
  * 3. Выводим адреса
  * 4. Применяем фильтры по заданию:
  *    - filter(ipPool, 1)
@@ -50,13 +89,33 @@ void processIpAddresses(std::vector<IpAddress>& ipPool) {
         return;
     }
     
-    std::sort(ipPool.begin(), ipPool.end());
-    
-    for (const auto& ip : ipPool) {
-        std::cout << ip << '\n';
-    }
-    
-    filter(ipPool, 1);
-    filter(ipPool, 46, 70);
-    filter_any(ipPool, 46);
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    reportIpAddresses(ipPool);
+}
+
+/**
+ * @brief Вывод отсортированного пула и результатов фильтров
+ * 
+ * Отделено от сортировки, чтобы пул, отсортированный в несколько потоков,
+ * выводился тем же кодом. Все секции вычисляются пакетом FilterBatch
+ * за один проход по пулу.
+ * 
+ * @param ipPool Отсортированный вектор IP-адресов
+ */
+void reportIpAddresses(const std::vector<IpAddress>& ipPool) {
+    standardReport().run(ipPool, std::cout);
+}
+
+/**
+ * @brief Секции отчета из задания: полный вывод и три фильтра
+ * 
+ * @return Пакет фильтров для FilterBatch::run
+ */
+FilterBatch standardReport() {
+    FilterBatch batch;
+    batch.add(IpPredicate::all());
+    batch.add(IpPredicate::prefix(1));
+    batch.add(IpPredicate::prefix(46, 70));
+    batch.add(IpPredicate::any(46));
+    return batch;
 }
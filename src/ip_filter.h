@@ -3,6 +3,9 @@
 #include <vector>
 #include <iostream>
 #include "ip_address.h"
+#include "ip_format.h"
+#include "ip_index.h"
+#include "ip_query.h"
 
 // ============================================================================
 // ВСПОМОГАТЕЛЬНАЯ ФУНКЦИЯ ДЛЯ ПРОВЕРКИ ОКТЕТОВ
@@ -19,8 +22,8 @@
  * @param rest variadic
  * @return boolean (1 если все октеты соответствуют значениям, 0 в противном случае)
  */
-template<typename First, typename... Rest>
-bool checkOctets(const IpAddress& ip, int idx, First first, Rest... rest) {
+template<size_t N, typename First, typename... Rest>
+bool checkOctets(const BasicIpAddress<N>& ip, int idx, First first, Rest... rest) {
     // текущий октет
     if (!ip.octetEquals(idx, static_cast<uint8_t>(first))) {
         // не совпадает с заданным значением
@@ -45,8 +48,8 @@ bool checkOctets(const IpAddress& ip, int idx, First first, Rest... rest) {
  * @return true 
  * @return false 
  */
-template<typename First>
-bool checkOctets(const IpAddress& ip, int idx, First first) {
+template<size_t N, typename First>
+bool checkOctets(const BasicIpAddress<N>& ip, int idx, First first) {
     return ip.octetEquals(idx, static_cast<uint8_t>(first));
 }
 
@@ -58,23 +61,93 @@ bool checkOctets(const IpAddress& ip, int idx, First first) {
  * @brief Универсальная функция фильтрации адресов через variadic template
  * 
  * Фильтрует адреса, у которых октеты на указанных позициях равны заданным значениям.
+ * Значения один раз сворачиваются в маску/значение над адресом как целым
+ * числом (в порядке байт памяти), проверка адреса - один AND и одно сравнение
+ * (вместо рекурсии checkOctets). Работает для IPv4 и IPv6:
+ * filter(ip6Pool, 0x20, 0x01) - адреса 2001::/16.
 
  * @param ipPool вектор адресов для фильтрации (отсортированный)
  * @param args variadic-параметры -- значения для проверки по позициям
  */
-template<typename... Args>
-void filter(const std::vector<IpAddress>& ipPool, Args... args) {
-    // для проверки нужно не более 4 и не менее1 
-    static_assert(sizeof...(args) <= 4, "Too many arguments for IP address (max 4 octets)");
+template<size_t N, typename... Args>
+void filter(const std::vector<BasicIpAddress<N>>& ipPool, Args... args) {
+    // для проверки нужно не более N и не менее 1
+    static_assert(sizeof...(args) <= N, "Too many arguments for IP address (more than octets in address)");
     static_assert(sizeof...(args) > 0, "At least one argument required");
     
+    const BasicPrefixMask<N> prefix = makePrefixMask<N>(args...).inMemoryOrder();
+    OutputBuffer out(std::cout);
+    for (const auto& ip : ipPool) {
+        if (prefix.matches(ip.raw())) {
+            out.append(ip);
+        }
+    }
+}
+
+/**
+ * @brief Количество адресов с префиксом (без ветвлений, цикл векторизуется компилятором)
+ * 
+ * @param first начало массива адресов
+ * @param last конец массива адресов
+ * @param prefix маска/значение префикса (над key())
+ * @return число совпадений
+ */
+template<size_t N>
+size_t countPrefixMatches(const BasicIpAddress<N>* first, const BasicIpAddress<N>* last, BasicPrefixMask<N> prefix) {
+    const BasicPrefixMask<N> native = prefix.inMemoryOrder();
+    size_t count = 0;
+    for (const BasicIpAddress<N>* ip = first; ip != last; ++ip) {
+        count += native.matches(ip->raw()) ? 1 : 0;
+    }
+    return count;
+}
+
+/**
+ * @brief Фильтрация по литеральному префиксу, известному при компиляции
+ * 
+ * filter<46, 70>(ipPool) - маска и значение вычисляются компилятором
+ * и попадают в код константами.
+ * 
+ * @tparam Octets значения первых октетов (1-4 значения в диапазоне 0-255)
+ * @param ipPool вектор адресов для фильтрации
+ */
+template<int... Octets>
+void filter(const std::vector<IpAddress>& ipPool) {
+    static_assert(sizeof...(Octets) <= 4, "Too many arguments for IP address (max 4 octets)");
+    static_assert(sizeof...(Octets) > 0, "At least one argument required");
+    static_assert(((Octets >= 0 && Octets <= 255) && ...), "Octet value must be in range 0-255");
+    
+    constexpr PrefixMask prefix = makePrefixMask(Octets...).inMemoryOrder();
+    OutputBuffer out(std::cout);
     for (const auto& ip : ipPool) {
-        if (checkOctets(ip, 0, args...)) {
-            std::cout << ip << '\n';
+        if (prefix.matches(ip.raw())) {
+            out.append(ip);
         }
     }
 }
 
+/**
+ * @brief Фильтрация по индексу отсортированного пула
+ * 
+ * То же, что filter(ipPool, args...), но адреса с нужным префиксом
+ * находятся бинарным поиском: O(log n + k) вместо полного прохода.
+ * 
+ * @param index индекс по отсортированному пулу
+ * @param args variadic-параметры -- значения первых октетов
+ */
+template<typename... Args>
+void filter(const IpIndex& index, Args... args) {
+    static_assert(sizeof...(args) <= 4, "Too many arguments for IP address (max 4 octets)");
+    static_assert(sizeof...(args) > 0, "At least one argument required");
+    
+    RowRange range = index.prefix(args...);
+    IpSpan ipPool = index.pool();
+    OutputBuffer out(std::cout);
+    for (size_t row = range.first; row < range.last; ++row) {
+        out.append(ipPool[row]);
+    }
+}
+
 /**
  * @brief Фильтрация адресов, содержащих значение в any октете
  * 
@@ -85,6 +158,38 @@ void filter(const std::vector<IpAddress>& ipPool, Args... args) {
  */
 void filter_any(const std::vector<IpAddress>& ipPool, uint8_t value);
 
+/**
+ * @brief То же для IPv6: адреса, содержащие значение в любом из 16 октетов
+ */
+void filter_any(const std::vector<Ip6Address>& ipPool, uint8_t value);
+
+/**
+ * @brief Фильтрация по индексу: адреса, содержащие значение в любом октете
+ * 
+ * Использует списки строк индекса, O(k) после построения индекса.
+ * 
+ * @param index индекс по отсортированному пулу
+ * @param value Значение для поиска в любом из 4 октетов
+ */
+void filter_any(const IpIndex& index, uint8_t value);
+
+/**
+ * @brief Секции отчета из задания как пакет фильтров
+ * 
+ * Все адреса, затем filter(1), filter(46, 70), filter_any(46).
+ */
+FilterBatch standardReport();
+
+/**
+ * @brief Вывод отчета по уже отсортированному пулу
+ * 
+ * Выводит все адреса, затем результаты фильтров из задания
+ * (см. processIpAddresses).
+ * 
+ * @param ipPool Отсортированный вектор IP-адресов
+ */
+void reportIpAddresses(const std::vector<IpAddress>& ipPool);
+
 /**
  * @brief Обработка адресов: сортировка и применение фильтров по таску из homework
  * 
@@ -0,0 +1,180 @@
+/**
+ * @file ip_format.cpp
+ * @brief Быстрое форматирование адресов без iostream на каждый октет
+ */
+
+#include "ip_format.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <ostream>
+
+namespace {
+
+/**
+ * @brief Текст октета: до 3 цифр (дополнено до 4 байт) и длина
+ */
+struct OctetText {
+    char text[4];
+    uint8_t length;
+};
+
+/**
+ * @brief Таблица "значение октета -> текст" на все 256 значений
+ */
+struct OctetTable {
+    OctetText entries[256];
+
+    OctetTable() {
+        for (int v = 0; v < 256; ++v) {
+            OctetText& e = entries[v];
+            std::memset(e.text, 0, sizeof(e.text));
+            if (v >= 100) {
+                e.text[0] = static_cast<char>('0' + v / 100);
+                e.text[1] = static_cast<char>('0' + v / 10 % 10);
+                e.text[2] = static_cast<char>('0' + v % 10);
+                e.length = 3;
+            } else if (v >= 10) {
+                e.text[0] = static_cast<char>('0' + v / 10);
+                e.text[1] = static_cast<char>('0' + v % 10);
+                e.length = 2;
+            } else {
+                e.text[0] = static_cast<char>('0' + v);
+                e.length = 1;
+            }
+        }
+    }
+};
+
+const OctetTable kOctets;
+
+} // namespace
+
+/**
+ * @brief Адрес в текст: 4 копирования по 4 байта из таблицы и 3 точки
+ */
+size_t formatIp(const IpAddress& ip, char* out) {
+    char* p = out;
+    for (int i = 0; i < 4; ++i) {
+        const OctetText& e = kOctets.entries[ip.octets[i]];
+        std::memcpy(p, e.text, 4);
+        p += e.length;
+        if (i < 3) *p++ = '.';
+    }
+    return static_cast<size_t>(p - out);
+}
+
+/**
+ * @brief Адрес IPv6 в текст: поиск серии нулевых групп, затем группы без ведущих нулей
+ *
+ * Отображенный адрес IPv4 пишется со вложенным адресом через точки (RFC 5952, 5).
+ */
+size_t formatIp6(const Ip6Address& ip, char* out) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    static constexpr char kMapped[] = "::ffff:";
+
+    IpAddress v4(0, 0, 0, 0);
+    if (mappedIpv4(ip, v4)) {
+        std::memcpy(out, kMapped, sizeof(kMapped) - 1);
+        return sizeof(kMapped) - 1 + formatIp(v4, out + sizeof(kMapped) - 1);
+    }
+
+    unsigned groups[8];
+    for (int i = 0; i < 8; ++i) {
+        groups[i] = static_cast<unsigned>(ip.octets[2 * i]) << 8 | ip.octets[2 * i + 1];
+    }
+
+    // самая длинная серия нулевых групп (не короче двух)
+    int bestStart = -1, bestLength = 1;
+    for (int i = 0; i < 8;) {
+        if (groups[i] != 0) { ++i; continue; }
+        int j = i;
+        while (j < 8 && groups[j] == 0) ++j;
+        if (j - i > bestLength) {
+            bestStart = i;
+            bestLength = j - i;
+        }
+        i = j;
+    }
+
+    char* p = out;
+    for (int i = 0; i < 8; ++i) {
+        if (i == bestStart) {
+            *p++ = ':';
+            *p++ = ':';
+            i += bestLength - 1;
+            continue;
+        }
+        if (i > 0 && i != bestStart + bestLength) *p++ = ':';
+        unsigned g = groups[i];
+        int shift = g >= 0x1000 ? 12 : g >= 0x100 ? 8 : g >= 0x10 ? 4 : 0;
+        for (; shift >= 0; shift -= 4) {
+            *p++ = kHex[(g >> shift) & 0xF];
+        }
+    }
+    return static_cast<size_t>(p - out);
+}
+
+// ============================================================================
+// OutputBuffer
+// ============================================================================
+
+OutputBuffer::OutputBuffer(std::ostream& os, size_t capacity)
+    : os_(os), buffer_(std::max(capacity, kSlack)) {}
+
+OutputBuffer::~OutputBuffer() {
+    flush();
+}
+
+void OutputBuffer::appendCounted(const IpAddress& ip, uint64_t count) {
+    // адрес, табуляция, до 20 цифр счетчика и перевод строки
+    if (buffer_.size() - used_ < kSlack + 22) flush();
+    char* p = buffer_.data() + used_;
+    p += formatIp(ip, p);
+    *p++ = '\t';
+    p = std::to_chars(p, p + 20, count).ptr;
+    *p++ = '\n';
+    used_ = static_cast<size_t>(p - buffer_.data());
+}
+
+void OutputBuffer::appendAggregated(const IpAddress& ip, uint64_t count, int64_t sum) {
+    // адрес, два числа до 20 знаков с табуляциями и перевод строки
+    if (buffer_.size() - used_ < kSlack + 43) flush();
+    char* p = buffer_.data() + used_;
+    p += formatIp(ip, p);
+    *p++ = '\t';
+    p = std::to_chars(p, p + 20, count).ptr;
+    *p++ = '\t';
+    p = std::to_chars(p, p + 20, sum).ptr;
+    *p++ = '\n';
+    used_ = static_cast<size_t>(p - buffer_.data());
+}
+
+void OutputBuffer::appendSelected(const IpAddress* first, const uint64_t* bitmap, size_t count) {
+    for (size_t w = 0; w * 64 < count; ++w) {
+        for (uint64_t word = bitmap[w]; word != 0; word &= word - 1) {
+            append(first[w * 64 + static_cast<size_t>(__builtin_ctzll(word))]);
+        }
+    }
+}
+
+void OutputBuffer::append(std::string_view text) {
+    if (buffer_.size() - used_ < text.size()) {
+        flush();
+        if (text.size() > buffer_.size()) {
+            os_.write(text.data(), static_cast<std::streamsize>(text.size()));
+            written_ += text.size();
+            return;
+        }
+    }
+    std::memcpy(buffer_.data() + used_, text.data(), text.size());
+    used_ += text.size();
+}
+
+void OutputBuffer::flush() {
+    if (used_ > 0) {
+        os_.write(buffer_.data(), static_cast<std::streamsize>(used_));
+        written_ += used_;
+        used_ = 0;
+    }
+}
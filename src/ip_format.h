@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+
+/**
+ * @brief Максимальная длина текста адреса ("255.255.255.255")
+ */
+constexpr size_t kMaxIpTextLength = 15;
+
+/**
+ * @brief Запись адреса "a.b.c.d" в буфер по таблице октет -> текст
+ *
+ * @param ip Адрес
+ * @param out Буфер, в котором есть хотя бы kMaxIpTextLength + 1 свободных байт
+ *            (октеты копируются по 4 байта, лишнее затирается следующим октетом)
+ * @return Количество записанных символов
+ */
+size_t formatIp(const IpAddress& ip, char* out);
+
+/**
+ * @brief Максимальная длина канонического текста IPv6 ("ffff:ffff:...:ffff")
+ */
+constexpr size_t kMaxIp6TextLength = 39;
+
+/**
+ * @brief Запись адреса IPv6 в каноническом виде RFC 5952
+ *
+ * Строчные цифры без ведущих нулей, самая длинная серия (от двух) нулевых
+ * групп заменяется на "::" (при равных - первая). Отображенный адрес IPv4
+ * пишется как "::ffff:a.b.c.d".
+ *
+ * @param ip Адрес
+ * @param out Буфер, в котором есть хотя бы kMaxIp6TextLength свободных байт
+ * @return Количество записанных символов
+ */
+size_t formatIp6(const Ip6Address& ip, char* out);
+
+/**
+ * @brief Буферизованный вывод адресов
+ *
+ * Адреса форматируются через таблицу из 256 готовых строк (без iostream
+ * и локалей на каждый октет) в большой буфер, который сбрасывается
+ * в поток крупными блоками через ostream::write. Оставшееся выводится
+ * в деструкторе.
+ */
+class OutputBuffer {
+public:
+    explicit OutputBuffer(std::ostream& os, size_t capacity = 1u << 20);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    /**
+     * @brief Добавить адрес и перевод строки
+     */
+    void append(const IpAddress& ip) {
+        if (buffer_.size() - used_ < kSlack) flush();
+        used_ += formatIp(ip, buffer_.data() + used_);
+        buffer_[used_++] = '\n';
+    }
+
+    /**
+     * @brief Добавить адрес IPv6 и перевод строки
+     */
+    void append(const Ip6Address& ip) {
+        if (buffer_.size() - used_ < kSlack6) flush();
+        used_ += formatIp6(ip, buffer_.data() + used_);
+        buffer_[used_++] = '\n';
+    }
+
+    /**
+     * @brief Добавить строку "адрес<TAB>счетчик"
+     */
+    void appendCounted(const IpAddress& ip, uint64_t count);
+
+    /**
+     * @brief Добавить строку "адрес<TAB>счетчик<TAB>сумма"
+     */
+    void appendAggregated(const IpAddress& ip, uint64_t count, int64_t sum);
+
+    /**
+     * @brief Добавить адреса, отмеченные в битовой карте (бит i - адрес first[i])
+     * 
+     * @param first Начало массива адресов
+     * @param bitmap Карта из (count + 63) / 64 слов
+     * @param count Количество адресов
+     */
+    void appendSelected(const IpAddress* first, const uint64_t* bitmap, size_t count);
+
+    /**
+     * @brief Добавить произвольный текст
+     */
+    void append(std::string_view text);
+
+    /**
+     * @brief Вывести накопленное в поток
+     */
+    void flush();
+
+    /**
+     * @brief Сколько байт добавлено с момента создания (выведенные и ожидающие)
+     */
+    size_t written() const { return written_ + used_; }
+
+private:
+    // запас под один адрес с переводом строки и 4-байтовым копированием последнего октета
+    static constexpr size_t kSlack = kMaxIpTextLength + 8;
+    static constexpr size_t kSlack6 = kMaxIp6TextLength + 8;
+
+    std::ostream& os_;
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+    size_t written_ = 0;  ///< Байт, уже выведенных в os_
+};
@@ -0,0 +1,115 @@
+/**
+ * @file ip_index.cpp
+ * @brief Индекс по отсортированному пулу: бинарный поиск префиксов и списки строк по октетам
+ */
+
+#include "ip_index.h"
+#include <algorithm>
+#include <iterator>
+
+// ============================================================================
+// ПРЕФИКСНЫЙ ПОИСК
+// ============================================================================
+
+/**
+ * @brief Диапазон адресов с заданным префиксом
+ *
+ * Префикс переводится в пару маска/значение над 32-битным ключом.
+ * В пуле (по убыванию ключа) сначала идут адреса с (key & mask) > value,
+ * затем искомые, затем меньшие - границы ищутся через partition_point.
+ */
+RowRange prefixRange(IpSpan sortedPool, const uint8_t* octets, size_t count) {
+    const PrefixMask prefix = PrefixMask::of(octets, count);
+    const uint32_t mask = prefix.mask;
+    const uint32_t value = prefix.value;
+
+    auto begin = sortedPool.begin();
+    auto first = std::partition_point(begin, sortedPool.end(),
+        [&](const IpAddress& ip) { return (ip.key() & mask) > value; });
+    auto last = std::partition_point(first, sortedPool.end(),
+        [&](const IpAddress& ip) { return (ip.key() & mask) == value; });
+
+    return {static_cast<size_t>(first - begin), static_cast<size_t>(last - begin)};
+}
+
+// ============================================================================
+// IpIndex
+// ============================================================================
+
+IpIndex::IpIndex(IpSpan sortedPool)
+    : pool_(sortedPool) {}
+
+IpIndex::IpIndex(IpSpan sortedPool, const uint32_t* offsets, const uint32_t* rows)
+    : pool_(sortedPool), offsetsData_(offsets), rowsData_(rows) {
+    // списки уже есть - построение не понадобится
+    std::call_once(postingsBuilt_, [] {});
+}
+
+/**
+ * @brief Построение списков строк подсчетом (два прохода по пулу)
+ *
+ * Строки добавляются по возрастанию номера, поэтому каждый список отсортирован.
+ */
+void IpIndex::buildPostings() const {
+    offsets_.assign(kPostingOffsets, 0);
+    for (const auto& ip : pool_) {
+        for (int p = 0; p < 4; ++p) {
+            ++offsets_[p * 257 + ip.octets[p] + 1];
+        }
+    }
+
+    uint32_t total = 0;
+    for (int p = 0; p < 4; ++p) {
+        for (int v = 0; v <= 256; ++v) {
+            total += offsets_[p * 257 + v];
+            offsets_[p * 257 + v] = total;
+        }
+    }
+
+    rows_.resize(4 * pool_.size());
+    std::vector<uint32_t> cursor(offsets_);
+    for (size_t row = 0; row < pool_.size(); ++row) {
+        for (int p = 0; p < 4; ++p) {
+            rows_[cursor[p * 257 + pool_[row].octets[p]]++] = static_cast<uint32_t>(row);
+        }
+    }
+
+    offsetsData_ = offsets_.data();
+    rowsData_ = rows_.data();
+}
+
+const uint32_t* IpIndex::postingOffsets() const {
+    std::call_once(postingsBuilt_, [this] { buildPostings(); });
+    return offsetsData_;
+}
+
+const uint32_t* IpIndex::postingRows() const {
+    std::call_once(postingsBuilt_, [this] { buildPostings(); });
+    return rowsData_;
+}
+
+std::pair<const uint32_t*, const uint32_t*> IpIndex::postings(int position, uint8_t value) const {
+    const uint32_t* offsets = postingOffsets();
+    const uint32_t* base = postingRows();
+    return {base + offsets[position * 257 + value], base + offsets[position * 257 + value + 1]};
+}
+
+/**
+ * @brief Объединение четырех списков строк для значения value
+ *
+ * Адрес может содержать value в нескольких позициях, поэтому после
+ * слияния повторы удаляются.
+ */
+std::vector<uint32_t> IpIndex::any(uint8_t value) const {
+    std::vector<uint32_t> left, right, result;
+    auto p0 = postings(0, value), p1 = postings(1, value);
+    auto p2 = postings(2, value), p3 = postings(3, value);
+
+    std::merge(p0.first, p0.second, p1.first, p1.second, std::back_inserter(left));
+    std::merge(p2.first, p2.second, p3.first, p3.second, std::back_inserter(right));
+    result.reserve(left.size() + right.size());
+    std::merge(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(result));
+
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "ip_address.h"
+
+/**
+ * @brief Полуоткрытый диапазон номеров строк пула [first, last)
+ */
+struct RowRange {
+    size_t first = 0;
+    size_t last = 0;
+
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+};
+
+/**
+ * @brief Диапазон адресов отсортированного пула с заданными первыми октетами
+ *
+ * Пул отсортирован по убыванию ключа, поэтому адреса с общим префиксом
+ * идут подряд и находятся двумя бинарными поисками.
+ *
+ * @param sortedPool Пул, отсортированный по IpAddress::operator<
+ * @param octets Значения первых октетов
+ * @param count Количество октетов в префиксе (0-4)
+ * @return Диапазон строк, O(log n)
+ */
+RowRange prefixRange(IpSpan sortedPool, const uint8_t* octets, size_t count);
+
+/**
+ * @brief Индекс по отсортированному пулу для многократных запросов
+ *
+ * - префиксные запросы (как filter) - бинарным поиском по пулу, O(log n + k)
+ * - запросы "октет в любой позиции" (как filter_any) - по спискам строк
+ *   для каждого значения каждой позиции (4 x 256 списков), O(k)
+ *
+ * Списки строк строятся один раз при первом запросе any() или берутся
+ * готовыми из снимка (ip_snapshot.h).
+ * Индекс хранит ссылку на пул, пул должен жить дольше индекса и не меняться.
+ */
+class IpIndex {
+public:
+    explicit IpIndex(IpSpan sortedPool);
+
+    /**
+     * @brief Индекс с готовыми списками строк (например, из снимка)
+     *
+     * @param sortedPool Отсортированный пул
+     * @param offsets Границы списков, kPostingOffsets значений (см. postingOffsets())
+     * @param rows Номера строк, 4 * sortedPool.size() значений
+     */
+    IpIndex(IpSpan sortedPool, const uint32_t* offsets, const uint32_t* rows);
+
+    /// Число границ списков строк: 4 позиции x (256 значений + 1)
+    static constexpr size_t kPostingOffsets = 4 * 257;
+
+    /**
+     * @brief Адреса, у которых первые октеты равны args
+     * @return Диапазон строк пула
+     */
+    template<typename... Args>
+    RowRange prefix(Args... args) const {
+        static_assert(sizeof...(args) <= 4, "Too many arguments for IP address (max 4 octets)");
+        const uint8_t octets[] = {static_cast<uint8_t>(args)..., 0};
+        return prefixRange(pool_, octets, sizeof...(args));
+    }
+
+    /**
+     * @brief Номера строк (по возрастанию, без повторов), где value встречается в любом октете
+     */
+    std::vector<uint32_t> any(uint8_t value) const;
+
+    /**
+     * @brief Номера строк, где октет в позиции position равен value
+     * @return Указатели на начало и конец списка (по возрастанию)
+     */
+    std::pair<const uint32_t*, const uint32_t*> postings(int position, uint8_t value) const;
+
+    /**
+     * @brief Списки строк целиком в формате CSR (строятся при первом обращении)
+     *
+     * Строки позиции p со значением v - postingRows()[offsets[p * 257 + v] .. offsets[p * 257 + v + 1]).
+     */
+    const uint32_t* postingOffsets() const;
+    const uint32_t* postingRows() const;
+
+    IpSpan pool() const { return pool_; }
+
+private:
+    void buildPostings() const;
+
+    IpSpan pool_;
+
+    // Списки строк в формате CSR: для позиции p и значения v строки лежат
+    // в rows[offsets[p * 257 + v] .. offsets[p * 257 + v + 1]).
+    // Указатели смотрят либо в собственные векторы, либо в память снимка.
+    mutable std::once_flag postingsBuilt_;
+    mutable std::vector<uint32_t> offsets_;
+    mutable std::vector<uint32_t> rows_;
+    mutable const uint32_t* offsetsData_ = nullptr;
+    mutable const uint32_t* rowsData_ = nullptr;
+};
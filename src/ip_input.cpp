@@ -0,0 +1,274 @@
+/**
+ * @file ip_input.cpp
+ * @brief Чтение входных данных без построчного копирования
+ *
+ * Вместо std::getline + std::string на каждую строку:
+ * - обычный файл отображается в память (mmap)
+ * - канал читается через read() блоками по несколько мегабайт
+ * - строки ищутся через memchr прямо в этих байтах
+ */
+
+#include "ip_input.h"
+#include "ip_parse_simd.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Начальный размер буфера для чтения из канала
+constexpr size_t kReadChunk = 4u << 20;
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+// ============================================================================
+// ОТКРЫТИЕ ДАННЫХ
+// ============================================================================
+
+/**
+ * @brief Открыть файл по пути и отобразить его в память
+ *
+ * @param path Путь к файлу
+ * @return InputBuffer с содержимым файла
+ */
+InputBuffer InputBuffer::fromFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw systemError("Не удалось открыть файл " + path);
+    }
+    try {
+        InputBuffer buffer = fromFd(fd);
+        ::close(fd);
+        return buffer;
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+/**
+ * @brief Прочитать дескриптор: mmap для обычных файлов, read() для остального
+ *
+ * @param fd Открытый на чтение дескриптор
+ * @return InputBuffer с содержимым
+ */
+InputBuffer InputBuffer::fromFd(int fd) {
+    InputBuffer buffer;
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            // данные читаются один раз подряд - подсказываем ядру упреждающее чтение
+            ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            buffer.data_ = static_cast<const char*>(addr);
+            buffer.size_ = static_cast<size_t>(st.st_size);
+            buffer.mapped_ = true;
+            return buffer;
+        }
+        // mmap не удался - читаем обычным способом
+    }
+
+    // канал, терминал или файл, который не удалось отобразить
+    size_t used = 0;
+    buffer.storage_.resize(kReadChunk);
+    for (;;) {
+        if (used == buffer.storage_.size()) {
+            buffer.storage_.resize(buffer.storage_.size() * 2);
+        }
+        ssize_t n = ::read(fd, buffer.storage_.data() + used, buffer.storage_.size() - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw systemError("Ошибка чтения входных данных");
+        }
+        if (n == 0) break;
+        used += static_cast<size_t>(n);
+    }
+    buffer.storage_.resize(used);
+    buffer.data_ = buffer.storage_.data();
+    buffer.size_ = used;
+    return buffer;
+}
+
+// ============================================================================
+// ВЛАДЕНИЕ
+// ============================================================================
+
+InputBuffer::InputBuffer(InputBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+InputBuffer& InputBuffer::operator=(InputBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        mapped_ = other.mapped_;
+        size_ = other.size_;
+        storage_ = std::move(other.storage_);
+        data_ = mapped_ ? other.data_ : storage_.data();
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mapped_ = false;
+    }
+    return *this;
+}
+
+InputBuffer::~InputBuffer() {
+    release();
+}
+
+void InputBuffer::release() {
+    if (mapped_ && data_ != nullptr) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    storage_.clear();
+}
+
+// ============================================================================
+// ЧТЕНИЕ ПОРЦИЯМИ
+// ============================================================================
+
+ChunkReader::ChunkReader(int fd, size_t bufferSize)
+    : fd_(fd), buffer_(std::max<size_t>(bufferSize, 4096)) {}
+
+/**
+ * @brief Следующая порция целых строк
+ *
+ * Остаток незавершенной строки сдвигается в начало буфера, затем дочитываются
+ * данные. Если строка длиннее всего буфера, буфер удваивается.
+ */
+bool ChunkReader::next(std::string_view& lines) {
+    // остаток предыдущей порции - в начало буфера
+    if (begin_ > 0) {
+        std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+
+    size_t scanned = 0;  // в [0, scanned) перевода строки точно нет
+    for (;;) {
+        const void* nl = nullptr;
+        if (end_ > scanned) {
+            nl = ::memrchr(buffer_.data() + scanned, '\n', end_ - scanned);
+        }
+        if (nl != nullptr) {
+            size_t cut = static_cast<size_t>(static_cast<const char*>(nl) - buffer_.data()) + 1;
+            lines = std::string_view(buffer_.data(), cut);
+            begin_ = cut;
+            return true;
+        }
+        scanned = end_;
+
+        if (eof_) {
+            // последняя строка без перевода строки
+            if (end_ == 0) return false;
+            lines = std::string_view(buffer_.data(), end_);
+            begin_ = end_;
+            return true;
+        }
+
+        if (end_ == buffer_.size()) {
+            buffer_.resize(buffer_.size() * 2);
+        }
+        ssize_t n = ::read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw systemError("Ошибка чтения входных данных");
+        }
+        if (n == 0) {
+            eof_ = true;
+        }
+        end_ += static_cast<size_t>(n);
+    }
+}
+
+// ============================================================================
+// РАЗБОР СТРОК
+// ============================================================================
+
+/**
+ * @brief Разбор всех строк в пул адресов
+ *
+ * Делегирует пакетному векторизованному разбору (см. ip_parse_simd.h):
+ * концы строк и адреса ищутся прямо в байтах входных данных.
+ *
+ * @param data Входные данные
+ * @param ipPool Пул для добавления адресов
+ */
+void readIpAddresses(std::string_view data, std::vector<IpAddress>& ipPool) {
+    parseIpBatch(data, ipPool);
+}
+
+void readIpAddresses(std::string_view data, IpPool& ipPool) {
+    parseIpBatch(data, ipPool);
+}
+
+/**
+ * @brief Строки IPv6 вырезаются из потока, промежутки между ними - пакетами IPv4
+ */
+void readMixedAddresses(std::string_view data, std::vector<IpAddress>& ipPool,
+                        std::vector<Ip6Address>& ip6Pool) {
+    const char* p = data.data();
+    const char* end = p + data.size();
+    const char* batchStart = p;  // начало еще не разобранных строк IPv4
+
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* lineEnd = eol ? eol : end;
+
+        const char* q = p;
+        while (q < lineEnd && *q != '\t' && *q != ':') ++q;
+        if (q < lineEnd && *q == ':') {
+            parseIpBatch(std::string_view(batchStart, static_cast<size_t>(p - batchStart)), ipPool);
+            std::string_view line(p, static_cast<size_t>(lineEnd - p));
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (InvalidLines* invalid = InvalidLines::active()) {
+                // IPv6 в журналах редок, его строгий разбор остается на исключениях
+                try {
+                    ip6Pool.push_back(parseIp6(extractFirstColumn(line)));
+                } catch (const std::invalid_argument&) {
+                    invalid->add(line, "неверный адрес IPv6");
+                }
+            } else {
+                ip6Pool.push_back(parseIp6(extractFirstColumn(line)));
+            }
+            batchStart = eol ? eol + 1 : end;
+        }
+        p = eol ? eol + 1 : end;
+    }
+    parseIpBatch(std::string_view(batchStart, static_cast<size_t>(end - batchStart)), ipPool);
+}
+
+bool hasIp6Lines(std::string_view data) {
+    const char* p = data.data();
+    const char* end = p + data.size();
+
+    while (p < end) {
+        const char* colon = static_cast<const char*>(std::memchr(p, ':', static_cast<size_t>(end - p)));
+        if (colon == nullptr) {
+            return false;
+        }
+        // p - всегда начало строки, поэтому начало строки с ':' не раньше p
+        const char* lineStart = colon;
+        while (lineStart > p && lineStart[-1] != '\n') --lineStart;
+        if (std::memchr(lineStart, '\t', static_cast<size_t>(colon - lineStart)) == nullptr) {
+            return true;
+        }
+        // остаток строки пропускаем
+        const char* eol = static_cast<const char*>(std::memchr(colon, '\n', static_cast<size_t>(end - colon)));
+        p = eol ? eol + 1 : end;
+    }
+    return false;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+#include "ip_pool.h"
+
+/**
+ * @brief Входные данные целиком в памяти
+ *
+ * Обычный файл отображается в память через mmap (без копирования),
+ * канал или терминал вычитываются через read() крупными блоками.
+ * Строки и адреса затем разбираются прямо из этих байтов.
+ */
+class InputBuffer {
+public:
+    /**
+     * @brief Открыть файл по пути
+     * @throws std::runtime_error если файл не удалось открыть или прочитать
+     */
+    static InputBuffer fromFile(const std::string& path);
+
+    /**
+     * @brief Прочитать уже открытый дескриптор (например, stdin)
+     *
+     * Если дескриптор указывает на обычный файл - используется mmap,
+     * иначе - чтение через read() в растущий буфер.
+     * @throws std::runtime_error при ошибке чтения
+     */
+    static InputBuffer fromFd(int fd);
+
+    InputBuffer(InputBuffer&& other) noexcept;
+    InputBuffer& operator=(InputBuffer&& other) noexcept;
+    InputBuffer(const InputBuffer&) = delete;
+    InputBuffer& operator=(const InputBuffer&) = delete;
+    ~InputBuffer();
+
+    /**
+     * @brief Представление всех прочитанных байтов
+     */
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    InputBuffer() = default;
+    void release();
+
+    const char* data_ = nullptr;  ///< Начало данных (mmap или storage_)
+    size_t size_ = 0;             ///< Размер данных в байтах
+    bool mapped_ = false;         ///< true, если data_ получен через mmap
+    std::vector<char> storage_;   ///< Буфер для чтения через read()
+};
+
+/**
+ * @brief Чтение дескриптора порциями целых строк
+ *
+ * Для обработки данных больше памяти и для потокового режима: в памяти
+ * держится только буфер фиксированного размера. Каждая порция заканчивается
+ * на '\n' (кроме последней строки файла без перевода строки); незавершенная
+ * строка переносится в начало буфера и дочитывается следующим вызовом.
+ */
+class ChunkReader {
+public:
+    ChunkReader(int fd, size_t bufferSize);
+
+    /**
+     * @brief Следующая порция целых строк
+     *
+     * Возвращает, как только прочитана хотя бы одна целая строка,
+     * поэтому из канала строки отдаются по мере поступления.
+     *
+     * @param lines Порция (действительна до следующего вызова)
+     * @return false, если данные закончились
+     * @throws std::runtime_error при ошибке чтения
+     */
+    bool next(std::string_view& lines);
+
+private:
+    int fd_;
+    std::vector<char> buffer_;
+    size_t begin_ = 0;  ///< Начало непрочитанного остатка
+    size_t end_ = 0;    ///< Конец данных в буфере
+    bool eof_ = false;
+};
+
+/**
+ * @brief Разбор всех строк входных данных в пул адресов
+ *
+ * Каждая непустая строка - это "ip\tcolumn2\tcolumn3", берется первый столбец.
+ * Работает по указателям, без копирования строк.
+ *
+ * @param data Входные данные
+ * @param ipPool Пул, в который добавляются адреса
+ * @throws std::invalid_argument если адрес в строке некорректный
+ */
+void readIpAddresses(std::string_view data, std::vector<IpAddress>& ipPool);
+
+/**
+ * @brief То же в пул-арену: адреса не перекладываются при росте (см. IpPool)
+ *
+ * @throws std::length_error если строк больше, чем IpPool::capacity()
+ */
+void readIpAddresses(std::string_view data, IpPool& ipPool);
+
+/**
+ * @brief Разбор журнала, в котором встречаются и IPv4, и IPv6
+ *
+ * Строка с ':' в первом столбце - адрес IPv6. Подряд идущие строки IPv4
+ * разбираются пакетно тем же быстрым путем, что и в readIpAddresses.
+ *
+ * @param data Входные данные
+ * @param ipPool Пул, в который добавляются адреса IPv4
+ * @param ip6Pool Пул, в который добавляются адреса IPv6
+ * @throws std::invalid_argument если адрес в строке некорректный
+ */
+void readMixedAddresses(std::string_view data, std::vector<IpAddress>& ipPool,
+                        std::vector<Ip6Address>& ip6Pool);
+
+/**
+ * @brief Есть ли в данных строка с адресом IPv6 (':' в первом столбце)
+ *
+ * ':' в остальных столбцах (время, URL) не в счет. Поиск идет по ':' через
+ * memchr, поэтому журнал IPv4 без двоеточий просматривается за один быстрый проход.
+ */
+bool hasIp6Lines(std::string_view data);
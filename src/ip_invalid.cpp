@@ -0,0 +1,35 @@
+/**
+ * @file ip_invalid.cpp
+ * @brief Учет строк, пропущенных в режиме --skip-invalid
+ */
+
+#include "ip_invalid.h"
+#include "ip_stats.h"
+#include <ostream>
+
+InvalidLines* InvalidLines::active_ = nullptr;
+
+void InvalidLines::add(std::string_view line, const char* reason) {
+    countParseError();
+    uint64_t index = count_.fetch_add(1, std::memory_order_relaxed);
+    if (index < sampleLimit_) {
+        std::lock_guard<std::mutex> lock(samplesMutex_);
+        if (samples_.size() < sampleLimit_) {
+            samples_.push_back({std::string(line), reason});
+        }
+    }
+}
+
+std::vector<InvalidLines::Sample> InvalidLines::samples() const {
+    std::lock_guard<std::mutex> lock(samplesMutex_);
+    return samples_;
+}
+
+void InvalidLines::report(std::ostream& os) const {
+    uint64_t skipped = count();
+    if (skipped == 0) return;
+    os << "Пропущено строк с некорректным адресом: " << skipped << '\n';
+    for (const Sample& sample : samples()) {
+        os << "  " << sample.line << "  (" << sample.reason << ")\n";
+    }
+}
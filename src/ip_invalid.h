@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Строки, пропущенные в режиме --skip-invalid: счетчик и несколько образцов
+ *
+ * Без --skip-invalid строка с некорректным адресом прерывает запуск
+ * исключением. Если сборщик установлен (setActive), разбор вместо этого
+ * вызывает add и идет дальше: строка не попадает в пул, быстрый путь
+ * корректных строк не меняется. add потокобезопасен - его вызывают потоки
+ * параллельного разбора; копия строки делается только для первых образцов.
+ */
+class InvalidLines {
+public:
+    /**
+     * @brief Один сохраненный образец
+     */
+    struct Sample {
+        std::string line;    ///< Строка без перевода строки
+        const char* reason;  ///< Причина (describeParseError или сообщение разбора IPv6)
+    };
+
+    /**
+     * @param sampleLimit Сколько первых строк сохранить для отчета (0 - только счет)
+     */
+    explicit InvalidLines(size_t sampleLimit = 0) : sampleLimit_(sampleLimit) {}
+
+    InvalidLines(const InvalidLines&) = delete;
+    InvalidLines& operator=(const InvalidLines&) = delete;
+
+    /**
+     * @brief Сборщик запуска или nullptr, если некорректные строки - ошибка
+     */
+    static InvalidLines* active() { return active_; }
+
+    /**
+     * @brief Установить сборщик (nullptr - вернуть строгий режим); вызывается до разбора
+     */
+    static void setActive(InvalidLines* lines) { active_ = lines; }
+
+    /**
+     * @brief Учесть пропущенную строку
+     */
+    void add(std::string_view line, const char* reason);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Сохраненные образцы (в порядке добавления; при нескольких потоках порядок не задан)
+     */
+    std::vector<Sample> samples() const;
+
+    /**
+     * @brief Отчет в stderr: "Пропущено строк с некорректным адресом: N" и образцы; ничего, если N = 0
+     */
+    void report(std::ostream& os) const;
+
+private:
+    static InvalidLines* active_;
+
+    std::atomic<uint64_t> count_{0};
+    size_t sampleLimit_;
+    mutable std::mutex samplesMutex_;
+    std::vector<Sample> samples_;
+};
@@ -0,0 +1,349 @@
+/**
+ * @file ip_match.cpp
+ * @brief SWAR / SSE / AVX2 ядра "есть ли байт, равный v", "совпадает ли префикс"
+ * и "попадает ли ключ в диапазон"
+ *
+ * Ядра обрабатывают полные блоки по 64 адреса (одно слово карты),
+ * хвост меньше 64 адресов - скалярно.
+ */
+
+#include "ip_match.h"
+#include <cstring>
+
+#ifdef IP_FILTER_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using AnyKernel = void (*)(const IpAddress* first, size_t count, uint8_t value, uint64_t* bitmap);
+using PrefixKernel = void (*)(const IpAddress* first, size_t count, PrefixMask prefix, uint64_t* bitmap);
+using RangeKernel = void (*)(const IpAddress* first, size_t count, uint32_t mask, uint32_t lo, uint32_t hi,
+                             uint64_t* bitmap);
+
+constexpr uint64_t kLow7 = 0x7F7F7F7F7F7F7F7Full;
+
+/**
+ * @brief Старший бит каждого нулевого байта (точная версия, без переносов между байтами)
+ */
+inline uint64_t zeroBytes(uint64_t y) {
+    return ~(((y & kLow7) + kLow7) | y | kLow7);
+}
+
+// ============================================================================
+// СКАЛЯРНЫЕ ЯДРА (SWAR)
+// ============================================================================
+
+/**
+ * @brief Хвост: по одному адресу
+ */
+uint64_t anyWordScalar(const IpAddress* first, size_t count, uint8_t value) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < count; ++i) {
+        word |= static_cast<uint64_t>(first[i].contains(value)) << i;
+    }
+    return word;
+}
+
+uint64_t prefixWordScalar(const IpAddress* first, size_t count, PrefixMask native) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < count; ++i) {
+        word |= static_cast<uint64_t>(native.matches(first[i].raw())) << i;
+    }
+    return word;
+}
+
+/**
+ * @brief SWAR: два адреса в одном uint64_t, байты сравниваются через XOR и поиск нулевого байта
+ */
+void matchAnySwar(const IpAddress* first, size_t count, uint8_t value, uint64_t* bitmap) {
+    const uint64_t broadcast = 0x0101010101010101ull * value;
+    size_t blocks = count / 64;
+
+    for (size_t b = 0; b < blocks; ++b) {
+        const IpAddress* block = first + b * 64;
+        uint64_t word = 0;
+        for (size_t i = 0; i < 64; i += 2) {
+            uint64_t pair;
+            std::memcpy(&pair, block + i, sizeof(pair));
+            uint64_t zeros = zeroBytes(pair ^ broadcast);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            uint64_t lo = (zeros & 0xFFFFFFFFull) != 0, hi = (zeros >> 32) != 0;
+#else
+            uint64_t hi = (zeros & 0xFFFFFFFFull) != 0, lo = (zeros >> 32) != 0;
+#endif
+            word |= (lo | (hi << 1)) << i;
+        }
+        bitmap[b] = word;
+    }
+    if (count % 64 != 0) {
+        bitmap[blocks] = anyWordScalar(first + blocks * 64, count % 64, value);
+    }
+}
+
+void matchPrefixScalar(const IpAddress* first, size_t count, PrefixMask prefix, uint64_t* bitmap) {
+    const PrefixMask native = prefix.inMemoryOrder();
+    size_t blocks = count / 64;
+    for (size_t b = 0; b < blocks; ++b) {
+        bitmap[b] = prefixWordScalar(first + b * 64, 64, native);
+    }
+    if (count % 64 != 0) {
+        bitmap[blocks] = prefixWordScalar(first + blocks * 64, count % 64, native);
+    }
+}
+
+/**
+ * @brief Хвост диапазона: (v - lo) <= (hi - lo) - одно беззнаковое сравнение вместо двух
+ */
+uint64_t rangeWordScalar(const IpAddress* first, size_t count, uint32_t mask, uint32_t lo, uint32_t hi) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < count; ++i) {
+        word |= static_cast<uint64_t>((first[i].key() & mask) - lo <= hi - lo) << i;
+    }
+    return word;
+}
+
+void matchKeyRangeScalar(const IpAddress* first, size_t count, uint32_t mask, uint32_t lo, uint32_t hi,
+                         uint64_t* bitmap) {
+    size_t blocks = count / 64;
+    for (size_t b = 0; b < blocks; ++b) {
+        bitmap[b] = rangeWordScalar(first + b * 64, 64, mask, lo, hi);
+    }
+    if (count % 64 != 0) {
+        bitmap[blocks] = rangeWordScalar(first + blocks * 64, count % 64, mask, lo, hi);
+    }
+}
+
+#ifdef IP_FILTER_X86
+
+// ============================================================================
+// SSE: 4 адреса за инструкцию
+// ============================================================================
+
+__attribute__((target("sse4.1")))
+void matchAnySse(const IpAddress* first, size_t count, uint8_t value, uint64_t* bitmap) {
+    const __m128i broadcast = _mm_set1_epi8(static_cast<char>(value));
+    const __m128i zero = _mm_setzero_si128();
+    size_t blocks = count / 64;
+
+    for (size_t b = 0; b < blocks; ++b) {
+        const IpAddress* block = first + b * 64;
+        uint64_t word = 0;
+        for (size_t i = 0; i < 64; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+            __m128i eq = _mm_cmpeq_epi8(v, broadcast);
+            // дорожка без единого совпавшего байта целиком нулевая
+            __m128i none = _mm_cmpeq_epi32(eq, zero);
+            uint64_t bits = static_cast<uint64_t>(~_mm_movemask_ps(_mm_castsi128_ps(none)) & 0xF);
+            word |= bits << i;
+        }
+        bitmap[b] = word;
+    }
+    if (count % 64 != 0) {
+        bitmap[blocks] = anyWordScalar(first + blocks * 64, count % 64, value);
+    }
+}
+
+__attribute__((target("sse4.1")))
+void matchPrefixSse(const IpAddress* first, size_t count, PrefixMask prefix, uint64_t* bitmap) {
+    const PrefixMask native = prefix.inMemoryOrder();
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(native.mask));
+    const __m128i value = _mm_set1_epi32(static_cast<int>(native.value));
+    size_t blocks = count / 64;
+
+    for (size_t b = 0; b < blocks; ++b) {
+        const IpAddress* block = first + b * 64;
+        uint64_t word = 0;
+        for (size_t i = 0; i < 64; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+            __m128i eq = _mm_cmpeq_epi32(_mm_and_si128(v, mask), value);
+            word |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(eq))) << i;
+        }
+        bitmap[b] = word;
+    }
+    if (count % 64 != 0) {
+        bitmap[blocks] = prefixWordScalar(first + blocks * 64, count % 64, native);
+    }
+}
+
+/**
+ * @brief Диапазон: ключ из порядка памяти через pshufb, беззнаковое сравнение -
+ * знаковое после инверсии старшего бита
+ */
+__attribute__((target("sse4.1")))
+void matchKeyRangeSse(const IpAddress* first, size_t count, uint32_t mask, uint32_t lo, uint32_t hi,
+                      uint64_t* bitmap) {
+    const __m128i bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const __m128i keyMask = _mm_set1_epi32(static_cast<int>(mask));
+    const __m128i low = _mm_set1_epi32(static_cast<int>(lo));
+    const __m128i width = _mm_set1_epi32(static_cast<int>((hi - lo) ^ 0x80000000u));
+    const __m128i sign = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    size_t blocks = count / 64;
+
+    for (size_t b = 0; b < blocks; ++b) {
+        const IpAddress* block = first + b * 64;
+        uint64_t word = 0;
+        for (size_t i = 0; i < 64; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+            __m128i key = _mm_and_si128(_mm_shuffle_epi8(v, bswap), keyMask);
+            __m128i offset = _mm_xor_si128(_mm_sub_epi32(key, low), sign);
+            __m128i outside = _mm_cmpgt_epi32(offset, width);
+            word |= static_cast<uint64_t>(~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF) << i;
+        }
+        bitmap[b] = word;
+    }
+    if (count % 64 != 0) {
+        bitmap[blocks] = rangeWordScalar(first + blocks * 64, count % 64, mask, lo, hi);
+    }
+}
+
+// ============================================================================
+// AVX2: 8 адресов за инструкцию
+// ============================================================================
+
+__attribute__((target("avx2")))
+void matchAnyAvx2(const IpAddress* first, size_t count, uint8_t value, uint64_t* bitmap) {
+    const __m256i broadcast = _mm256_set1_epi8(static_cast<char>(value));
+    const __m256i zero = _mm256_setzero_si256();
+    size_t blocks = count / 64;
+
+    for (size_t b = 0; b < blocks; ++b) {
+        const IpAddress* block = first + b * 64;
+        uint64_t word = 0;
+        for (size_t i = 0; i < 64; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+            __m256i eq = _mm256_cmpeq_epi8(v, broadcast);
+            __m256i none = _mm256_cmpeq_epi32(eq, zero);
+            uint64_t bits = static_cast<uint64_t>(~_mm256_movemask_ps(_mm256_castsi256_ps(none)) & 0xFF);
+            word |= bits << i;
+        }
+        bitmap[b] = word;
+    }
+    if (count % 64 != 0) {
+        bitmap[blocks] = anyWordScalar(first + blocks * 64, count % 64, value);
+    }
+}
+
+__attribute__((target("avx2")))
+void matchPrefixAvx2(const IpAddress* first, size_t count, PrefixMask prefix, uint64_t* bitmap) {
+    const PrefixMask native = prefix.inMemoryOrder();
+    const __m256i mask = _mm256_set1_epi32(static_cast<int>(native.mask));
+    const __m256i value = _mm256_set1_epi32(static_cast<int>(native.value));
+    size_t blocks = count / 64;
+
+    for (size_t b = 0; b < blocks; ++b) {
+        const IpAddress* block = first + b * 64;
+        uint64_t word = 0;
+        for (size_t i = 0; i < 64; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+            __m256i eq = _mm256_cmpeq_epi32(_mm256_and_si256(v, mask), value);
+            word |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq))) << i;
+        }
+        bitmap[b] = word;
+    }
+    if (count % 64 != 0) {
+        bitmap[blocks] = prefixWordScalar(first + blocks * 64, count % 64, native);
+    }
+}
+
+__attribute__((target("avx2")))
+void matchKeyRangeAvx2(const IpAddress* first, size_t count, uint32_t mask, uint32_t lo, uint32_t hi,
+                       uint64_t* bitmap) {
+    const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const __m256i keyMask = _mm256_set1_epi32(static_cast<int>(mask));
+    const __m256i low = _mm256_set1_epi32(static_cast<int>(lo));
+    const __m256i width = _mm256_set1_epi32(static_cast<int>((hi - lo) ^ 0x80000000u));
+    const __m256i sign = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    size_t blocks = count / 64;
+
+    for (size_t b = 0; b < blocks; ++b) {
+        const IpAddress* block = first + b * 64;
+        uint64_t word = 0;
+        for (size_t i = 0; i < 64; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+            __m256i key = _mm256_and_si256(_mm256_shuffle_epi8(v, bswap), keyMask);
+            __m256i offset = _mm256_xor_si256(_mm256_sub_epi32(key, low), sign);
+            __m256i outside = _mm256_cmpgt_epi32(offset, width);
+            word |= static_cast<uint64_t>(~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF) << i;
+        }
+        bitmap[b] = word;
+    }
+    if (count % 64 != 0) {
+        bitmap[blocks] = rangeWordScalar(first + blocks * 64, count % 64, mask, lo, hi);
+    }
+}
+
+#endif // IP_FILTER_X86
+
+AnyKernel anyKernelFor(SimdLevel level) {
+#ifdef IP_FILTER_X86
+    switch (level) {
+        case SimdLevel::Avx2: return matchAnyAvx2;
+        case SimdLevel::Sse41: return matchAnySse;
+        case SimdLevel::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    return matchAnySwar;
+}
+
+PrefixKernel prefixKernelFor(SimdLevel level) {
+#ifdef IP_FILTER_X86
+    switch (level) {
+        case SimdLevel::Avx2: return matchPrefixAvx2;
+        case SimdLevel::Sse41: return matchPrefixSse;
+        case SimdLevel::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    return matchPrefixScalar;
+}
+
+RangeKernel rangeKernelFor(SimdLevel level) {
+#ifdef IP_FILTER_X86
+    switch (level) {
+        case SimdLevel::Avx2: return matchKeyRangeAvx2;
+        case SimdLevel::Sse41: return matchKeyRangeSse;
+        case SimdLevel::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    return matchKeyRangeScalar;
+}
+
+// Ядра выбираются один раз при загрузке программы
+const AnyKernel kAnyKernel = anyKernelFor(detectSimdLevel());
+const PrefixKernel kPrefixKernel = prefixKernelFor(detectSimdLevel());
+const RangeKernel kRangeKernel = rangeKernelFor(detectSimdLevel());
+
+} // namespace
+
+void matchAnyOctet(const IpAddress* first, size_t count, uint8_t value, uint64_t* bitmap) {
+    kAnyKernel(first, count, value, bitmap);
+}
+
+void matchPrefix(const IpAddress* first, size_t count, PrefixMask prefix, uint64_t* bitmap) {
+    kPrefixKernel(first, count, prefix, bitmap);
+}
+
+void matchKeyRange(const IpAddress* first, size_t count, uint32_t mask, uint32_t lo, uint32_t hi,
+                   uint64_t* bitmap) {
+    kRangeKernel(first, count, mask, lo, hi, bitmap);
+}
+
+void matchAnyOctetWith(SimdLevel level, const IpAddress* first, size_t count, uint8_t value, uint64_t* bitmap) {
+    anyKernelFor(level)(first, count, value, bitmap);
+}
+
+void matchPrefixWith(SimdLevel level, const IpAddress* first, size_t count, PrefixMask prefix, uint64_t* bitmap) {
+    prefixKernelFor(level)(first, count, prefix, bitmap);
+}
+
+void matchKeyRangeWith(SimdLevel level, const IpAddress* first, size_t count, uint32_t mask, uint32_t lo,
+                       uint32_t hi, uint64_t* bitmap) {
+    rangeKernelFor(level)(first, count, mask, lo, hi, bitmap);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "ip_address.h"
+#include "simd.h"
+
+/**
+ * @file ip_match.h
+ * @brief Векторные ядра проверки адресов с результатом в виде битовой карты
+ *
+ * Пул хранится упакованно: IpAddress - ровно 4 байта, массив адресов в памяти
+ * совпадает с массивом uint32_t (IpAddress::raw()). Ядра проверяют 8 (AVX2),
+ * 4 (SSE) или 2 (SWAR на uint64_t) адреса за инструкцию и записывают
+ * бит i карты = 1, если адрес first[i] подходит. Карта занимает (count + 63) / 64
+ * слов, лишние биты последнего слова нулевые. Реализация выбирается по процессору.
+ */
+
+/**
+ * @brief Количество 64-битных слов карты для count адресов
+ */
+constexpr size_t bitmapWords(size_t count) {
+    return (count + 63) / 64;
+}
+
+/**
+ * @brief Карта адресов, у которых хотя бы один октет равен value
+ */
+void matchAnyOctet(const IpAddress* first, size_t count, uint8_t value, uint64_t* bitmap);
+
+/**
+ * @brief Карта адресов с заданным префиксом
+ *
+ * @param prefix Маска/значение над IpAddress::key()
+ */
+void matchPrefix(const IpAddress* first, size_t count, PrefixMask prefix, uint64_t* bitmap);
+
+/**
+ * @brief Карта адресов, у которых (key() & mask) в [first, last]
+ *
+ * mask = 0xFFFFFFFF - диапазон адресов; mask = 0x00FF0000, first/last со сдвигом
+ * на 16 - диапазон значений второго октета.
+ */
+void matchKeyRange(const IpAddress* first, size_t count, uint32_t mask, uint32_t lo, uint32_t hi,
+                   uint64_t* bitmap);
+
+/**
+ * @brief matchAnyOctet с явно заданным уровнем SIMD (для тестов и бенчмарков)
+ */
+void matchAnyOctetWith(SimdLevel level, const IpAddress* first, size_t count, uint8_t value, uint64_t* bitmap);
+
+/**
+ * @brief matchPrefix с явно заданным уровнем SIMD (для тестов и бенчмарков)
+ */
+void matchPrefixWith(SimdLevel level, const IpAddress* first, size_t count, PrefixMask prefix, uint64_t* bitmap);
+
+/**
+ * @brief matchKeyRange с явно заданным уровнем SIMD (для тестов и бенчмарков)
+ */
+void matchKeyRangeWith(SimdLevel level, const IpAddress* first, size_t count, uint32_t mask, uint32_t lo,
+                       uint32_t hi, uint64_t* bitmap);
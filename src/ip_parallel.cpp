@@ -0,0 +1,142 @@
+/**
+ * @file ip_parallel.cpp
+ * @brief Многопоточный конвейер: разбор кусками, поразрядная сортировка, слияние
+ */
+
+#include "ip_parallel.h"
+#include "ip_parse_simd.h"
+#include "ip_pool.h"
+#include "ip_runs.h"
+#include "ip_sort.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <thread>
+#include <utility>
+
+namespace {
+
+// Меньшие куски не окупают запуск потока
+constexpr size_t kMinChunkBytes = 64u << 10;
+
+// Выборка из каждого куска для границ диапазонов слияния
+constexpr size_t kMergeSamples = 64;
+
+/**
+ * @brief Запустить fn(i) для i = 0..count-1 в отдельных потоках и дождаться всех
+ *
+ * Первое (по индексу) исключение пробрасывается после завершения всех потоков.
+ */
+template<typename Fn>
+void runParallel(size_t count, Fn fn) {
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> workers;
+    workers.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        workers.emplace_back([&, i] {
+            try {
+                fn(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+/**
+ * @brief Слить отсортированные куски в один вектор за один проход, по потоку на диапазон ключей
+ *
+ * Границы диапазонов - квантили выборки из всех кусков. В каждом куске граница
+ * находится бинарным поиском, поэтому поток знает свои отрезки кусков и место
+ * результата в общем векторе; отрезки одного диапазона сливаются между собой.
+ * Диапазоны идут по порядку IpAddress::operator<, склейка результатов отсортирована.
+ */
+std::vector<IpAddress> mergeRuns(std::vector<std::vector<IpAddress>> runs) {
+    if (runs.size() <= 1) {
+        return runs.empty() ? std::vector<IpAddress>() : std::move(runs.front());
+    }
+
+    std::vector<IpAddress> samples;
+    size_t total = 0;
+    for (const auto& run : runs) {
+        for (size_t j = 0; j < kMergeSamples && !run.empty(); ++j) {
+            samples.push_back(run[run.size() * j / kMergeSamples]);
+        }
+        total += run.size();
+    }
+    std::sort(samples.begin(), samples.end());
+
+    // cuts[p][r] - начало диапазона p в куске r; диапазон parts - концы кусков
+    const size_t parts = runs.size();
+    std::vector<std::vector<size_t>> cuts(parts + 1, std::vector<size_t>(runs.size(), 0));
+    for (size_t r = 0; r < runs.size(); ++r) {
+        cuts[parts][r] = runs[r].size();
+        for (size_t p = 1; p < parts; ++p) {
+            const IpAddress& bound = samples[samples.size() * p / parts];
+            cuts[p][r] = static_cast<size_t>(std::lower_bound(runs[r].begin(), runs[r].end(), bound) - runs[r].begin());
+        }
+    }
+    std::vector<size_t> offsets(parts + 1, 0);
+    for (size_t p = 0; p < parts; ++p) {
+        offsets[p + 1] = offsets[p];
+        for (size_t r = 0; r < runs.size(); ++r) {
+            offsets[p + 1] += cuts[p + 1][r] - cuts[p][r];
+        }
+    }
+
+    std::vector<IpAddress> merged(total, IpAddress(0, 0, 0, 0));
+    runParallel(parts, [&](size_t p) {
+        std::vector<IpSpan> slices;
+        for (size_t r = 0; r < runs.size(); ++r) {
+            slices.emplace_back(runs[r].data() + cuts[p][r], cuts[p + 1][r] - cuts[p][r]);
+        }
+        std::vector<IpAddress> part = mergeSorted(std::move(slices));
+        std::copy(part.begin(), part.end(), merged.begin() + static_cast<std::ptrdiff_t>(offsets[p]));
+    });
+    return merged;
+}
+
+} // namespace
+
+/**
+ * @brief Разбор и сортировка в несколько потоков
+ *
+ * Граница куска сдвигается до ближайшего '\n', поэтому каждая строка целиком
+ * попадает ровно в один кусок.
+ */
+std::vector<IpAddress> parseAndSortParallel(std::string_view data, unsigned threads) {
+    size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, data.size() / kMinChunkBytes));
+
+    std::vector<std::string_view> parts;
+    size_t begin = 0;
+    for (size_t i = 1; i <= chunks && begin < data.size(); ++i) {
+        size_t end = data.size();
+        if (i < chunks) {
+            size_t target = std::max(begin, data.size() / chunks * i);
+            const void* nl = std::memchr(data.data() + target, '\n', data.size() - target);
+            if (nl != nullptr) {
+                end = static_cast<size_t>(static_cast<const char*>(nl) - data.data()) + 1;
+            }
+        }
+        parts.push_back(data.substr(begin, end - begin));
+        begin = end;
+    }
+
+    std::vector<std::vector<IpAddress>> runs(parts.size());
+    runParallel(parts.size(), [&](size_t i) {
+        // верхняя граница числа строк: вектор не переезжает при росте, а
+        // нетронутые страницы резерва физической памяти не занимают
+        runs[i].reserve(IpPool::maxRowsFor(parts[i].size()));
+        parseIpBatch(parts[i], runs[i]);
+        radixSort(runs[i].data(), runs[i].data() + runs[i].size());
+    });
+
+    return mergeRuns(std::move(runs));
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+
+/**
+ * @brief Параллельный разбор и сортировка
+ *
+ * Данные делятся на куски по границам строк, каждый поток разбирает свой кусок
+ * в отдельный вектор и сортирует его поразрядно, затем отсортированные куски
+ * сливаются за один проход: каждый поток сливает свой диапазон ключей во всех
+ * кусках. Результат совпадает с однопоточным разбором + radixSort.
+ *
+ * @param data Входные данные
+ * @param threads Число потоков
+ * @return Отсортированный пул адресов
+ * @throws std::invalid_argument если в данных есть некорректный адрес
+ *         (сообщается ошибка из самой ранней строки, как в однопоточном режиме)
+ */
+std::vector<IpAddress> parseAndSortParallel(std::string_view data, unsigned threads);
@@ -0,0 +1,296 @@
+/**
+ * @file ip_parse_simd.cpp
+ * @brief Векторизованный разбор IP-адресов (SSE4.1 / AVX2 / скалярный)
+ *
+ * Идея векторного ядра:
+ * 1. Загружаем окно байт и одной операцией классифицируем: цифры, точки, '\n'
+ * 2. Длина адреса - позиция первого байта, который не цифра и не точка
+ * 3. По длинам октетов (каждая 1..3, всего 3^4 = 81 вариант) берем из таблицы
+ *    маску pshufb, которая раскладывает цифры каждого октета по 32-битным дорожкам
+ *    с выравниванием вправо: [0, сотни, десятки, единицы]
+ * 4. pmaddubsw + pmaddwd с весами (0, 100, 10, 1) дают сразу 4 значения октетов
+ * 5. Сравнение с 255 отсекает некорректные октеты, упаковка дает 4 байта адреса
+ */
+
+#include "ip_parse_simd.h"
+#include "ip_stats.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef IP_FILTER_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Сигнатура ядра разбора
+ *
+ * Разбирает адрес, начинающийся в p. Возвращает указатель на первый символ
+ * после адреса или nullptr, если адрес некорректный. Если в обработанном окне
+ * встретился '\n', его позиция записывается в *eol (иначе nullptr).
+ */
+using ParseKernel = const char* (*)(const char* p, const char* end, IpAddress& out, const char** eol);
+
+// ============================================================================
+// СКАЛЯРНОЕ ЯДРО
+// ============================================================================
+
+const char* parseScalar(const char* p, const char* end, IpAddress& out, const char** eol) {
+    *eol = nullptr;
+    for (int i = 0; i < 4; ++i) {
+        if (i > 0) {
+            if (p == end || *p != '.') return nullptr;
+            ++p;
+        }
+        unsigned value = 0;
+        int digits = 0;
+        while (p != end && *p >= '0' && *p <= '9' && digits < 3) {
+            value = value * 10 + static_cast<unsigned>(*p - '0');
+            ++p;
+            ++digits;
+        }
+        if (digits == 0 || value > 255) return nullptr;
+        out.octets[i] = static_cast<uint8_t>(value);
+    }
+    // четвертая цифра подряд или лишняя точка - некорректный адрес
+    if (p != end && ((*p >= '0' && *p <= '9') || *p == '.')) return nullptr;
+    return p;
+}
+
+#ifdef IP_FILTER_X86
+
+// ============================================================================
+// ТАБЛИЦА МАСОК PSHUFB
+// ============================================================================
+
+/**
+ * @brief 81 маска перестановки, индекс - длины октетов (l0-1)*27 + (l1-1)*9 + (l2-1)*3 + (l3-1)
+ */
+struct ShuffleTable {
+    alignas(16) uint8_t masks[81][16];
+
+    ShuffleTable() {
+        for (int idx = 0; idx < 81; ++idx) {
+            int lens[4] = {idx / 27 + 1, idx / 9 % 3 + 1, idx / 3 % 3 + 1, idx % 3 + 1};
+            int start = 0;
+            for (int i = 0; i < 4; ++i) {
+                int end = start + lens[i];
+                uint8_t* lane = masks[idx] + 4 * i;
+                lane[0] = 0x80;  // 0x80 в pshufb дает нулевой байт
+                lane[1] = lens[i] >= 3 ? static_cast<uint8_t>(end - 3) : 0x80;
+                lane[2] = lens[i] >= 2 ? static_cast<uint8_t>(end - 2) : 0x80;
+                lane[3] = static_cast<uint8_t>(end - 1);
+                start = end + 1;  // пропускаем точку
+            }
+        }
+    }
+};
+
+const ShuffleTable kShuffle;
+
+/**
+ * @brief Общая часть векторных ядер: проверка структуры по маскам и перевод в числа
+ *
+ * @param digits Байты окна минус '0' (младшие 16 байт)
+ * @param digitMask Битовая маска цифр в окне
+ * @param dotMask Битовая маска точек в окне
+ */
+__attribute__((target("sse4.1")))
+inline const char* convertOctets(const char* p, __m128i digits, uint32_t digitMask, uint32_t dotMask,
+                                 IpAddress& out) {
+    // длина адреса - до первого байта, который не цифра и не точка
+    uint32_t valid = digitMask | dotMask;
+    unsigned len = static_cast<unsigned>(__builtin_ctz(~valid));
+    if (len > 15) return nullptr;  // самый длинный адрес "255.255.255.255" - 15 символов
+
+    uint32_t dots = dotMask & ((1u << len) - 1);
+    if (__builtin_popcount(dots) != 3) return nullptr;
+
+    unsigned d1 = static_cast<unsigned>(__builtin_ctz(dots)); dots &= dots - 1;
+    unsigned d2 = static_cast<unsigned>(__builtin_ctz(dots)); dots &= dots - 1;
+    unsigned d3 = static_cast<unsigned>(__builtin_ctz(dots));
+
+    unsigned l0 = d1, l1 = d2 - d1 - 1, l2 = d3 - d2 - 1, l3 = len - d3 - 1;
+    if (l0 - 1 > 2 || l1 - 1 > 2 || l2 - 1 > 2 || l3 - 1 > 2) return nullptr;
+
+    unsigned idx = (l0 - 1) * 27 + (l1 - 1) * 9 + (l2 - 1) * 3 + (l3 - 1);
+    __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(kShuffle.masks[idx]));
+    __m128i lanes = _mm_shuffle_epi8(digits, mask);
+
+    // [0, h, t, u] * [0, 100, 10, 1] -> [h*100, t*10 + u] -> h*100 + t*10 + u
+    __m128i pairs = _mm_maddubs_epi16(lanes, _mm_set1_epi32(0x010A6400));
+    __m128i values = _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi32(values, _mm_set1_epi32(255))) != 0) return nullptr;
+
+    __m128i packed = _mm_packus_epi16(_mm_packus_epi32(values, values), _mm_setzero_si128());
+    uint32_t bytes = static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+    std::memcpy(out.octets, &bytes, 4);
+    return p + len;
+}
+
+// ============================================================================
+// SSE4.1: окно 16 байт
+// ============================================================================
+
+__attribute__((target("sse4.1")))
+const char* parseSse41(const char* p, const char* end, IpAddress& out, const char** eol) {
+    if (end - p < 16) return parseScalar(p, end, out, eol);
+
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i digits = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    __m128i isDot = _mm_cmpeq_epi8(v, _mm_set1_epi8('.'));
+    __m128i isNl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+
+    uint32_t nlMask = static_cast<uint32_t>(_mm_movemask_epi8(isNl));
+    *eol = nlMask ? p + __builtin_ctz(nlMask) : nullptr;
+
+    return convertOctets(p, digits,
+                         static_cast<uint32_t>(_mm_movemask_epi8(isDigit)),
+                         static_cast<uint32_t>(_mm_movemask_epi8(isDot)), out);
+}
+
+// ============================================================================
+// AVX2: окно 32 байта (адрес + обычно весь остаток строки до '\n')
+// ============================================================================
+
+__attribute__((target("avx2")))
+const char* parseAvx2(const char* p, const char* end, IpAddress& out, const char** eol) {
+    if (end - p < 32) return parseSse41(p, end, out, eol);
+
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i digits = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+    __m256i isDot = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'));
+    __m256i isNl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+
+    uint32_t nlMask = static_cast<uint32_t>(_mm256_movemask_epi8(isNl));
+    *eol = nlMask ? p + __builtin_ctz(nlMask) : nullptr;
+
+    uint32_t digitMask = static_cast<uint32_t>(_mm256_movemask_epi8(isDigit));
+    uint32_t dotMask = static_cast<uint32_t>(_mm256_movemask_epi8(isDot));
+    // адрес занимает не больше 15 байт - достаточно младшей 128-битной половины
+    return convertOctets(p, _mm256_castsi256_si128(digits), digitMask & 0xFFFF, dotMask & 0xFFFF, out);
+}
+
+#endif // IP_FILTER_X86
+
+ParseKernel kernelFor(SimdLevel level) {
+#ifdef IP_FILTER_X86
+    switch (level) {
+        case SimdLevel::Avx2: return parseAvx2;
+        case SimdLevel::Sse41: return parseSse41;
+        case SimdLevel::Scalar: break;
+    }
+#else
+    (void)level;
+#endif
+    return parseScalar;
+}
+
+// Ядро выбирается один раз при загрузке программы
+const ParseKernel kBestKernel = kernelFor(detectSimdLevel());
+
+/**
+ * @brief Допустимый символ сразу после адреса: конец данных, табуляция или конец строки
+ */
+inline bool isTerminator(const char* q, const char* end) {
+    if (q == end || *q == '\t' || *q == '\n') return true;
+    return *q == '\r' && (q + 1 == end || q[1] == '\n');
+}
+
+} // namespace
+
+// ============================================================================
+// ПУБЛИЧНЫЙ ИНТЕРФЕЙС
+// ============================================================================
+
+/**
+ * @brief Разбор одного адреса заданным ядром
+ *
+ * Короткая строка копируется в дополненный нулями буфер, чтобы векторное ядро
+ * могло безопасно загрузить целое окно.
+ */
+bool parseIpWith(SimdLevel level, std::string_view ipStr, IpAddress& out) {
+    if (ipStr.size() > 15) return false;
+
+    alignas(32) char buf[32] = {};
+    std::memcpy(buf, ipStr.data(), ipStr.size());
+
+    const char* eol = nullptr;
+    const char* end = (level == SimdLevel::Scalar) ? buf + ipStr.size() : buf + sizeof(buf);
+    const char* q = kernelFor(level)(buf, end, out, &eol);
+    return q == buf + ipStr.size();
+}
+
+/**
+ * @brief Разбор одного адреса лучшим доступным ядром
+ */
+IpAddress parseIpSimd(std::string_view ipStr) {
+    // cpuid - один раз за процесс, а не на каждый адрес
+    static const SimdLevel level = detectSimdLevel();
+    IpAddress ip(0, 0, 0, 0);
+    if (ipStr.size() > 15 || !parseIpWith(level, ipStr, ip)) {
+        throw std::invalid_argument("Неверный формат IP-адреса: " + std::string(ipStr));
+    }
+    return ip;
+}
+
+/**
+ * @brief Пакетный разбор строк
+ *
+ * Быстрый путь - векторное ядро. Если ядро отвергло адрес, строка повторно
+ * разбирается tryParseIp: код ошибки без исключения, так что пропуск
+ * испорченной строки стоит столько же, сколько ее разбор.
+ */
+template<typename Pool>
+size_t parseIpBatch(std::string_view data, Pool& out, InvalidLines* invalid) {
+    const char* p = data.data();
+    const char* end = p + data.size();
+    size_t count = 0;
+
+    while (p < end) {
+        // пустые строки (в т.ч. "\r\n") пропускаем
+        if (*p == '\n') { ++p; continue; }
+        if (*p == '\r' && (p + 1 == end || p[1] == '\n')) { p += (p + 1 == end) ? 1 : 2; continue; }
+
+        IpAddress ip(0, 0, 0, 0);
+        const char* eol = nullptr;
+        const char* q = kBestKernel(p, end, ip, &eol);
+        if (q != nullptr && !isTerminator(q, end)) q = nullptr;
+
+        if (eol == nullptr) {
+            const char* from = q ? q : p;
+            eol = static_cast<const char*>(std::memchr(from, '\n', static_cast<size_t>(end - from)));
+        }
+        const char* lineEnd = eol ? eol : end;
+
+        if (q == nullptr) {
+            std::string_view line(p, static_cast<size_t>(lineEnd - p));
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            std::string_view address = extractFirstColumn(line);
+            IpParseError error = tryParseIp(address, ip);
+            if (error != IpParseError::None) {
+                if (invalid == nullptr) {
+                    countParseError();
+                    throw std::invalid_argument("Неверный формат IP-адреса: " + std::string(address));
+                }
+                invalid->add(line, describeParseError(error));
+                p = eol ? eol + 1 : end;
+                continue;
+            }
+        }
+
+        out.push_back(ip);
+        ++count;
+        p = eol ? eol + 1 : end;
+    }
+    return count;
+}
+
+template size_t parseIpBatch(std::string_view, std::vector<IpAddress>&, InvalidLines*);
+template size_t parseIpBatch(std::string_view, IpPool&, InvalidLines*);
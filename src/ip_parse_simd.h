@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+#include "ip_invalid.h"
+#include "ip_pool.h"
+#include "simd.h"
+
+/**
+ * @brief Векторизованный разбор адреса "a.b.c.d"
+ *
+ * Точки и разделители ищутся в окне 16 (SSE4.1) или 32 (AVX2) байт,
+ * все четыре октета переводятся в числа одновременно.
+ * Реализация выбирается по процессору, есть скалярный запасной вариант.
+ * Семантика проверки та же, что у parseIp: ровно 4 октета по 1-3 цифры,
+ * значение каждого октета не больше 255.
+ *
+ * @param ipStr Строка с IP-адресом
+ * @return IpAddress
+ * @throws std::invalid_argument если формат неверный
+ */
+IpAddress parseIpSimd(std::string_view ipStr);
+
+/**
+ * @brief То же, но с явно заданным уровнем SIMD (для тестов и бенчмарков)
+ *
+ * Если уровень не поддерживается процессором, поведение не определено.
+ *
+ * @param level Уровень SIMD
+ * @param ipStr Строка с IP-адресом
+ * @param out Результат разбора
+ * @return true если адрес корректный
+ */
+bool parseIpWith(SimdLevel level, std::string_view ipStr, IpAddress& out);
+
+/**
+ * @brief Пакетный разбор: все строки данных за один вызов
+ *
+ * Каждая непустая строка - "ip\tcolumn2\tcolumn3", берется первый столбец.
+ * Окно векторного ядра заодно находит конец строки, поэтому для коротких строк
+ * отдельный поиск '\n' не нужен.
+ *
+ * Строку, отвергнутую ядром, повторно разбирает tryParseIp. Если задан
+ * сборщик invalid (--skip-invalid), некорректная строка учитывается в нем
+ * и пропускается, иначе разбор прерывается исключением.
+ *
+ * @param data Входные данные (несколько строк)
+ * @param out Пул, в который добавляются адреса: std::vector<IpAddress> или IpPool
+ * @param invalid Куда учитывать пропущенные строки (nullptr - строгий режим)
+ * @return Количество добавленных адресов
+ * @throws std::invalid_argument если адрес в строке некорректный и invalid == nullptr
+ */
+template<typename Pool>
+size_t parseIpBatch(std::string_view data, Pool& out, InvalidLines* invalid = InvalidLines::active());
+
+extern template size_t parseIpBatch(std::string_view, std::vector<IpAddress>&, InvalidLines*);
+extern template size_t parseIpBatch(std::string_view, IpPool&, InvalidLines*);
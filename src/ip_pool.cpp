@@ -0,0 +1,158 @@
+/**
+ * @file ip_pool.cpp
+ * @brief Пул адресов в зарезервированном окне памяти
+ */
+
+#include "ip_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <sys/mman.h>
+
+namespace {
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/**
+ * @brief Явные большие страницы по /proc/meminfo
+ */
+struct HugePages {
+    size_t bytes = size_t{2} << 20;  ///< Hugepagesize (x86-64 по умолчанию, если файл не читается)
+    size_t free = 0;                 ///< HugePages_Free
+};
+
+HugePages hugePages() {
+    HugePages pages;
+    if (std::FILE* meminfo = std::fopen("/proc/meminfo", "r")) {
+        char line[128];
+        unsigned long value = 0;
+        while (std::fgets(line, sizeof(line), meminfo) != nullptr) {
+            if (std::sscanf(line, "Hugepagesize: %lu kB", &value) == 1) {
+                pages.bytes = static_cast<size_t>(value) << 10;
+            } else if (std::sscanf(line, "HugePages_Free: %lu", &value) == 1) {
+                pages.free = value;
+            }
+        }
+        std::fclose(meminfo);
+    }
+    return pages;
+}
+
+size_t roundUp(size_t value, size_t step) {
+    return (value + step - 1) / step * step;
+}
+
+} // namespace
+
+IpPool::IpPool(size_t maxRows, Pages pages) : maxRows_(maxRows) {
+    if (maxRows == 0) {
+        return;
+    }
+    const size_t bytes = maxRows * sizeof(IpAddress);
+
+    void* addr = MAP_FAILED;
+    const HugePages huge = pages == Pages::HugeTlb ? hugePages() : HugePages{};
+    if (huge.free > 0) {
+        // mprotect окна MAP_HUGETLB - только по границам большой страницы (2 МиБ, 1 ГиБ...)
+        chunkBytes_ = roundUp(kChunkBytes, huge.bytes);
+        reservedBytes_ = roundUp(bytes, chunkBytes_);
+        // MAP_NORESERVE: резерв - это input/2 байт, большие страницы берутся только под открытые куски
+        addr = ::mmap(nullptr, reservedBytes_, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_NORESERVE, -1, 0);
+        hugeTlb_ = addr != MAP_FAILED;
+    }
+    if (addr == MAP_FAILED) {
+        chunkBytes_ = kChunkBytes;
+        reservedBytes_ = roundUp(bytes, chunkBytes_);
+        addr = ::mmap(nullptr, reservedBytes_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (addr == MAP_FAILED) {
+            throw systemError("Не удалось зарезервировать память пула (" + std::to_string(reservedBytes_) + " байт)");
+        }
+        // совет, а не требование: без THP в ядре просто обычные страницы
+        ::madvise(addr, reservedBytes_, MADV_HUGEPAGE);
+    }
+    data_ = static_cast<IpAddress*>(addr);
+}
+
+IpPool::IpPool(IpPool&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      committed_(std::exchange(other.committed_, 0)),
+      maxRows_(std::exchange(other.maxRows_, 0)),
+      reservedBytes_(std::exchange(other.reservedBytes_, 0)),
+      chunkBytes_(std::exchange(other.chunkBytes_, kChunkBytes)),
+      hugeTlb_(std::exchange(other.hugeTlb_, false)) {}
+
+IpPool& IpPool::operator=(IpPool&& other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        committed_ = std::exchange(other.committed_, 0);
+        maxRows_ = std::exchange(other.maxRows_, 0);
+        reservedBytes_ = std::exchange(other.reservedBytes_, 0);
+        chunkBytes_ = std::exchange(other.chunkBytes_, kChunkBytes);
+        hugeTlb_ = std::exchange(other.hugeTlb_, false);
+    }
+    return *this;
+}
+
+IpPool::~IpPool() {
+    release();
+}
+
+void IpPool::release() {
+    if (data_ != nullptr) {
+        ::munmap(data_, reservedBytes_);
+        data_ = nullptr;
+    }
+}
+
+/**
+ * @brief Открыть следующий кусок окна сразу за уже открытыми
+ */
+void IpPool::grow() {
+    if (committed_ >= maxRows_) {
+        throw std::length_error("Пул адресов: превышен резерв в " + std::to_string(maxRows_) + " адресов");
+    }
+    const size_t offset = committed_ * sizeof(IpAddress);
+    const size_t length = std::min(chunkBytes_, reservedBytes_ - offset);
+    char* chunk = reinterpret_cast<char*>(data_) + offset;
+    if (::mprotect(chunk, length, PROT_READ | PROT_WRITE) != 0) {
+        throw systemError("Не удалось выделить память пула");
+    }
+#ifdef MADV_POPULATE_WRITE
+    // страницы куска - одним вызовом вместо page fault на каждую; старое ядро вернет EINVAL.
+    // С MAP_NORESERVE это и проверка: нехватка больших страниц - ошибка здесь, а не SIGBUS при записи
+    if (::madvise(chunk, length, MADV_POPULATE_WRITE) != 0 && hugeTlb_ && errno != EINVAL) {
+        // большие страницы кончились: остаток окна - обычные страницы на том же месте
+        leaveHugeTlb(chunk);
+        if (::mprotect(chunk, length, PROT_READ | PROT_WRITE) != 0) {
+            throw systemError("Не удалось выделить память пула");
+        }
+        ::madvise(chunk, length, MADV_POPULATE_WRITE);
+    }
+#endif
+    committed_ = std::min(maxRows_, (offset + length) / sizeof(IpAddress));
+}
+
+/**
+ * @brief Заменить неоткрытый остаток окна MAP_HUGETLB обычными страницами
+ *
+ * from лежит на границе куска, то есть и большой страницы; MAP_FIXED
+ * подменяет отображение на месте, поэтому пул остается непрерывным.
+ */
+void IpPool::leaveHugeTlb(char* from) {
+    const size_t rest = reservedBytes_ - static_cast<size_t>(from - reinterpret_cast<char*>(data_));
+    if (::mmap(from, rest, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        throw systemError("Не удалось выделить память пула");
+    }
+    ::madvise(from, rest, MADV_HUGEPAGE);
+    hugeTlb_ = false;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include "ip_address.h"
+
+/**
+ * @brief Пул адресов в арене: одно зарезервированное окно памяти, заполняемое кусками
+ *
+ * std::vector при росте через push_back несколько раз выделяет новый буфер
+ * и копирует в него все адреса, а каждая новая страница - отдельный page fault.
+ * IpPool один раз резервирует адресное пространство под наибольшее возможное
+ * число строк (PROT_NONE, физическая память не тратится) и открывает его
+ * кусками по kChunkBytes. Куски лежат подряд, поэтому:
+ * - адреса никогда не переезжают, указатели и IpSpan на них остаются действительными;
+ * - пул - один непрерывный массив, сортировка и фильтры работают с ним как с вектором.
+ *
+ * Окно помечается MADV_HUGEPAGE (прозрачные большие страницы), открытый кусок
+ * заполняется страницами одним вызовом (MADV_POPULATE_WRITE, если ядро умеет).
+ * Pages::HugeTlb пробует явные большие страницы (MAP_HUGETLB); если свободных
+ * нет (HugePages_Free в /proc/meminfo), молча используются обычные. Окно с ними
+ * резервируется с MAP_NORESERVE - большие страницы берутся по мере открытия
+ * кусков, а не на весь резерв сразу; кусок кратен размеру большой страницы.
+ * Если они кончились посреди заполнения, остаток окна переходит на обычные.
+ */
+class IpPool {
+public:
+    /**
+     * @brief Вид страниц окна
+     */
+    enum class Pages {
+        Transparent,  ///< Обычные страницы с MADV_HUGEPAGE
+        HugeTlb       ///< MAP_HUGETLB, при неудаче - Transparent
+    };
+
+    /// Шаг открытия окна; с MAP_HUGETLB округляется вверх до размера большой страницы
+    static constexpr size_t kChunkBytes = size_t{4} << 20;
+
+    /**
+     * @brief Наибольшее число адресов в inputBytes байт журнала
+     *
+     * Самая короткая строка - "0.0.0.0\n", 8 байт (последняя - без '\n').
+     */
+    static constexpr size_t maxRowsFor(size_t inputBytes) { return inputBytes / 8 + 1; }
+
+    IpPool() = default;
+
+    /**
+     * @param maxRows Сколько адресов можно добавить (например maxRowsFor(размер входа))
+     * @param pages Вид страниц
+     * @throws std::runtime_error если адресное пространство не удалось зарезервировать
+     */
+    explicit IpPool(size_t maxRows, Pages pages = Pages::Transparent);
+
+    IpPool(IpPool&& other) noexcept;
+    IpPool& operator=(IpPool&& other) noexcept;
+    IpPool(const IpPool&) = delete;
+    IpPool& operator=(const IpPool&) = delete;
+    ~IpPool();
+
+    /**
+     * @brief Добавить адрес; открывает следующий кусок окна, если текущий заполнен
+     * @throws std::length_error если резерв maxRows исчерпан
+     */
+    void push_back(const IpAddress& ip) {
+        if (size_ == committed_) grow();
+        data_[size_++] = ip;
+    }
+
+    IpAddress* data() { return data_; }
+    const IpAddress* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return maxRows_; }
+
+    /**
+     * @brief Открываются ли куски в явных больших страницах (MAP_HUGETLB)
+     */
+    bool hugeTlb() const { return hugeTlb_; }
+
+    operator IpSpan() const { return {data_, size_}; }  // NOLINT: неявно, как у std::vector
+
+private:
+    void grow();
+    void release();
+    void leaveHugeTlb(char* from);
+
+    IpAddress* data_ = nullptr;
+    size_t size_ = 0;
+    size_t committed_ = 0;      ///< Адресов в открытых кусках
+    size_t maxRows_ = 0;
+    size_t reservedBytes_ = 0;  ///< Размер окна (кратен chunkBytes_)
+    size_t chunkBytes_ = kChunkBytes;
+    bool hugeTlb_ = false;
+};
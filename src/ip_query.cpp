@@ -0,0 +1,372 @@
+/**
+ * @file ip_query.cpp
+ * @brief Пакетное вычисление фильтров за один проход по пулу
+ */
+
+#include "ip_query.h"
+#include "ip_format.h"
+#include "ip_index.h"
+#include "ip_match.h"
+#include "ip_stats.h"
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// Кусок пула для проверки всеми фильтрами: 16 КиБ адресов помещаются в L1
+constexpr size_t kMatchChunk = 4096;
+
+/**
+ * @brief Карта совпадений куска с набором диапазонов: бинарный поиск для каждого адреса
+ *
+ * Запасной путь для неотсортированного пула; на отсортированном используется слияние.
+ */
+void matchRangeSet(const IpAddress* chunk, size_t count, const RangeSet& ranges, uint64_t* bitmap) {
+    std::memset(bitmap, 0, bitmapWords(count) * sizeof(uint64_t));
+    for (size_t i = 0; i < count; ++i) {
+        bitmap[i / 64] |= static_cast<uint64_t>(ranges.contains(chunk[i])) << (i % 64);
+    }
+}
+
+/**
+ * @brief Номера отмеченных в карте строк куска, начинающегося со строки offset
+ */
+void appendRows(const uint64_t* bitmap, size_t count, size_t offset, std::vector<uint32_t>& matched) {
+    for (size_t w = 0; w < bitmapWords(count); ++w) {
+        for (uint64_t word = bitmap[w]; word != 0; word &= word - 1) {
+            matched.push_back(static_cast<uint32_t>(offset + w * 64 + static_cast<size_t>(__builtin_ctzll(word))));
+        }
+    }
+}
+
+/**
+ * @brief Сводится ли фильтр на отсортированном пуле к строкам одного или нескольких диапазонов
+ *
+ * Префикс из первых октетов - диапазон адресов; выражение - если у него есть
+ * границы (QueryProgram::bounds), тогда байт-код выполняется только внутри них.
+ */
+bool sliceable(const IpPredicate& predicate) {
+    switch (predicate.kind) {
+        case IpPredicate::Kind::Prefix: {
+            uint32_t low = ~predicate.mask;
+            return !predicate.matchesAll() && (low & (low + 1)) == 0;
+        }
+        case IpPredicate::Kind::Ranges: return true;
+        case IpPredicate::Kind::Query: return predicate.program->bounded();
+        case IpPredicate::Kind::Any: return false;
+    }
+    return false;
+}
+
+/**
+ * @brief Совпадения фильтра sliceable() на отсортированном пуле
+ */
+void matchSorted(const IpPredicate& predicate, IpSpan sortedPool, std::vector<uint32_t>& matched,
+                 uint64_t* bitmap, std::vector<uint64_t>& scratch) {
+    switch (predicate.kind) {
+        case IpPredicate::Kind::Prefix: {
+            RowRange rows = rangeRows(sortedPool, {predicate.value, predicate.value | ~predicate.mask});
+            for (size_t row = rows.first; row < rows.last; ++row) {
+                matched.push_back(static_cast<uint32_t>(row));
+            }
+            break;
+        }
+        case IpPredicate::Kind::Ranges:
+            predicate.ranges->matchRows(sortedPool, matched);
+            break;
+        case IpPredicate::Kind::Query: {
+            RowRange rows = rangeRows(sortedPool, predicate.program->bounds());
+            for (size_t offset = rows.first; offset < rows.last; offset += kMatchChunk) {
+                size_t count = std::min(kMatchChunk, rows.last - offset);
+                predicate.program->match(sortedPool.data() + offset, count, bitmap, scratch);
+                appendRows(bitmap, count, offset, matched);
+            }
+            break;
+        }
+        case IpPredicate::Kind::Any:
+            break;
+    }
+}
+
+/**
+ * @brief matchRows как этап "filter" для --stats, с числом совпадений каждого фильтра
+ */
+std::vector<std::vector<uint32_t>> matchRowsMeasured(const FilterBatch& batch, IpSpan ipPool,
+                                                     const IpIndex* index) {
+    StageTimer stage("filter");
+    std::vector<std::vector<uint32_t>> results = batch.matchRows(ipPool, PoolOrder::Unknown, index);
+    stage.finish(ipPool.size(), 0);
+
+    if (RunStats* stats = RunStats::active()) {
+        std::vector<uint64_t> matches;
+        for (size_t slot = 0; slot < results.size(); ++slot) {
+            matches.push_back(batch.predicates()[slot].matchesAll() ? ipPool.size() : results[slot].size());
+        }
+        stats->addMatches(batch.predicates(), matches);
+    }
+    return results;
+}
+
+/**
+ * @brief Сколько строк выведут все секции
+ */
+uint64_t outputRows(const FilterBatch& batch, const std::vector<std::vector<uint32_t>>& results, size_t poolSize) {
+    uint64_t rows = 0;
+    for (size_t slot = 0; slot < results.size(); ++slot) {
+        rows += batch.predicates()[slot].matchesAll() ? poolSize : results[slot].size();
+    }
+    return rows;
+}
+
+} // namespace
+
+// ============================================================================
+// IpPredicate
+// ============================================================================
+
+/**
+ * @brief Префикс из count октетов -> маска/значение над 32-битным ключом
+ */
+IpPredicate IpPredicate::prefixOf(const uint8_t* octets, size_t count) {
+    const PrefixMask prefix = PrefixMask::of(octets, count);
+    IpPredicate predicate;
+    predicate.kind = Kind::Prefix;
+    predicate.mask = prefix.mask;
+    predicate.value = prefix.value;
+    return predicate;
+}
+
+IpPredicate IpPredicate::any(uint8_t value) {
+    IpPredicate predicate;
+    predicate.kind = Kind::Any;
+    predicate.byte = value;
+    return predicate;
+}
+
+IpPredicate IpPredicate::range(const AddressRange& range) {
+    return rangeSet(RangeSet({range}));
+}
+
+IpPredicate IpPredicate::rangeSet(RangeSet ranges) {
+    IpPredicate predicate;
+    predicate.kind = Kind::Ranges;
+    predicate.ranges = std::make_shared<const RangeSet>(std::move(ranges));
+    return predicate;
+}
+
+IpPredicate IpPredicate::query(std::string_view text) {
+    QueryProgram program = QueryProgram::compile(text);
+    const auto& code = program.code();
+    if (code.size() == 1) {
+        const QueryProgram::Instruction& ins = code[0];
+        switch (ins.op) {
+            case QueryProgram::Instruction::Op::Mask: {
+                // Prefix - только ведущие октеты (o1, o1+o2, ...); маска вида o2==70
+                // остается программой
+                const uint32_t rest = ~ins.mask;
+                if ((rest & (rest + 1)) != 0) break;
+                IpPredicate predicate;
+                predicate.mask = ins.mask;
+                predicate.value = ins.value;
+                return predicate;
+            }
+            case QueryProgram::Instruction::Op::Any:
+                return any(ins.byte);
+            case QueryProgram::Instruction::Op::Range:
+                if (ins.mask == UINT32_MAX) return range({ins.first, ins.last});
+                break;
+            case QueryProgram::Instruction::Op::Const:
+                if (ins.value != 0) return all();
+                break;
+            default:
+                break;
+        }
+    }
+    IpPredicate predicate;
+    predicate.kind = Kind::Query;
+    predicate.program = std::make_shared<const QueryProgram>(std::move(program));
+    return predicate;
+}
+
+// ============================================================================
+// FilterBatch
+// ============================================================================
+
+size_t FilterBatch::add(const IpPredicate& predicate) {
+    predicates_.push_back(predicate);
+    return predicates_.size() - 1;
+}
+
+/**
+ * @brief Единственный проход по пулу
+ *
+ * Кусок пула (16 КиБ) проверяется всеми фильтрами подряд, пока он в L1:
+ * для каждого фильтра векторное ядро строит карту совпадений куска,
+ * номера отмеченных строк дописываются в буфер фильтра.
+ *
+ * Фильтры, сводящиеся к диапазонам адресов (диапазоны, префиксы из первых
+ * октетов, выражения с границами), на отсортированном пуле считаются заранее
+ * бинарным поиском и слиянием и в общем проходе не участвуют. Проверка порядка
+ * (один последовательный проход) нужна, только если такие фильтры есть.
+ * Так же в проходе не участвуют фильтры "октет в любой позиции", если есть индекс.
+ */
+std::vector<std::vector<uint32_t>> FilterBatch::matchRows(IpSpan ipPool, PoolOrder order,
+                                                          const IpIndex* index) const {
+    if (ipPool.size() > UINT32_MAX) {
+        // номера строк в буферах - uint32_t: вдвое меньше памяти на совпадения, чем size_t
+        throw std::length_error("Пул больше 2^32 строк: номера строк не помещаются в uint32_t");
+    }
+    std::vector<std::vector<uint32_t>> results(predicates_.size());
+    uint64_t bitmap[bitmapWords(kMatchChunk)];
+    std::vector<uint64_t> scratch;  // стек карт для выражений запросов
+
+    bool useOrder = std::any_of(predicates_.begin(), predicates_.end(), sliceable)
+                    && (order == PoolOrder::Sorted || std::is_sorted(ipPool.begin(), ipPool.end()));
+    std::vector<bool> done(predicates_.size(), false);
+    if (index != nullptr) {
+        // списки строк уже отсортированы по номеру - это и есть результат
+        for (size_t slot = 0; slot < predicates_.size(); ++slot) {
+            if (predicates_[slot].kind != IpPredicate::Kind::Any) continue;
+            results[slot] = index->any(predicates_[slot].byte);
+            done[slot] = true;
+        }
+    }
+    if (useOrder) {
+        for (size_t slot = 0; slot < predicates_.size(); ++slot) {
+            if (!sliceable(predicates_[slot])) continue;
+            matchSorted(predicates_[slot], ipPool, results[slot], bitmap, scratch);
+            done[slot] = true;
+        }
+    }
+    if (std::all_of(done.begin(), done.end(), [](bool d) { return d; })) {
+        return results;
+    }
+
+    for (size_t offset = 0; offset < ipPool.size(); offset += kMatchChunk) {
+        const IpAddress* chunk = ipPool.data() + offset;
+        size_t count = std::min(kMatchChunk, ipPool.size() - offset);
+
+        for (size_t slot = 0; slot < predicates_.size(); ++slot) {
+            const IpPredicate& predicate = predicates_[slot];
+            // префикс нулевой длины пропускает все адреса - буфер для него не нужен
+            if (predicate.matchesAll() || done[slot]) continue;
+
+            switch (predicate.kind) {
+                case IpPredicate::Kind::Any:
+                    matchAnyOctet(chunk, count, predicate.byte, bitmap);
+                    break;
+                case IpPredicate::Kind::Prefix:
+                    matchPrefix(chunk, count, PrefixMask{predicate.mask, predicate.value}, bitmap);
+                    break;
+                case IpPredicate::Kind::Ranges:
+                    matchRangeSet(chunk, count, *predicate.ranges, bitmap);
+                    break;
+                case IpPredicate::Kind::Query:
+                    predicate.program->match(chunk, count, bitmap, scratch);
+                    break;
+            }
+
+            appendRows(bitmap, count, offset, results[slot]);
+        }
+    }
+
+    return results;
+}
+
+std::vector<std::vector<IpAddress>> FilterBatch::match(IpSpan ipPool) const {
+    std::vector<std::vector<uint32_t>> rows = matchRows(ipPool);
+    std::vector<std::vector<IpAddress>> results(rows.size());
+    for (size_t slot = 0; slot < rows.size(); ++slot) {
+        results[slot].reserve(rows[slot].size());
+        for (uint32_t row : rows[slot]) {
+            results[slot].push_back(ipPool[row]);
+        }
+    }
+    return results;
+}
+
+/**
+ * @brief Проход по пулу и вывод буферов в порядке регистрации фильтров
+ */
+void FilterBatch::run(IpSpan ipPool, std::ostream& os, const IpIndex* index) const {
+    std::vector<std::vector<uint32_t>> results = matchRowsMeasured(*this, ipPool, index);
+    StageTimer stage("output");
+    OutputBuffer out(os);
+
+    for (size_t slot = 0; slot < predicates_.size(); ++slot) {
+        if (predicates_[slot].matchesAll()) {
+            for (const auto& ip : ipPool) {
+                out.append(ip);
+            }
+            continue;
+        }
+        for (uint32_t row : results[slot]) {
+            out.append(ipPool[row]);
+        }
+    }
+    out.flush();
+    stage.finish(outputRows(*this, results, ipPool.size()), out.written());
+}
+
+/**
+ * @brief Секции по порядку; адресов IPv6 обычно мало, они проверяются поэлементно
+ */
+void FilterBatch::run(IpSpan ipPool, const std::vector<Ip6Address>& ip6Pool, std::ostream& os) const {
+    std::vector<std::vector<uint32_t>> results = matchRowsMeasured(*this, ipPool, nullptr);
+    StageTimer stage("output");
+    OutputBuffer out(os);
+
+    for (size_t slot = 0; slot < predicates_.size(); ++slot) {
+        const IpPredicate& predicate = predicates_[slot];
+        if (predicate.matchesAll()) {
+            for (const auto& ip : ipPool) {
+                out.append(ip);
+            }
+        } else {
+            for (uint32_t row : results[slot]) {
+                out.append(ipPool[row]);
+            }
+        }
+        for (const auto& ip : ip6Pool) {
+            if (predicate.matchesAll() || predicate.matches(ip)) {
+                out.append(ip);
+            }
+        }
+    }
+    out.flush();
+    stage.finish(0, out.written());
+}
+
+/**
+ * @brief То же, что run, но после каждого адреса выводится его счетчик (и сумма)
+ */
+void FilterBatch::runCounted(IpSpan ipPool, const uint64_t* counts, std::ostream& os,
+                             const int64_t* sums, const IpIndex* index) const {
+    std::vector<std::vector<uint32_t>> results = matchRowsMeasured(*this, ipPool, index);
+    StageTimer stage("output");
+    OutputBuffer out(os);
+    auto emit = [&](size_t row) {
+        if (sums != nullptr) {
+            out.appendAggregated(ipPool[row], counts[row], sums[row]);
+        } else {
+            out.appendCounted(ipPool[row], counts[row]);
+        }
+    };
+
+    for (size_t slot = 0; slot < predicates_.size(); ++slot) {
+        if (predicates_[slot].matchesAll()) {
+            for (size_t row = 0; row < ipPool.size(); ++row) {
+                emit(row);
+            }
+            continue;
+        }
+        for (uint32_t row : results[slot]) {
+            emit(row);
+        }
+    }
+    out.flush();
+    stage.finish(outputRows(*this, results, ipPool.size()), out.written());
+}
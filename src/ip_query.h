@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+#include "ip_expr.h"
+#include "ip_range.h"
+
+class IpIndex;
+
+/**
+ * @brief Один фильтр пакета: префикс октетов (как checkOctets), октет в любой позиции
+ * (как contains), набор диапазонов адресов (CIDR, блоклист) или выражение запроса (-q)
+ */
+struct IpPredicate {
+    enum class Kind {
+        Prefix,  ///< (key & mask) == value
+        Any,     ///< хотя бы один октет равен byte
+        Ranges,  ///< адрес попадает в один из диапазонов ranges
+        Query    ///< выполняется выражение program
+    };
+
+    Kind kind = Kind::Prefix;
+    uint32_t mask = 0;   ///< маска префикса над IpAddress::key()
+    uint32_t value = 0;  ///< значение префикса
+    uint8_t byte = 0;    ///< искомый октет для Kind::Any
+    std::shared_ptr<const RangeSet> ranges;  ///< диапазоны для Kind::Ranges (общие для копий фильтра)
+    std::shared_ptr<const QueryProgram> program;  ///< байт-код для Kind::Query
+
+    /**
+     * @brief Фильтр, пропускающий все адреса (полный вывод пула)
+     */
+    static IpPredicate all() { return IpPredicate(); }
+
+    /**
+     * @brief Фильтр по первым октетам: prefix(46, 70) - адреса 46.70.*.*
+     */
+    template<typename... Args>
+    static IpPredicate prefix(Args... args) {
+        static_assert(sizeof...(args) <= 4, "Too many arguments for IP address (max 4 octets)");
+        const uint8_t octets[] = {static_cast<uint8_t>(args)..., 0};
+        return prefixOf(octets, sizeof...(args));
+    }
+
+    /**
+     * @brief Фильтр по первым count октетам из массива
+     */
+    static IpPredicate prefixOf(const uint8_t* octets, size_t count);
+
+    /**
+     * @brief Фильтр "октет value в любой позиции"
+     */
+    static IpPredicate any(uint8_t value);
+
+    /**
+     * @brief Фильтр по одному диапазону: range(parseCidr("10.0.0.0/12"))
+     */
+    static IpPredicate range(const AddressRange& range);
+
+    /**
+     * @brief Фильтр по набору диапазонов (например, блоклисту)
+     */
+    static IpPredicate rangeSet(RangeSet ranges);
+
+    /**
+     * @brief Фильтр по выражению запроса: query("o1==46 && o2==70")
+     *
+     * Выражение из одного условия превращается в обычный фильтр (префикс,
+     * октет в любой позиции, диапазон) и вычисляется теми же ядрами, что
+     * и --filter/--any/--cidr. Остальные выполняются байт-кодом QueryProgram.
+     *
+     * @throws std::invalid_argument если выражение некорректно
+     */
+    static IpPredicate query(std::string_view text);
+
+    /**
+     * @brief Пропускает ли фильтр все адреса (префикс нулевой длины)
+     */
+    bool matchesAll() const { return kind == Kind::Prefix && mask == 0; }
+
+    bool matches(const IpAddress& ip) const {
+        switch (kind) {
+            case Kind::Prefix: return (ip.key() & mask) == value;
+            case Kind::Any: return ip.contains(byte);
+            case Kind::Ranges: return ranges->contains(ip);
+            case Kind::Query: return program->matches(ip);
+        }
+        return false;
+    }
+
+    /**
+     * @brief Проверка адреса IPv6
+     *
+     * Все фильтры заданы над адресами IPv4, поэтому проверяется только
+     * отображенный адрес ::ffff:a.b.c.d - как вложенный IPv4. Остальные адреса
+     * IPv6 пропускает лишь фильтр "все" (matchesAll).
+     */
+    bool matches(const Ip6Address& ip) const {
+        if (matchesAll()) return true;
+        IpAddress v4(0, 0, 0, 0);
+        return mappedIpv4(ip, v4) && matches(v4);
+    }
+};
+
+/**
+ * @brief Что известно о порядке пула до прохода
+ */
+enum class PoolOrder {
+    Unknown,  ///< Порядок проверяется одним проходом, если он может пригодиться
+    Sorted    ///< Пул отсортирован по IpAddress::operator< (например, загружен сервером)
+};
+
+/**
+ * @brief Пакет фильтров, вычисляемых за один проход по пулу
+ *
+ * Вместо N полных проходов (по одному на filter/filter_any) пул читается
+ * один раз, кусками, помещающимися в L1: каждый кусок проверяется всеми
+ * фильтрами векторными ядрами (ip_match.h), совпадения дописываются
+ * в буфер своего фильтра. В конце буферы выводятся в порядке
+ * регистрации фильтров, так что вывод совпадает с последовательным вызовом фильтров.
+ *
+ * Фильтры по диапазонам на отсортированном пуле (обычный случай) вычисляются
+ * не поэлементно, а слиянием пула с набором диапазонов (RangeSet::matchRows).
+ * Если к пулу есть IpIndex, фильтры "октет в любой позиции" берутся из его
+ * списков строк (IpIndex::any), O(k) вместо прохода по пулу.
+ */
+class FilterBatch {
+public:
+    /**
+     * @brief Зарегистрировать фильтр
+     * @return Номер фильтра в пакете
+     */
+    size_t add(const IpPredicate& predicate);
+
+    size_t size() const { return predicates_.size(); }
+
+    const std::vector<IpPredicate>& predicates() const { return predicates_; }
+
+    /**
+     * @brief Один проход по пулу: совпадения для каждого фильтра
+     *
+     * Для фильтров, пропускающих все адреса, буфер не заполняется -
+     * их результат и есть сам пул.
+     *
+     * @param ipPool Пул адресов
+     * @return Для каждого фильтра - найденные адреса в порядке пула
+     */
+    std::vector<std::vector<IpAddress>> match(IpSpan ipPool) const;
+
+    /**
+     * @brief То же, что match, но результат - номера строк пула (по возрастанию)
+     *
+     * @param order PoolOrder::Sorted - пул заведомо отсортирован, проверка порядка не нужна
+     * @param index Индекс по тому же пулу (nullptr - без него)
+     * @throws std::length_error если в пуле больше 2^32 - 1 строк (match и run - тоже)
+     */
+    std::vector<std::vector<uint32_t>> matchRows(IpSpan ipPool, PoolOrder order = PoolOrder::Unknown,
+                                                 const IpIndex* index = nullptr) const;
+
+    /**
+     * @brief Один проход по пулу и вывод результатов всех фильтров по порядку
+     *
+     * @param ipPool Пул адресов
+     * @param os Поток вывода (адрес на строку)
+     * @param index Индекс по тому же пулу (nullptr - без него), см. matchRows
+     */
+    void run(IpSpan ipPool, std::ostream& os, const IpIndex* index = nullptr) const;
+
+    /**
+     * @brief Вывод для смешанного журнала: в каждой секции сначала IPv4, затем IPv6
+     *
+     * @param ipPool Отсортированный пул IPv4
+     * @param ip6Pool Отсортированный пул IPv6
+     * @param os Поток вывода
+     */
+    void run(IpSpan ipPool, const std::vector<Ip6Address>& ip6Pool, std::ostream& os) const;
+
+    /**
+     * @brief То же, что run, но каждая строка - "адрес<TAB>счетчик" (или "адрес<TAB>счетчик<TAB>сумма")
+     *
+     * @param ipPool Пул адресов
+     * @param counts Счетчик для каждой строки пула (ipPool.size() значений)
+     * @param os Поток вывода
+     * @param sums Сумма столбца для каждой строки пула (nullptr - не выводить)
+     * @param index Индекс по тому же пулу (nullptr - без него), см. matchRows
+     */
+    void runCounted(IpSpan ipPool, const uint64_t* counts, std::ostream& os,
+                    const int64_t* sums = nullptr, const IpIndex* index = nullptr) const;
+
+private:
+    std::vector<IpPredicate> predicates_;
+};
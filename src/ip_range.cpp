@@ -0,0 +1,187 @@
+/**
+ * @file ip_range.cpp
+ * @brief Запросы по CIDR и диапазонам адресов на отсортированном пуле
+ */
+
+#include "ip_range.h"
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+std::invalid_argument badRange(std::string_view spec) {
+    return std::invalid_argument("Неверный формат диапазона адресов: " + std::string(spec));
+}
+
+/**
+ * @brief Запись без пробелов и табуляций по краям
+ */
+std::string_view trim(std::string_view s) {
+    size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) return {};
+    size_t last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+/**
+ * @brief Первая позиция в [from, end), где pred ложен (pred монотонен: истина, затем ложь)
+ *
+ * Сначала шаги 1, 2, 4, ... от from, затем бинарный поиск в найденном окне:
+ * O(log d), где d - расстояние до ответа. Для слияния, где соседние
+ * ответы близки, это дешевле бинарного поиска по всему остатку.
+ */
+template<typename Pred>
+const IpAddress* gallop(const IpAddress* from, const IpAddress* end, Pred pred) {
+    size_t step = 1;
+    const IpAddress* lo = from;
+    while (static_cast<size_t>(end - lo) > step && pred(lo[step - 1])) {
+        lo += step;
+        step *= 2;
+    }
+    const IpAddress* hi = lo + std::min(step, static_cast<size_t>(end - lo));
+    return std::partition_point(lo, hi, pred);
+}
+
+} // namespace
+
+// ============================================================================
+// РАЗБОР
+// ============================================================================
+
+/**
+ * @brief "a.b.c.d/len" -> [a.b.c.d, a.b.c.d | ~mask]
+ *
+ * Адрес с битами за пределами префикса ("10.0.0.1/8") считается ошибкой:
+ * скорее всего, это опечатка в блоклисте, а не намерение.
+ */
+AddressRange parseCidr(std::string_view spec) {
+    size_t slash = spec.find('/');
+    if (slash == std::string_view::npos) {
+        throw badRange(spec);
+    }
+    std::string_view lenStr = spec.substr(slash + 1);
+    unsigned len = 0;
+    auto [ptr, ec] = std::from_chars(lenStr.data(), lenStr.data() + lenStr.size(), len);
+    if (ec != std::errc() || ptr != lenStr.data() + lenStr.size() || lenStr.empty() || len > 32) {
+        throw badRange(spec);
+    }
+
+    uint32_t base = parseIp(spec.substr(0, slash)).key();
+    uint32_t hostMask = len == 0 ? ~0u : (len == 32 ? 0u : ~0u >> len);
+    if ((base & hostMask) != 0) {
+        throw std::invalid_argument("Адрес сети содержит биты вне префикса: " + std::string(spec));
+    }
+    return {base, base | hostMask};
+}
+
+AddressRange parseRange(std::string_view spec) {
+    size_t dash = spec.find('-');
+    if (dash == std::string_view::npos) {
+        throw badRange(spec);
+    }
+    AddressRange range{parseIp(trim(spec.substr(0, dash))).key(), parseIp(trim(spec.substr(dash + 1))).key()};
+    if (range.first > range.last) {
+        throw std::invalid_argument("Начало диапазона больше конца: " + std::string(spec));
+    }
+    return range;
+}
+
+AddressRange parseAddressRange(std::string_view spec) {
+    if (spec.find('/') != std::string_view::npos) {
+        return parseCidr(spec);
+    }
+    if (spec.find('-') != std::string_view::npos) {
+        return parseRange(spec);
+    }
+    uint32_t key = parseIp(spec).key();
+    return {key, key};
+}
+
+// ============================================================================
+// ЗАПРОСЫ К ОТСОРТИРОВАННОМУ ПУЛУ
+// ============================================================================
+
+/**
+ * @brief Два бинарных поиска: пул идет по убыванию, поэтому сначала адреса
+ * больше range.last, затем искомые, затем меньше range.first
+ */
+RowRange rangeRows(IpSpan sortedPool, const AddressRange& range) {
+    auto begin = sortedPool.begin();
+    auto first = std::partition_point(begin, sortedPool.end(),
+        [&](const IpAddress& ip) { return ip.key() > range.last; });
+    auto last = std::partition_point(first, sortedPool.end(),
+        [&](const IpAddress& ip) { return ip.key() >= range.first; });
+
+    return {static_cast<size_t>(first - begin), static_cast<size_t>(last - begin)};
+}
+
+// ============================================================================
+// RangeSet
+// ============================================================================
+
+/**
+ * @brief Нормализация: сортировка по началу и склейка пересекающихся и смежных отрезков
+ */
+RangeSet::RangeSet(std::vector<AddressRange> ranges) {
+    std::sort(ranges.begin(), ranges.end(),
+              [](const AddressRange& a, const AddressRange& b) { return a.first < b.first; });
+
+    for (const auto& range : ranges) {
+        // смежный отрезок: last + 1 == first (без переполнения при last == 255.255.255.255)
+        if (!ranges_.empty() && (ranges_.back().last == ~0u || range.first <= ranges_.back().last + 1)) {
+            ranges_.back().last = std::max(ranges_.back().last, range.last);
+        } else {
+            ranges_.push_back(range);
+        }
+    }
+}
+
+RangeSet RangeSet::parse(std::string_view text) {
+    std::vector<AddressRange> ranges;
+    size_t lineNumber = 0;
+
+    while (!text.empty()) {
+        size_t eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+        ++lineNumber;
+
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        try {
+            ranges.push_back(parseAddressRange(line));
+        } catch (const std::invalid_argument& e) {
+            throw std::invalid_argument("строка " + std::to_string(lineNumber) + ": " + e.what());
+        }
+    }
+    return RangeSet(std::move(ranges));
+}
+
+/**
+ * @brief Последний отрезок с началом не больше key - единственный кандидат
+ */
+bool RangeSet::contains(uint32_t key) const {
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), key,
+                               [](uint32_t k, const AddressRange& r) { return k < r.first; });
+    return it != ranges_.begin() && key <= std::prev(it)->last;
+}
+
+void RangeSet::matchRows(IpSpan sortedPool, std::vector<uint32_t>& rows) const {
+    const IpAddress* begin = sortedPool.data();
+    const IpAddress* end = begin + sortedPool.size();
+    const IpAddress* pos = begin;
+
+    for (auto range = ranges_.rbegin(); range != ranges_.rend() && pos != end; ++range) {
+        const uint32_t first = range->first;
+        const uint32_t last = range->last;
+        pos = gallop(pos, end, [last](const IpAddress& ip) { return ip.key() > last; });
+        const IpAddress* stop = gallop(pos, end, [first](const IpAddress& ip) { return ip.key() >= first; });
+        for (; pos != stop; ++pos) {
+            rows.push_back(static_cast<uint32_t>(pos - begin));
+        }
+    }
+}
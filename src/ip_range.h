@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "ip_address.h"
+#include "ip_index.h"
+
+/**
+ * @brief Диапазон адресов [first, last] над IpAddress::key() (границы включены)
+ */
+struct AddressRange {
+    uint32_t first = 0;
+    uint32_t last = 0;
+
+    bool contains(uint32_t key) const { return key >= first && key <= last; }
+};
+
+/**
+ * @brief Разбор CIDR "a.b.c.d/len"
+ *
+ * @param spec Строка вида "10.0.0.0/12" (длина префикса 0-32)
+ * @return Диапазон адресов сети
+ * @throws std::invalid_argument если формат неверный или в адресе есть биты вне префикса
+ */
+AddressRange parseCidr(std::string_view spec);
+
+/**
+ * @brief Разбор диапазона "a.b.c.d-e.f.g.h" (границы включены)
+ *
+ * @throws std::invalid_argument если формат неверный или начало больше конца
+ */
+AddressRange parseRange(std::string_view spec);
+
+/**
+ * @brief Разбор любой записи: CIDR, диапазон через '-' или одиночный адрес
+ *
+ * @throws std::invalid_argument если формат неверный
+ */
+AddressRange parseAddressRange(std::string_view spec);
+
+/**
+ * @brief Строки отсортированного пула, попадающие в диапазон
+ *
+ * Пул отсортирован по убыванию ключа, поэтому адреса диапазона идут подряд
+ * и находятся двумя бинарными поисками.
+ *
+ * @param sortedPool Пул, отсортированный по IpAddress::operator<
+ * @param range Диапазон адресов
+ * @return Диапазон строк, O(log n)
+ */
+RowRange rangeRows(IpSpan sortedPool, const AddressRange& range);
+
+/**
+ * @brief Набор диапазонов (например, блоклист) для массовых запросов
+ *
+ * При построении диапазоны сортируются, пересекающиеся и смежные склеиваются,
+ * так что набор - это возрастающая последовательность непересекающихся отрезков.
+ * Проверка одного адреса - бинарный поиск, O(log m); все совпадения
+ * отсортированного пула - слияние двух упорядоченных последовательностей.
+ */
+class RangeSet {
+public:
+    RangeSet() = default;
+    explicit RangeSet(std::vector<AddressRange> ranges);
+
+    /**
+     * @brief Разбор списка диапазонов: запись на строку
+     *
+     * Запись - CIDR, диапазон или адрес (как в parseAddressRange). Пустые
+     * строки и комментарии от '#' до конца строки пропускаются, пробелы по краям
+     * записи игнорируются.
+     *
+     * @throws std::invalid_argument с номером строки, если запись некорректна
+     */
+    static RangeSet parse(std::string_view text);
+
+    bool contains(uint32_t key) const;
+    bool contains(const IpAddress& ip) const { return contains(ip.key()); }
+
+    /**
+     * @brief Номера строк отсортированного пула, попадающих в набор
+     *
+     * Слияние: отрезки перебираются по убыванию, навстречу пулу, а границы
+     * каждого ищутся от текущей позиции экспоненциальным поиском. Итого
+     * O(m log(n/m)) сравнений вместо O(n log m) при проверке каждого адреса.
+     *
+     * @param sortedPool Пул, отсортированный по IpAddress::operator<
+     * @param rows Вектор, в который добавляются номера строк (по возрастанию)
+     */
+    void matchRows(IpSpan sortedPool, std::vector<uint32_t>& rows) const;
+
+    const std::vector<AddressRange>& ranges() const { return ranges_; }
+    size_t size() const { return ranges_.size(); }
+    bool empty() const { return ranges_.empty(); }
+
+private:
+    std::vector<AddressRange> ranges_;  ///< по возрастанию, без пересечений и стыков
+};
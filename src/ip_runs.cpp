@@ -0,0 +1,61 @@
+/**
+ * @file ip_runs.cpp
+ * @brief Отсортированные серии пула: слияние и выбор серий для уплотнения
+ */
+
+#include "ip_runs.h"
+#include "ip_sort.h"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace {
+
+// Во сколько раз серия должна быть больше всех более новых вместе взятых
+constexpr size_t kRunGrowth = 2;
+
+} // namespace
+
+SortedRun makeRun(std::vector<IpAddress> batch) {
+    radixSort(batch.data(), batch.data() + batch.size());
+    return std::make_shared<const AddressRun>(std::move(batch));
+}
+
+std::vector<IpAddress> mergeSorted(IpSpan left, IpSpan right) {
+    std::vector<IpAddress> merged;
+    merged.reserve(left.size() + right.size());
+    std::merge(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(merged));
+    return merged;
+}
+
+std::vector<IpAddress> mergeSorted(std::vector<IpSpan> runs) {
+    if (runs.empty()) {
+        return {};
+    }
+    // первый раунд читает исходные серии, следующие - собственные промежуточные векторы
+    std::vector<std::vector<IpAddress>> merged;
+    for (size_t i = 0; i < runs.size(); i += 2) {
+        merged.push_back(i + 1 < runs.size() ? mergeSorted(runs[i], runs[i + 1])
+                                             : std::vector<IpAddress>(runs[i].begin(), runs[i].end()));
+    }
+    while (merged.size() > 1) {
+        std::vector<std::vector<IpAddress>> next;
+        for (size_t i = 0; i < merged.size(); i += 2) {
+            next.push_back(i + 1 < merged.size() ? mergeSorted(merged[i], merged[i + 1]) : std::move(merged[i]));
+        }
+        merged = std::move(next);
+    }
+    return std::move(merged.front());
+}
+
+RowRange compactionRange(const std::vector<SortedRun>& runs) {
+    // слияние хвоста не меняет сумму более новых серий для предыдущих, поэтому
+    // сливается хвост от самой старой серии, нарушающей правило
+    size_t first = runs.size();
+    size_t tail = 0;  // размер серий после i
+    for (size_t i = runs.size(); i-- > 0;) {
+        if (runs[i]->size() < kRunGrowth * tail) first = i;
+        tail += runs[i]->size();
+    }
+    return {first, runs.size()};
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "ip_address.h"
+#include "ip_index.h"
+
+/**
+ * @brief Адреса серии: собственный вектор или чужая память, удерживаемая owner
+ *
+ * Второй вариант - пул снимка: адреса читаются прямо из отображения,
+ * а серия держит сам снимок, чтобы отображение жило столько же, сколько она.
+ *
+ * У серии есть индекс для запросов any N: индекс снимка (со списками строк
+ * из файла, если они сохранены) или собственный. Собственные списки строк
+ * (16 байт на адрес) строятся при первом запросе any к серии.
+ */
+class AddressRun {
+public:
+    explicit AddressRun(std::vector<IpAddress> addresses)
+        : storage_(std::move(addresses)), addresses_(storage_), ownIndex_(addresses_), index_(&ownIndex_) {}
+
+    /**
+     * @param index Индекс по addresses, живущий вместе с owner (nullptr - собственный)
+     */
+    AddressRun(IpSpan addresses, std::shared_ptr<const void> owner, const IpIndex* index = nullptr)
+        : addresses_(addresses), owner_(std::move(owner)), ownIndex_(addresses_),
+          index_(index != nullptr ? index : &ownIndex_) {}
+
+    AddressRun(const AddressRun&) = delete;
+    AddressRun& operator=(const AddressRun&) = delete;
+
+    size_t size() const { return addresses_.size(); }
+    bool empty() const { return addresses_.empty(); }
+    const IpAddress* begin() const { return addresses_.begin(); }
+    const IpAddress* end() const { return addresses_.end(); }
+    const IpAddress& operator[](size_t i) const { return addresses_[i]; }
+
+    operator IpSpan() const { return addresses_; }  // NOLINT: неявно, как у std::vector
+
+    const IpIndex& index() const { return *index_; }
+
+private:
+    std::vector<IpAddress> storage_;  ///< Пусто, если адреса принадлежат owner_
+    IpSpan addresses_;
+    std::shared_ptr<const void> owner_;
+    IpIndex ownIndex_;
+    const IpIndex* index_;
+};
+
+/**
+ * @brief Серия: отсортированный (IpAddress::operator<) неизменяемый кусок пула
+ *
+ * Серии общие для всех версий набора, в которые входят: новая версия
+ * копирует указатели, а не адреса.
+ */
+using SortedRun = std::shared_ptr<const AddressRun>;
+
+/**
+ * @brief Отсортировать новую порцию адресов и оформить ее как серию
+ */
+SortedRun makeRun(std::vector<IpAddress> batch);
+
+/**
+ * @brief Слияние двух отсортированных пулов за линейное время
+ */
+std::vector<IpAddress> mergeSorted(IpSpan left, IpSpan right);
+
+/**
+ * @brief Слияние нескольких отсортированных пулов
+ *
+ * Раунды попарного слияния соседей: O(n log k) для k пулов общим размером n.
+ */
+std::vector<IpAddress> mergeSorted(std::vector<IpSpan> runs);
+
+/**
+ * @brief Какие серии слить, чтобы набор оставался логарифмическим (LSM)
+ *
+ * Серии идут от старых к новым. Правило: каждая серия хотя бы вдвое больше
+ * всех следующих вместе взятых. Новая порция добавляется в конец; если правило
+ * нарушено, хвост начиная с самой старой "слишком маленькой" серии сливается в одну.
+ * Тогда серий не больше log2(n / порция) + 1, а каждый адрес за все время
+ * переписывается O(log n) раз - вместо полной сортировки на каждую порцию.
+ *
+ * @param runs Серии от старых к новым
+ * @return Номера сливаемых серий [first, last); пусто - правило выполняется
+ */
+RowRange compactionRange(const std::vector<SortedRun>& runs);
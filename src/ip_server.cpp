@@ -0,0 +1,750 @@
+/**
+ * @file ip_server.cpp
+ * @brief Сервер запросов к пулу через Unix-сокет: epoll, рабочие потоки, подмена пула
+ */
+
+#include "ip_server.h"
+#include "ip_format.h"
+#include "ip_input.h"
+#include "ip_parallel.h"
+#include "ip_query.h"
+#include "ip_snapshot.h"
+#include "options.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Сколько байтов читать из сокета за вызов
+constexpr size_t kReadChunk = 64 * 1024;
+
+// Запрос длиннее - ошибка клиента, а не повод копить память
+constexpr size_t kMaxRequest = 64 * 1024;
+
+// Сколько ждать, пока клиент освободит место в сокете; дольше - клиент не читает ответ
+constexpr int kWriteTimeoutMs = 10 * 1000;
+
+// Ответ копится до этого размера и уходит в сокет: память на запрос не зависит от размера ответа
+constexpr size_t kReplyBuffer = 64 * 1024;
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Слишком длинный путь сокета: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+/**
+ * @brief Освободить путь под новый сокет
+ *
+ * Удаляется только файл-сокет, к которому никто не принимает подключения
+ * (остался от упавшего сервера). Обычный файл (--serve ./data.tsv) или
+ * сокет работающего сервера - ошибка, а не молчаливая замена.
+ */
+void removeStaleSocket(const std::string& path, const sockaddr_un& address) {
+    struct stat info{};
+    if (::lstat(path.c_str(), &info) != 0) {
+        return;  // пути нет - удалять нечего
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        throw std::runtime_error("Путь сокета занят файлом, который не является сокетом: " + path);
+    }
+    int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) {
+        throw systemError("Не удалось создать сокет");
+    }
+    const bool live = ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    ::close(probe);
+    if (live) {
+        throw std::runtime_error("Сокет " + path + " уже обслуживает другой сервер");
+    }
+    ::unlink(path.c_str());
+}
+
+/**
+ * @brief Записать все байты; неблокирующий сокет ждет готовности через poll
+ *
+ * Ожидание ограничено kWriteTimeoutMs: клиент, переставший читать, иначе
+ * навсегда занял бы рабочий поток (а с --workers 1 - весь сервер).
+ *
+ * @return false, если клиент закрыл соединение или не читает ответ
+ */
+bool writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t written = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written > 0) {
+            data.remove_prefix(static_cast<size_t>(written));
+            continue;
+        }
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd ready{fd, POLLOUT, 0};
+            int polled = ::poll(&ready, 1, kWriteTimeoutMs);
+            if (polled == 0) return false;
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Сигналы завершения сервера
+ */
+sigset_t stopSignals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    return signals;
+}
+
+/**
+ * @brief Запретить сигналы завершения в служебном потоке - их принимает цикл событий
+ */
+void blockStopSignals() {
+    sigset_t signals = stopSignals();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+} // namespace
+
+// ============================================================================
+// ReplyWriter
+// ============================================================================
+
+/**
+ * @brief Ответ на запрос: в сокет порциями не больше kReplyBuffer или в память
+ *
+ * Строки ответа не собираются целиком - query all на большом пуле иначе
+ * держал бы весь отформатированный пул (~16 байт на строку) на каждый
+ * одновременный запрос. Если клиент перестал принимать ответ, остальной
+ * текст отбрасывается, а ok() становится false.
+ */
+class ReplyWriter {
+public:
+    /**
+     * @param fd Сокет клиента; -1 - копить ответ в памяти (PoolServer::handle)
+     */
+    explicit ReplyWriter(int fd) : fd_(fd) {}
+
+    void append(std::string_view text) {
+        text_.append(text);
+        if (fd_ >= 0 && text_.size() >= kReplyBuffer) flush();
+    }
+
+    /**
+     * @brief Адрес и перевод строки
+     */
+    void append(const IpAddress& ip) {
+        char line[kMaxIpTextLength + 8];  // запас, как у OutputBuffer
+        size_t length = formatIp(ip, line);
+        line[length++] = '\n';
+        append(std::string_view(line, length));
+    }
+
+    /**
+     * @brief Отправить накопленное (для ответа в память - ничего не делает)
+     * @return false, если клиент закрыл соединение или не читает ответ
+     */
+    bool flush() {
+        if (fd_ < 0) return true;
+        ok_ = ok_ && writeAll(fd_, text_);
+        text_.clear();
+        return ok_;
+    }
+
+    bool ok() const { return ok_; }
+
+    /**
+     * @brief Ответ, накопленный в памяти
+     */
+    std::string take() { return std::move(text_); }
+
+private:
+    int fd_;
+    std::string text_;
+    bool ok_ = true;
+};
+
+namespace {
+
+std::string describePool(const ServedPool& pool) {
+    return "OK rows=" + std::to_string(pool.rows()) + " runs=" + std::to_string(pool.runs.size())
+           + " generation=" + std::to_string(pool.generation) + " source=" + pool.source + "\n";
+}
+
+/**
+ * @brief Отсортированная серия из журнала или снимка
+ *
+ * Снимок уже отсортирован: серия читает адреса прямо из его отображения
+ * и держит снимок открытым, пока жива сама.
+ */
+SortedRun loadRun(const PoolSource& source) {
+    if (!source.snapshot.empty()) {
+        auto snapshot = std::make_shared<const Snapshot>(Snapshot::open(source.snapshot));
+        return std::make_shared<const AddressRun>(snapshot->pool(), snapshot, &snapshot->index());
+    }
+    InputBuffer input = InputBuffer::fromFile(source.inputPath);
+    if (source.threads > 1) {
+        return std::make_shared<const AddressRun>(parseAndSortParallel(input.view(), source.threads));
+    }
+    std::vector<IpAddress> addresses;
+    readIpAddresses(input.view(), addresses);
+    return makeRun(std::move(addresses));
+}
+
+/**
+ * @brief Ответ на фильтр: строки пула или только их число
+ *
+ * Серии отсортированы заранее, поэтому префиксы, диапазоны и запросы
+ * с границами считаются бинарным поиском без проверки порядка, а any N -
+ * по спискам строк индекса серии. Совпадения
+ * серий сливаются - вывод тот же, что у одного отсортированного пула.
+ */
+void answerFilter(const ServedPool& pool, const IpPredicate& predicate, bool countOnly, ReplyWriter& out) {
+    FilterBatch batch;
+    batch.add(predicate);
+    std::vector<std::vector<IpAddress>> matched;
+    std::vector<IpSpan> spans;
+    size_t count = 0;
+    for (const SortedRun& run : pool.runs) {
+        if (predicate.matchesAll()) {
+            spans.emplace_back(*run);
+            count += run->size();
+            continue;
+        }
+        std::vector<uint32_t> rows = std::move(batch.matchRows(*run, PoolOrder::Sorted, &run->index())[0]);
+        count += rows.size();
+        if (countOnly) continue;
+        std::vector<IpAddress> addresses;
+        addresses.reserve(rows.size());
+        for (uint32_t row : rows) {
+            addresses.push_back((*run)[row]);
+        }
+        matched.push_back(std::move(addresses));
+    }
+
+    if (!countOnly) {
+        for (const auto& addresses : matched) {
+            spans.emplace_back(addresses);
+        }
+        // одна серия выводится как есть, несколько - через слияние
+        std::vector<IpAddress> merged;
+        if (spans.size() > 1) {
+            merged = mergeSorted(spans);
+        }
+        IpSpan output = spans.size() == 1 ? spans[0] : IpSpan(merged);
+        for (size_t i = 0; i < output.size() && out.ok(); ++i) {
+            out.append(output[i]);
+        }
+    }
+    out.append("OK " + std::to_string(count) + "\n");
+}
+
+} // namespace
+
+// ============================================================================
+// ЗАГРУЗКА
+// ============================================================================
+
+size_t ServedPool::rows() const {
+    size_t total = 0;
+    for (const auto& run : runs) {
+        total += run->size();
+    }
+    return total;
+}
+
+std::shared_ptr<ServedPool> loadServedPool(const PoolSource& source) {
+    auto pool = std::make_shared<ServedPool>();
+    pool->runs.push_back(loadRun(source));
+    pool->source = source.snapshot.empty() ? source.inputPath : source.snapshot;
+    return pool;
+}
+
+// ============================================================================
+// PoolServer
+// ============================================================================
+
+PoolServer::PoolServer(std::string socketPath, PoolSource source, unsigned workers)
+    : socketPath_(std::move(socketPath)), source_(std::move(source)) {
+    auto pool = loadServedPool(source_);
+    pool->generation = 1;
+    publish(std::move(pool));
+
+    const sockaddr_un address = socketAddress(socketPath_);
+    removeStaleSocket(socketPath_, address);
+    try {
+        listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0) {
+            throw systemError("Не удалось создать сокет");
+        }
+        // сокет 0600: reload/append открывают файлы с правами сервера, поэтому
+        // подключаться может только его владелец (umask - до bind, без окна между bind и chmod)
+        const mode_t previousMask = ::umask(0177);
+        const int bound = ::bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+        ::umask(previousMask);
+        bound_ = bound == 0;
+        if (bound < 0 || ::listen(listenFd_, SOMAXCONN) < 0) {
+            throw systemError("Не удалось открыть сокет " + socketPath_);
+        }
+
+        epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        stopFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd_ < 0 || stopFd_ < 0) {
+            throw systemError("Не удалось создать epoll");
+        }
+        // служебные дескрипторы помечаются адресом своего поля, соединения - адресом Connection
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = &listenFd_;
+        ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &event);
+        event.data.ptr = &stopFd_;
+        ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, stopFd_, &event);
+
+        for (unsigned i = 0; i < std::max(1u, workers); ++i) {
+            workers_.emplace_back(&PoolServer::workerLoop, this);
+        }
+        compactor_ = std::thread(&PoolServer::compactionLoop, this);
+    } catch (...) {
+        // деструктор не вызовется: уже открытое закрывается здесь, файл сокета удаляется
+        release();
+        throw;
+    }
+}
+
+PoolServer::~PoolServer() {
+    release();
+}
+
+/**
+ * @brief Остановить потоки, закрыть дескрипторы и удалить файл сокета
+ *
+ * Работает и с частично построенным сервером (ошибка в конструкторе):
+ * пропускает потоки, которые не запущены, и дескрипторы, которые не открыты.
+ */
+void PoolServer::release() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        stopping_ = true;
+    }
+    queueReady_.notify_all();
+    compactionReady_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    if (compactor_.joinable()) {
+        compactor_.join();
+    }
+    for (auto& [fd, connection] : connections_) {
+        ::close(fd);
+    }
+    for (int fd : {stopFd_, epollFd_, listenFd_}) {
+        if (fd >= 0) ::close(fd);
+    }
+    if (bound_) {
+        ::unlink(socketPath_.c_str());
+    }
+}
+
+void PoolServer::publish(std::shared_ptr<ServedPool> pool) {
+    std::atomic_store(&pool_, std::shared_ptr<const ServedPool>(std::move(pool)));
+}
+
+void PoolServer::stop() {
+    uint64_t one = 1;
+    ssize_t written = ::write(stopFd_, &one, sizeof(one));
+    (void)written;  // счетчик eventfd уже ненулевой - цикл и так проснется
+}
+
+/**
+ * @brief Цикл событий: новые соединения и данные от клиентов
+ *
+ * SIGINT/SIGTERM принимаются через signalfd тем же epoll_wait, чтобы сервер
+ * завершался так же, как по запросу shutdown, и удалял файл сокета.
+ */
+void PoolServer::run() {
+    sigset_t signals = stopSignals();
+    sigset_t previous;
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    int signalFd = ::signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd < 0) {
+        // иначе заблокированные SIGINT/SIGTERM не завершили бы сервер
+        std::runtime_error error = systemError("Не удалось создать signalfd");
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+        throw error;
+    }
+    epoll_event signalEvent{};
+    signalEvent.events = EPOLLIN;
+    signalEvent.data.ptr = &signalFd;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, signalFd, &signalEvent);
+
+    epoll_event events[64];
+    bool running = true;
+    while (running) {
+        int ready = ::epoll_wait(epollFd_, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            throw systemError("Ошибка epoll_wait");
+        }
+        for (int i = 0; i < ready; ++i) {
+            const epoll_event& event = events[i];
+            if (event.data.ptr == &signalFd) {
+                // сигнал забирается из очереди, иначе он сработает после восстановления маски
+                signalfd_siginfo info;
+                ssize_t received = ::read(signalFd, &info, sizeof(info));
+                (void)received;
+                running = false;
+            } else if (event.data.ptr == &stopFd_) {
+                running = false;
+            } else if (event.data.ptr == &listenFd_) {
+                accept();
+            } else {
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex_);
+                    queue_.push_back(static_cast<Connection*>(event.data.ptr));
+                }
+                queueReady_.notify_one();
+            }
+        }
+    }
+
+    ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, signalFd, nullptr);
+    ::close(signalFd);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+void PoolServer::accept() {
+    for (;;) {
+        int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;  // EAGAIN - все ожидающие приняты
+
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = connection.get();
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex_);
+            connections_[fd] = std::move(connection);
+        }
+        ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+void PoolServer::workerLoop() {
+    blockStopSignals();
+    for (;;) {
+        Connection* connection = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueReady_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            connection = queue_.front();
+            queue_.pop_front();
+        }
+        serve(connection);
+    }
+}
+
+/**
+ * @brief Дочитать доступные данные, ответить на все целые запросы и снова ждать
+ *
+ * Последняя строка без '\n' перед закрытием записи клиентом - тоже запрос.
+ */
+void PoolServer::serve(Connection* connection) {
+    bool closed = false;
+    char chunk[kReadChunk];
+    for (;;) {
+        ssize_t received = ::recv(connection->fd, chunk, sizeof(chunk), 0);
+        if (received > 0) {
+            connection->input.append(chunk, static_cast<size_t>(received));
+            continue;
+        }
+        if (received < 0 && errno == EINTR) continue;
+        closed = received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+        break;
+    }
+
+    size_t begin = 0;
+    ReplyWriter reply(connection->fd);
+    for (size_t eol; (eol = connection->input.find('\n', begin)) != std::string::npos; begin = eol + 1) {
+        std::string_view line(connection->input.data() + begin, eol - begin);
+        respond(line, reply);
+        if (!reply.flush()) {
+            // клиент не принимает ответ - остальные запросы не обслуживаются
+            close(connection);
+            return;
+        }
+    }
+    connection->input.erase(0, begin);
+    if (closed && !connection->input.empty()) {
+        respond(connection->input, reply);
+        reply.flush();
+    }
+    if (!closed && connection->input.size() > kMaxRequest) {
+        reply.append("ERR Слишком длинный запрос\n");
+        reply.flush();
+        closed = true;
+    }
+
+    if (closed) {
+        close(connection);
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.ptr = connection;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+/**
+ * @brief Убрать соединение из таблицы, затем закрыть дескриптор
+ *
+ * Порядок важен: после ::close accept() может получить тот же номер fd и
+ * записать под ним новое соединение, которое erase по номеру уничтожил бы.
+ */
+void PoolServer::close(Connection* connection) {
+    const int fd = connection->fd;
+    std::unique_ptr<Connection> owned;  // освобождается после закрытия fd
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        auto it = connections_.find(fd);
+        owned = std::move(it->second);
+        connections_.erase(it);
+    }
+    ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+}
+
+std::string PoolServer::handle(std::string_view request) {
+    ReplyWriter reply(-1);
+    respond(request, reply);
+    return reply.take();
+}
+
+/**
+ * @brief Разбор строки запроса; ошибки разбора и загрузки - ответ "ERR", а не исключение
+ */
+void PoolServer::respond(std::string_view request, ReplyWriter& out) {
+    if (!request.empty() && request.back() == '\r') request.remove_suffix(1);
+    try {
+        auto takeWord = [&request]() {
+            size_t start = request.find_first_not_of(' ');
+            request.remove_prefix(std::min(start, request.size()));
+            size_t end = std::min(request.find(' '), request.size());
+            std::string_view word = request.substr(0, end);
+            request.remove_prefix(end);
+            size_t rest = request.find_first_not_of(' ');
+            request.remove_prefix(std::min(rest, request.size()));
+            return word;
+        };
+
+        std::string_view command = takeWord();
+        if (command == "info") {
+            out.append(describePool(*pool()));
+            return;
+        }
+        if (command == "shutdown") {
+            stop();
+            out.append("OK\n");
+            return;
+        }
+        if (command == "reload") {
+            PoolSource source = source_;
+            if (!request.empty()) {
+                source.inputPath = std::string(request);
+                source.snapshot.clear();
+            }
+            // пул строится без блокировки читателей; мьютекс только упорядочивает писателей
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            auto fresh = loadServedPool(source);
+            fresh->generation = pool()->generation + 1;
+            out.append(describePool(*fresh));
+            publish(std::move(fresh));
+            return;
+        }
+
+        if (command == "append") {
+            if (request.empty()) {
+                throw std::invalid_argument("append требует файла");
+            }
+            out.append(append(std::string(request)));
+            return;
+        }
+
+        bool countOnly = command == "count";
+        if (countOnly) {
+            command = takeWord();
+        }
+        if (command.empty()) {
+            throw std::invalid_argument("Пустой запрос");
+        }
+        IpPredicate predicate = parseFilter(command, request);
+        // снимок указателя держит свою версию пула, даже если ее подменят во время ответа
+        std::shared_ptr<const ServedPool> current = pool();
+        answerFilter(*current, predicate, countOnly, out);
+    } catch (const std::exception& e) {
+        std::string message = e.what();
+        std::replace(message.begin(), message.end(), '\n', ' ');
+        out.append("ERR " + message + "\n");
+    }
+}
+
+/**
+ * @brief Новая порция - отдельная серия: O(b log b) на сортировку вместо O(n log n)
+ *
+ * Порция разбирается и сортируется до блокировки писателей; под блокировкой
+ * только копируется список указателей на серии. Слияние серий - дело фонового потока.
+ */
+std::string PoolServer::append(const std::string& path) {
+    SortedRun run = loadRun({path, "", source_.threads});
+    std::string reply;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        auto next = std::make_shared<ServedPool>(*pool());
+        if (!run->empty()) {
+            next->runs.push_back(run);
+        }
+        ++next->generation;
+        reply = describePool(*next);
+        publish(std::move(next));
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        compactionPending_ = true;
+    }
+    compactionReady_.notify_one();
+    return reply;
+}
+
+void PoolServer::compactionLoop() {
+    blockStopSignals();
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            compactionReady_.wait(lock, [this] { return stopping_ || compactionPending_; });
+            if (stopping_) return;
+            compactionPending_ = false;
+        }
+        while (compactOnce()) {
+        }
+    }
+}
+
+/**
+ * @brief Слияние вне блокировок, затем замена серий, если их не успели сменить
+ *
+ * append только дописывает серии в конец, поэтому слитые серии остаются на
+ * своих местах; после reload их уже нет - результат выбрасывается и шаг
+ * повторяется на новой версии.
+ */
+bool PoolServer::compactOnce() {
+    std::shared_ptr<const ServedPool> current = pool();
+    RowRange range = compactionRange(current->runs);
+    if (range.size() < 2) {
+        return false;
+    }
+    std::vector<IpSpan> spans;
+    for (size_t i = range.first; i < range.last; ++i) {
+        spans.emplace_back(*current->runs[i]);
+    }
+    SortedRun merged = std::make_shared<const AddressRun>(mergeSorted(spans));
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    std::shared_ptr<const ServedPool> latest = pool();
+    bool unchanged = latest->runs.size() >= range.last
+                     && std::equal(current->runs.begin() + range.first, current->runs.begin() + range.last,
+                                   latest->runs.begin() + range.first);
+    if (!unchanged) {
+        return true;
+    }
+    auto next = std::make_shared<ServedPool>(*latest);
+    next->runs.erase(next->runs.begin() + range.first, next->runs.begin() + range.last);
+    next->runs.insert(next->runs.begin() + range.first, merged);
+    publish(std::move(next));
+    return true;
+}
+
+// ============================================================================
+// ServerClient
+// ============================================================================
+
+ServerClient::ServerClient(const std::string& socketPath) {
+    const sockaddr_un address = socketAddress(socketPath);
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0 || ::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        std::runtime_error error = systemError("Не удалось подключиться к " + socketPath);
+        if (fd_ >= 0) ::close(fd_);
+        throw error;
+    }
+}
+
+ServerClient::~ServerClient() {
+    ::close(fd_);
+}
+
+ServerReply ServerClient::request(std::string_view line) {
+    std::string message(line);
+    message += '\n';
+    if (!writeAll(fd_, message)) {
+        throw std::runtime_error("Сервер закрыл соединение");
+    }
+
+    ServerReply reply;
+    std::string row;
+    while (readLine(row)) {
+        if (row.compare(0, 2, "OK") == 0) {
+            reply.ok = true;
+            reply.status = row.size() > 3 ? row.substr(3) : std::string();
+            return reply;
+        }
+        if (row.compare(0, 4, "ERR ") == 0) {
+            reply.status = row.substr(4);
+            return reply;
+        }
+        reply.data += row;
+        reply.data += '\n';
+    }
+    throw std::runtime_error("Сервер закрыл соединение");
+}
+
+bool ServerClient::readLine(std::string& line) {
+    for (;;) {
+        size_t eol = buffer_.find('\n', pos_);
+        if (eol != std::string::npos) {
+            line.assign(buffer_, pos_, eol - pos_);
+            pos_ = eol + 1;
+            return true;
+        }
+        buffer_.erase(0, pos_);
+        pos_ = 0;
+
+        char chunk[kReadChunk];
+        ssize_t received = ::recv(fd_, chunk, sizeof(chunk), 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        buffer_.append(chunk, static_cast<size_t>(received));
+    }
+}
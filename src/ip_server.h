@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ip_address.h"
+#include "ip_runs.h"
+
+/**
+ * @brief Версия пула сервера: набор отсортированных серий, после публикации не меняется
+ *
+ * Загрузка дает одну серию, каждый append - еще одну; уплотнение сливает
+ * хвост серий (compactionRange). Запрос проверяет каждую серию и сливает
+ * совпадения, так что ответ - в порядке полностью отсортированного пула.
+ */
+struct ServedPool {
+    std::vector<SortedRun> runs;  ///< Серии от старых к новым
+    std::string source;           ///< Откуда загружен: файл журнала или снимок
+    uint64_t generation = 0;      ///< Номер версии данных (1 - первая загрузка, растет при reload и append)
+
+    size_t rows() const;
+};
+
+/**
+ * @brief Источник пула сервера
+ */
+struct PoolSource {
+    std::string inputPath;  ///< Журнал: разбор и сортировка
+    std::string snapshot;   ///< Снимок --save-index: пул уже отсортирован
+    unsigned threads = 1;   ///< Потоки разбора и сортировки журнала
+};
+
+/**
+ * @brief Ответ сервера на запрос, отправляемый порциями (ip_server.cpp)
+ */
+class ReplyWriter;
+
+/**
+ * @brief Загрузить и отсортировать пул: одна серия
+ *
+ * @throws std::runtime_error если файл не удалось прочитать
+ * @throws std::invalid_argument если в журнале есть некорректный адрес
+ */
+std::shared_ptr<ServedPool> loadServedPool(const PoolSource& source);
+
+/**
+ * @brief Сервер запросов к одному пулу через Unix-сокет
+ *
+ * Пул загружается и сортируется один раз, дальше каждый запрос - бинарный
+ * поиск и проход по нужным строкам, без повторного разбора.
+ *
+ * Протокол текстовый, запрос - строка, ответ - строки результата и итоговая
+ * строка "OK ..." или "ERR сообщение":
+ *   filter A[.B[.C[.D]]] | any N | cidr A.B.C.D/LEN | range A-B | query EXPR | blocklist FILE
+ *                          адреса, затем "OK <число>"
+ *   count <фильтр>         только "OK <число>"
+ *   info                   "OK rows=<n> runs=<серий> generation=<g> source=<путь>"
+ *   reload [FILE]          перечитать источник (или FILE) и подменить пул, ответ как у info
+ *   append FILE            добавить адреса из FILE: сортируется только новая порция, она
+ *                          становится отдельной серией; ответ как у info
+ *   shutdown               "OK", сервер завершается
+ *
+ * Потоки: цикл событий (epoll) принимает соединения и ждет данных, сами
+ * запросы выполняет пул рабочих потоков. Соединение зарегистрировано с
+ * EPOLLONESHOT, поэтому его обслуживает не больше одного потока за раз, а
+ * ответы идут в порядке запросов.
+ *
+ * Подмена пула (reload, append, уплотнение) в стиле RCU: новая версия строится
+ * в стороне и публикуется атомарной заменой shared_ptr. Запрос берет снимок
+ * указателя в начале и работает со своей версией до конца; старая версия
+ * освобождается, когда ее отпускает последний такой запрос. Читатели не блокируются.
+ *
+ * Уплотнение серий идет в отдельном фоновом потоке после каждого append:
+ * слияние - вне блокировок, под блокировкой писателей только замена указателей.
+ *
+ * Доступ: reload FILE и append FILE открывают любой путь с правами процесса
+ * сервера, поэтому файл сокета создается с правами 0600 - подключиться может
+ * только владелец.
+ */
+class PoolServer {
+public:
+    /**
+     * @param socketPath Путь сокета (сокет, оставшийся от завершенного сервера, заменяется)
+     * @param source Источник пула; загружается в конструкторе
+     * @param workers Число рабочих потоков
+     * @throws std::runtime_error если пул или сокет не удалось подготовить, путь занят
+     *         обычным файлом или на сокете уже работает другой сервер
+     */
+    PoolServer(std::string socketPath, PoolSource source, unsigned workers);
+    ~PoolServer();
+
+    PoolServer(const PoolServer&) = delete;
+    PoolServer& operator=(const PoolServer&) = delete;
+
+    /**
+     * @brief Цикл событий до запроса shutdown, stop() или SIGINT/SIGTERM
+     */
+    void run();
+
+    /**
+     * @brief Завершить run() (из любого потока)
+     */
+    void stop();
+
+    /**
+     * @brief Текущий пул; остается действительным, пока указатель удерживается
+     */
+    std::shared_ptr<const ServedPool> pool() const { return std::atomic_load(&pool_); }
+
+    /**
+     * @brief Атомарно подменить пул, не дожидаясь выполняющихся запросов
+     */
+    void publish(std::shared_ptr<ServedPool> pool);
+
+    /**
+     * @brief Ответ на одну строку запроса (без сокета - для тестов и рабочих потоков)
+     */
+    std::string handle(std::string_view request);
+
+    /**
+     * @brief Один шаг уплотнения: слить хвост серий, если он нарушает правило compactionRange
+     *
+     * Вызывается фоновым потоком; тесты вызывают его напрямую, чтобы не ждать.
+     *
+     * @return true, если пул изменился (возможно, нужен следующий шаг)
+     */
+    bool compactOnce();
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string input;  ///< Принятые байты незавершенного запроса
+    };
+
+    void accept();
+    void serve(Connection* connection);
+    void close(Connection* connection);
+    void workerLoop();
+    void compactionLoop();
+    void release();
+    void respond(std::string_view request, ReplyWriter& out);
+    std::string append(const std::string& path);
+
+    std::string socketPath_;
+    PoolSource source_;
+    std::shared_ptr<const ServedPool> pool_;  ///< Только через std::atomic_load/atomic_store
+    std::mutex writeMutex_;                   ///< Писатели пула (reload, append, уплотнение) - по одному
+
+    int listenFd_ = -1;
+    int epollFd_ = -1;
+    int stopFd_ = -1;  ///< eventfd: stop() будит цикл событий
+    bool bound_ = false;  ///< Файл сокета создан этим сервером (удаляется при завершении)
+
+    std::vector<std::thread> workers_;
+    std::mutex queueMutex_;
+    std::condition_variable queueReady_;
+    std::deque<Connection*> queue_;  ///< Соединения с данными, ждущие рабочего потока
+    bool stopping_ = false;
+
+    std::thread compactor_;
+    std::condition_variable compactionReady_;  ///< Под queueMutex_
+    bool compactionPending_ = false;
+
+    std::mutex connectionsMutex_;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+};
+
+/**
+ * @brief Ответ сервера на один запрос
+ */
+struct ServerReply {
+    bool ok = false;
+    std::string data;    ///< Строки результата (адреса), пусто для count/info
+    std::string status;  ///< Текст после "OK " или сообщение после "ERR "
+};
+
+/**
+ * @brief Клиент PoolServer: запросы по одному соединению, ответы по порядку
+ */
+class ServerClient {
+public:
+    /**
+     * @throws std::runtime_error если сервер недоступен
+     */
+    explicit ServerClient(const std::string& socketPath);
+    ~ServerClient();
+
+    ServerClient(const ServerClient&) = delete;
+    ServerClient& operator=(const ServerClient&) = delete;
+
+    /**
+     * @brief Отправить запрос и дождаться ответа целиком
+     * @throws std::runtime_error если соединение оборвалось
+     */
+    ServerReply request(std::string_view line);
+
+private:
+    bool readLine(std::string& line);
+
+    int fd_ = -1;
+    std::string buffer_;  ///< Принятые, но еще не разобранные байты
+    size_t pos_ = 0;
+};
@@ -0,0 +1,492 @@
+/**
+ * @file ip_snapshot.cpp
+ * @brief Двоичный снимок отсортированного пула: запись и загрузка через mmap
+ */
+
+#include "ip_snapshot.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'I', 'P', 'F', 'S', 'N', 'A', 'P', '\0'};
+
+// Версия формата: меняется при любом несовместимом изменении раскладки.
+// Снимок с чужим порядком байт тоже отвергается по версии (0x01000000 вместо 1).
+constexpr uint32_t kSnapshotVersion = 1;
+
+enum SnapshotFlags : uint32_t {
+    kHasCounts = 1u << 0,
+    kHasPostings = 1u << 1,
+    kDistinct = 1u << 2,
+};
+
+/**
+ * @brief Заголовок снимка (первые 64 байта файла)
+ */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t count;            ///< Число адресов
+    uint64_t countsOffset;     ///< Смещение счетчиков (0 - нет)
+    uint64_t postingsOffset;   ///< Смещение списков строк (0 - нет)
+    uint64_t fileSize;         ///< Полный размер файла
+    uint64_t payloadChecksum;  ///< Контрольная сумма всего после заголовка
+    uint64_t headerChecksum;   ///< Контрольная сумма предыдущих полей заголовка
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "SnapshotHeader layout must be stable");
+
+constexpr size_t kHeaderSize = sizeof(SnapshotHeader);
+constexpr size_t kAddressesOffset = kHeaderSize;
+
+std::runtime_error snapshotError(const std::string& path, const std::string& what) {
+    return std::runtime_error("Снимок " + path + ": " + what);
+}
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Таблица границ списков: по каждой позиции неубывает и не выходит за 4 * count строк
+ */
+bool validPostingOffsets(const unsigned char* section, uint64_t count) {
+    const auto* offsets = reinterpret_cast<const uint32_t*>(section);
+    for (size_t position = 0; position < 4; ++position) {
+        const uint32_t* bounds = offsets + position * 257;
+        for (size_t v = 0; v < 257; ++v) {
+            if (bounds[v] > 4 * count || (v > 0 && bounds[v] < bounds[v - 1])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Все номера строк в списках меньше count
+ */
+bool validPostingRows(const unsigned char* section, uint64_t count) {
+    const auto* rows = reinterpret_cast<const uint32_t*>(section) + IpIndex::kPostingOffsets;
+    uint32_t top = 0;
+    for (uint64_t i = 0; i < 4 * count; ++i) {
+        top = std::max(top, rows[i]);
+    }
+    return count == 0 || top < count;
+}
+
+// ============================================================================
+// КОНТРОЛЬНАЯ СУММА
+// ============================================================================
+
+/**
+ * @brief Потоковая 64-битная контрольная сумма в духе xxHash64
+ *
+ * Четыре независимые дорожки по 8 байт: умножения разных дорожек
+ * выполняются параллельно, поэтому проверка снимка упирается в чтение памяти,
+ * а не в цепочку зависимостей одного аккумулятора.
+ */
+class Checksum {
+public:
+    void update(const void* data, size_t size) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        total_ += size;
+
+        if (buffered_ > 0) {
+            size_t take = std::min(size, sizeof(buffer_) - buffered_);
+            std::memcpy(buffer_ + buffered_, p, take);
+            buffered_ += take;
+            p += take;
+            size -= take;
+            if (buffered_ < sizeof(buffer_)) return;
+            block(buffer_);
+            buffered_ = 0;
+        }
+        for (; size >= sizeof(buffer_); p += sizeof(buffer_), size -= sizeof(buffer_)) {
+            block(p);
+        }
+        std::memcpy(buffer_, p, size);
+        buffered_ = size;
+    }
+
+    uint64_t digest() const {
+        uint64_t h = total_ >= sizeof(buffer_)
+            ? rotl(lanes_[0], 1) + rotl(lanes_[1], 7) + rotl(lanes_[2], 12) + rotl(lanes_[3], 18)
+            : kPrime5;
+        h += total_;
+
+        size_t i = 0;
+        for (; i + 8 <= buffered_; i += 8) {
+            h ^= round(0, load(buffer_ + i));
+            h = rotl(h, 27) * kPrime1 + kPrime4;
+        }
+        for (; i < buffered_; ++i) {
+            h ^= buffer_[i] * kPrime5;
+            h = rotl(h, 11) * kPrime1;
+        }
+
+        h ^= h >> 33;
+        h *= kPrime2;
+        h ^= h >> 29;
+        h *= kPrime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static constexpr uint64_t kPrime1 = 11400714785074694791ull;
+    static constexpr uint64_t kPrime2 = 14029467366897019727ull;
+    static constexpr uint64_t kPrime3 = 1609587929392839161ull;
+    static constexpr uint64_t kPrime4 = 9650029242287828579ull;
+    static constexpr uint64_t kPrime5 = 2870177450012600261ull;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static uint64_t load(const unsigned char* p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * kPrime2;
+        return rotl(acc, 31) * kPrime1;
+    }
+
+    void block(const unsigned char* p) {
+        for (int lane = 0; lane < 4; ++lane) {
+            lanes_[lane] = round(lanes_[lane], load(p + 8 * lane));
+        }
+    }
+
+    uint64_t lanes_[4] = {kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1};
+    unsigned char buffer_[32] = {};
+    size_t buffered_ = 0;
+    uint64_t total_ = 0;
+};
+
+uint64_t headerChecksum(const SnapshotHeader& header) {
+    Checksum sum;
+    sum.update(&header, offsetof(SnapshotHeader, headerChecksum));
+    return sum.digest();
+}
+
+// ============================================================================
+// ЗАПИСЬ
+// ============================================================================
+
+/**
+ * @brief Секция файла: смещение и байты
+ */
+struct Section {
+    size_t offset;
+    const void* data;
+    size_t size;
+};
+
+/**
+ * @brief Каталог файла: для fsync после rename
+ */
+std::string parentDirectory(const std::string& path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+/**
+ * @brief Файл, записываемый под временным именем и переименовываемый в конце
+ *
+ * Временное имя уникально (mkstemp в том же каталоге), поэтому одновременные
+ * записи одного снимка не портят друг другу файл - побеждает последний rename.
+ * Перед rename данные сбрасываются на диск, после - запись каталога: после
+ * сбоя по пути лежит либо прежний снимок, либо новый целиком.
+ */
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path) : path_(path), tmpPath_(path + ".XXXXXX") {
+        int fd = ::mkstemp(tmpPath_.data());
+        if (fd < 0) {
+            throw systemError("Не удалось создать файл " + tmpPath_);
+        }
+        // mkstemp создает файл 0600; снимок получает обычные права с учетом umask
+        const mode_t mask = ::umask(0);
+        ::umask(mask);
+        ::fchmod(fd, 0666 & ~mask);
+        file_ = ::fdopen(fd, "wb");
+        if (file_ == nullptr) {
+            std::runtime_error error = systemError("Не удалось создать файл " + tmpPath_);
+            ::close(fd);
+            std::remove(tmpPath_.c_str());
+            throw error;
+        }
+    }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    ~SnapshotWriter() {
+        if (file_ != nullptr) {
+            std::fclose(file_);
+            std::remove(tmpPath_.c_str());
+        }
+    }
+
+    void write(const void* data, size_t size) {
+        if (size > 0 && std::fwrite(data, 1, size, file_) != size) {
+            throw systemError("Ошибка записи снимка " + tmpPath_);
+        }
+    }
+
+    void commit() {
+        std::FILE* file = std::exchange(file_, nullptr);
+        const bool synced = std::fflush(file) == 0 && ::fsync(::fileno(file)) == 0;
+        if (std::fclose(file) != 0 || !synced) {
+            std::runtime_error error = systemError("Ошибка записи снимка " + tmpPath_);
+            std::remove(tmpPath_.c_str());
+            throw error;
+        }
+        if (std::rename(tmpPath_.c_str(), path_.c_str()) != 0) {
+            std::runtime_error error = systemError("Не удалось переименовать " + tmpPath_ + " в " + path_);
+            std::remove(tmpPath_.c_str());
+            throw error;
+        }
+        const std::string directory = parentDirectory(path_);
+        int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0 || ::fsync(dirFd) != 0) {
+            std::runtime_error error = systemError("Не удалось сбросить на диск каталог " + directory);
+            if (dirFd >= 0) ::close(dirFd);
+            throw error;
+        }
+        ::close(dirFd);
+    }
+
+private:
+    std::string path_;
+    std::string tmpPath_;
+    std::FILE* file_ = nullptr;
+};
+
+} // namespace
+
+/**
+ * @brief Раскладка секций, контрольная сумма по тем же байтам, что попадут в файл, запись
+ */
+void saveSnapshot(const std::string& path, const SnapshotData& data) {
+    const size_t count = data.pool.size();
+    if (data.postings != nullptr && count >= (size_t{1} << 30)) {
+        throw std::runtime_error("Слишком большой пул для сохранения списков строк: " + std::to_string(count));
+    }
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kSnapshotVersion;
+    header.count = count;
+
+    Section sections[4];
+    size_t sectionCount = 0;
+    size_t offset = kAddressesOffset;
+    sections[sectionCount++] = {offset, data.pool.data(), count * sizeof(IpAddress)};
+    offset += count * sizeof(IpAddress);
+
+    if (data.counts != nullptr) {
+        offset = alignUp(offset, alignof(uint64_t));
+        header.flags |= kHasCounts;
+        header.countsOffset = offset;
+        sections[sectionCount++] = {offset, data.counts, count * sizeof(uint64_t)};
+        offset += count * sizeof(uint64_t);
+    }
+    if (data.postings != nullptr) {
+        header.flags |= kHasPostings;
+        header.postingsOffset = offset;
+        sections[sectionCount++] = {offset, data.postings->postingOffsets(),
+                                    IpIndex::kPostingOffsets * sizeof(uint32_t)};
+        offset += IpIndex::kPostingOffsets * sizeof(uint32_t);
+        sections[sectionCount++] = {offset, data.postings->postingRows(), 4 * count * sizeof(uint32_t)};
+        offset += 4 * count * sizeof(uint32_t);
+    }
+    if (data.distinct) {
+        header.flags |= kDistinct;
+    }
+    header.fileSize = offset;
+
+    // между секциями могут быть байты выравнивания - они нулевые и тоже входят в сумму
+    static const char kZeros[8] = {};
+    Checksum payload;
+    size_t position = kHeaderSize;
+    for (size_t i = 0; i < sectionCount; ++i) {
+        payload.update(kZeros, sections[i].offset - position);
+        payload.update(sections[i].data, sections[i].size);
+        position = sections[i].offset + sections[i].size;
+    }
+    header.payloadChecksum = payload.digest();
+    header.headerChecksum = headerChecksum(header);
+
+    SnapshotWriter writer(path);
+    writer.write(&header, sizeof(header));
+    position = kHeaderSize;
+    for (size_t i = 0; i < sectionCount; ++i) {
+        writer.write(kZeros, sections[i].offset - position);
+        writer.write(sections[i].data, sections[i].size);
+        position = sections[i].offset + sections[i].size;
+    }
+    writer.commit();
+}
+
+// ============================================================================
+// ЗАГРУЗКА
+// ============================================================================
+
+/**
+ * @brief Отображение файла в память и проверка заголовка
+ *
+ * Все смещения проверяются до первого обращения к секциям, так что
+ * поврежденный или обрезанный файл дает ошибку, а не чтение за концом отображения.
+ */
+Snapshot Snapshot::open(const std::string& path, bool verify) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw systemError("Не удалось открыть файл " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw systemError("Не удалось прочитать файл " + path);
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (!S_ISREG(st.st_mode) || size < kHeaderSize) {
+        ::close(fd);
+        throw snapshotError(path, "файл не является снимком");
+    }
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw systemError("Не удалось отобразить файл " + path);
+    }
+
+    Snapshot snapshot;
+    snapshot.map_ = map;
+    snapshot.mapSize_ = size;
+
+    const auto* base = static_cast<const unsigned char*>(map);
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw snapshotError(path, "файл не является снимком");
+    }
+    if (header.version != kSnapshotVersion) {
+        throw snapshotError(path, "неподдерживаемая версия формата " + std::to_string(header.version));
+    }
+    if (header.headerChecksum != headerChecksum(header)) {
+        throw snapshotError(path, "заголовок поврежден");
+    }
+    if (header.fileSize != size) {
+        throw snapshotError(path, "размер файла не совпадает с заголовком (файл обрезан?)");
+    }
+
+    // границы секций: каждая внутри файла, на своем выравнивании. Смещения из
+    // заголовка сначала сравниваются с size, и только потом вычитаются из него,
+    // а длины секций делятся, а не умножаются - переполнения нет при любых значениях
+    const uint64_t count = header.count;
+    bool valid = count <= (size - kAddressesOffset) / sizeof(IpAddress);
+    uint64_t end = kAddressesOffset + count * sizeof(IpAddress);
+    if (valid && (header.flags & kHasCounts)) {
+        valid = header.countsOffset >= end && header.countsOffset <= size
+             && header.countsOffset % alignof(uint64_t) == 0
+             && count <= (size - header.countsOffset) / sizeof(uint64_t);
+        end = valid ? header.countsOffset + count * sizeof(uint64_t) : end;
+    }
+    if (valid && (header.flags & kHasPostings)) {
+        // номера строк - uint32_t, их 4 * count
+        valid = header.postingsOffset >= end && header.postingsOffset <= size
+             && header.postingsOffset % alignof(uint32_t) == 0
+             && count < (size_t{1} << 30)
+             && IpIndex::kPostingOffsets + 4 * count <= (size - header.postingsOffset) / sizeof(uint32_t);
+    }
+    if (!valid) {
+        throw snapshotError(path, "некорректные смещения секций");
+    }
+    if ((header.flags & kHasPostings) && !validPostingOffsets(base + header.postingsOffset, count)) {
+        throw snapshotError(path, "некорректная таблица списков строк");
+    }
+
+    if (verify) {
+        Checksum payload;
+        payload.update(base + kHeaderSize, size - kHeaderSize);
+        if (payload.digest() != header.payloadChecksum) {
+            throw snapshotError(path, "контрольная сумма не совпадает (файл поврежден)");
+        }
+        // сумму можно подделать вместе с файлом, поэтому номера строк проверяются отдельно
+        // (тем же полным проходом; без verify содержимое секций считается доверенным)
+        if ((header.flags & kHasPostings) && !validPostingRows(base + header.postingsOffset, count)) {
+            throw snapshotError(path, "номер строки вне пула");
+        }
+    }
+
+    snapshot.pool_ = IpSpan(reinterpret_cast<const IpAddress*>(base + kAddressesOffset), count);
+    snapshot.distinct_ = (header.flags & kDistinct) != 0;
+    if (header.flags & kHasCounts) {
+        snapshot.counts_ = reinterpret_cast<const uint64_t*>(base + header.countsOffset);
+    }
+    if (header.flags & kHasPostings) {
+        const auto* offsets = reinterpret_cast<const uint32_t*>(base + header.postingsOffset);
+        snapshot.index_ = std::make_unique<IpIndex>(snapshot.pool_, offsets, offsets + IpIndex::kPostingOffsets);
+        snapshot.postings_ = true;
+    } else {
+        snapshot.index_ = std::make_unique<IpIndex>(snapshot.pool_);
+    }
+    return snapshot;
+}
+
+// ============================================================================
+// ВЛАДЕНИЕ
+// ============================================================================
+
+Snapshot::Snapshot(Snapshot&& other) noexcept {
+    *this = std::move(other);
+}
+
+Snapshot& Snapshot::operator=(Snapshot&& other) noexcept {
+    if (this != &other) {
+        release();
+        map_ = std::exchange(other.map_, nullptr);
+        mapSize_ = std::exchange(other.mapSize_, 0);
+        pool_ = std::exchange(other.pool_, IpSpan());
+        counts_ = std::exchange(other.counts_, nullptr);
+        distinct_ = std::exchange(other.distinct_, false);
+        postings_ = std::exchange(other.postings_, false);
+        index_ = std::move(other.index_);
+    }
+    return *this;
+}
+
+Snapshot::~Snapshot() {
+    release();
+}
+
+void Snapshot::release() {
+    index_.reset();
+    if (map_ != nullptr) {
+        ::munmap(map_, mapSize_);
+    }
+    map_ = nullptr;
+    mapSize_ = 0;
+    pool_ = IpSpan();
+    counts_ = nullptr;
+    postings_ = false;
+}
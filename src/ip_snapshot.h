@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "ip_address.h"
+#include "ip_index.h"
+
+/**
+ * @brief Что записать в снимок
+ */
+struct SnapshotData {
+    IpSpan pool;                       ///< Пул, отсортированный по IpAddress::operator<
+    const uint64_t* counts = nullptr;  ///< Счетчик для каждой строки пула (nullptr - без счетчиков)
+    bool distinct = false;             ///< Адреса пула не повторяются
+    const IpIndex* postings = nullptr; ///< Индекс, списки строк которого сохранить (nullptr - без них)
+};
+
+/**
+ * @brief Запись снимка пула в файл
+ *
+ * Формат (порядок байт little-endian, версия kSnapshotVersion):
+ *   заголовок 64 байта: сигнатура, версия, флаги, число адресов, смещения
+ *                       секций, размер файла, контрольные суммы
+ *   адреса              по 4 байта, как IpAddress в памяти
+ *   счетчики            uint64_t на строку (если есть), выравнивание 8
+ *   списки строк        границы CSR и номера строк IpIndex (если есть)
+ *
+ * Файл пишется во временный с уникальным именем рядом, сбрасывается на диск
+ * и переименовывается (затем сбрасывается и каталог), поэтому ни читатель,
+ * ни одновременный писатель, ни сбой не оставят по пути недописанный снимок.
+ *
+ * @throws std::runtime_error при ошибке записи
+ */
+void saveSnapshot(const std::string& path, const SnapshotData& data);
+
+/**
+ * @brief Снимок, отображенный в память: запросы без разбора текста
+ *
+ * Адреса, счетчики и списки строк используются прямо из отображения,
+ * без копирования; страницы подгружаются ядром по мере обращения.
+ */
+class Snapshot {
+public:
+    /**
+     * @brief Открыть снимок
+     *
+     * Заголовок, границы секций и таблица границ списков строк проверяются
+     * всегда. Контрольная сумма содержимого и номера строк в списках (один
+     * последовательный проход по файлу) - если verify; без него содержимое
+     * секций считается доверенным.
+     *
+     * @throws std::runtime_error если файл не открывается, не является снимком,
+     *         имеет другую версию или поврежден
+     */
+    static Snapshot open(const std::string& path, bool verify = true);
+
+    Snapshot(Snapshot&& other) noexcept;
+    Snapshot& operator=(Snapshot&& other) noexcept;
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+    ~Snapshot();
+
+    IpSpan pool() const { return pool_; }
+
+    /**
+     * @brief Счетчики строк пула или nullptr, если снимок сохранен без них
+     */
+    const uint64_t* counts() const { return counts_; }
+
+    bool distinct() const { return distinct_; }
+
+    /**
+     * @brief Индекс по пулу снимка (со списками строк, если они сохранены)
+     */
+    const IpIndex& index() const { return *index_; }
+
+    /**
+     * @brief Сохранены ли в снимке списки строк (--index-postings)
+     */
+    bool hasPostings() const { return postings_; }
+
+private:
+    Snapshot() = default;
+    void release();
+
+    void* map_ = nullptr;
+    size_t mapSize_ = 0;
+    IpSpan pool_;
+    const uint64_t* counts_ = nullptr;
+    bool distinct_ = false;
+    bool postings_ = false;
+    std::unique_ptr<IpIndex> index_;
+};
@@ -0,0 +1,209 @@
+/**
+ * @file ip_sort.cpp
+ * @brief Поразрядная сортировка адресов
+ *
+ * Вместо сравнительной сортировки O(n log n) адреса сортируются как 32-битные
+ * ключи: гистограммы всех четырех байтов строятся за один проход,
+ * затем на каждый байт - один устойчивый проход раскладки.
+ */
+
+#include "ip_sort.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// На маленьких массивах подсчет по 256 корзинам дороже обычной сортировки
+constexpr size_t kRadixThreshold = 256;
+
+} // namespace
+
+/**
+ * @brief LSD radix sort ключей по убыванию
+ *
+ * Для убывания смещения корзин считаются от старшего значения байта (255) к младшему,
+ * раскладка устойчивая, поэтому порядок старших байтов сохраняет результат младших.
+ *
+ * @param keys Массив ключей
+ * @param count Количество ключей
+ */
+void radixSortKeysDescending(uint32_t* keys, size_t count) {
+    if (count < kRadixThreshold) {
+        std::sort(keys, keys + count, [](uint32_t a, uint32_t b) { return a > b; });
+        return;
+    }
+
+    // гистограммы всех 4 байтов за один проход
+    size_t histogram[4][256] = {};
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t k = keys[i];
+        ++histogram[0][k & 0xFF];
+        ++histogram[1][(k >> 8) & 0xFF];
+        ++histogram[2][(k >> 16) & 0xFF];
+        ++histogram[3][k >> 24];
+    }
+
+    std::vector<uint32_t> scratch(count);
+    uint32_t* src = keys;
+    uint32_t* dst = scratch.data();
+
+    for (int pass = 0; pass < 4; ++pass) {
+        const size_t* counts = histogram[pass];
+        unsigned shift = static_cast<unsigned>(pass * 8);
+
+        // все ключи в одной корзине - проход ничего не меняет
+        if (counts[(src[0] >> shift) & 0xFF] == count) continue;
+
+        size_t offsets[256];
+        size_t offset = 0;
+        for (int digit = 255; digit >= 0; --digit) {
+            offsets[digit] = offset;
+            offset += counts[digit];
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t k = src[i];
+            dst[offsets[(k >> shift) & 0xFF]++] = k;
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != keys) {
+        std::copy(src, src + count, keys);
+    }
+}
+
+/**
+ * @brief Сортировка адресов через массив ключей
+ *
+ * @param first Начало диапазона
+ * @param last Конец диапазона
+ */
+void radixSort(IpAddress* first, IpAddress* last) {
+    size_t count = static_cast<size_t>(last - first);
+    std::vector<uint32_t> keys(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = first[i].key();
+    }
+
+    radixSortKeysDescending(keys.data(), count);
+
+    for (size_t i = 0; i < count; ++i) {
+        first[i] = IpAddress::fromKey(keys[i]);
+    }
+}
+
+/**
+ * @brief LSD radix sort 128-битных ключей по убыванию
+ *
+ * Та же схема, что у radixSortKeysDescending: гистограммы всех байтов
+ * за один проход, затем устойчивая раскладка по каждому байту от младшего.
+ */
+void radixSort(Ip6Address* first, Ip6Address* last) {
+    size_t count = static_cast<size_t>(last - first);
+    std::vector<Uint128> keys(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = first[i].key();
+    }
+
+    if (count < kRadixThreshold) {
+        std::sort(keys.begin(), keys.end(), [](Uint128 a, Uint128 b) { return a > b; });
+    } else {
+        std::vector<size_t> histogram(16 * 256);
+        for (Uint128 k : keys) {
+            for (int pass = 0; pass < 16; ++pass) {
+                ++histogram[pass * 256 + static_cast<uint8_t>(k >> (8 * pass))];
+            }
+        }
+
+        std::vector<Uint128> scratch(count);
+        Uint128* src = keys.data();
+        Uint128* dst = scratch.data();
+        for (int pass = 0; pass < 16; ++pass) {
+            const size_t* counts = histogram.data() + pass * 256;
+            unsigned shift = static_cast<unsigned>(pass * 8);
+            if (counts[static_cast<uint8_t>(src[0] >> shift)] == count) continue;
+
+            size_t offsets[256];
+            size_t offset = 0;
+            for (int digit = 255; digit >= 0; --digit) {
+                offsets[digit] = offset;
+                offset += counts[digit];
+            }
+            for (size_t i = 0; i < count; ++i) {
+                Uint128 k = src[i];
+                dst[offsets[static_cast<uint8_t>(k >> shift)]++] = k;
+            }
+            std::swap(src, dst);
+        }
+        if (src != keys.data()) {
+            std::copy(src, src + count, keys.data());
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        first[i] = Ip6Address::fromKey(keys[i]);
+    }
+}
+
+/**
+ * @brief Поразрядная сортировка пар "ключ << 32 | строка" по байтам ключа
+ *
+ * Младшие 32 бита (номер строки) в проходах не участвуют, а раскладка
+ * устойчивая, поэтому равные ключи сохраняют возрастающий порядок строк.
+ */
+std::vector<uint32_t> radixSortOrder(const IpAddress* addresses, size_t count) {
+    if (count > UINT32_MAX) {
+        throw std::length_error("Больше 2^32 строк: номер строки не помещается в младшие 32 бита");
+    }
+    std::vector<uint64_t> items(count);
+    for (size_t i = 0; i < count; ++i) {
+        items[i] = static_cast<uint64_t>(addresses[i].key()) << 32 | i;
+    }
+
+    if (count < kRadixThreshold) {
+        std::stable_sort(items.begin(), items.end(),
+                         [](uint64_t a, uint64_t b) { return (a >> 32) > (b >> 32); });
+    } else {
+        size_t histogram[4][256] = {};
+        for (uint64_t item : items) {
+            uint32_t k = static_cast<uint32_t>(item >> 32);
+            ++histogram[0][k & 0xFF];
+            ++histogram[1][(k >> 8) & 0xFF];
+            ++histogram[2][(k >> 16) & 0xFF];
+            ++histogram[3][k >> 24];
+        }
+
+        std::vector<uint64_t> scratch(count);
+        uint64_t* src = items.data();
+        uint64_t* dst = scratch.data();
+        for (int pass = 0; pass < 4; ++pass) {
+            const size_t* counts = histogram[pass];
+            unsigned shift = static_cast<unsigned>(32 + pass * 8);
+            if (counts[(src[0] >> shift) & 0xFF] == count) continue;
+
+            size_t offsets[256];
+            size_t offset = 0;
+            for (int digit = 255; digit >= 0; --digit) {
+                offsets[digit] = offset;
+                offset += counts[digit];
+            }
+            for (size_t i = 0; i < count; ++i) {
+                uint64_t item = src[i];
+                dst[offsets[(item >> shift) & 0xFF]++] = item;
+            }
+            std::swap(src, dst);
+        }
+        if (src != items.data()) {
+            std::copy(src, src + count, items.data());
+        }
+    }
+
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = static_cast<uint32_t>(items[i]);
+    }
+    return order;
+}
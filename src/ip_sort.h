@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ip_address.h"
+
+/**
+ * @brief Поразрядная (LSD radix) сортировка 32-битных ключей по убыванию
+ *
+ * Четыре прохода подсчетом по байтам ключа, начиная с младшего.
+ * Проходы, в которых у всех ключей одинаковый байт, пропускаются.
+ *
+ * @param keys Массив ключей
+ * @param count Количество ключей
+ */
+void radixSortKeysDescending(uint32_t* keys, size_t count);
+
+/**
+ * @brief Сортировка адресов в обратном лексикографическом порядке (как IpAddress::operator<)
+ *
+ * Адреса упаковываются в компактный массив ключей IpAddress::key(),
+ * сортируются поразрядно за несколько линейных проходов и распаковываются обратно.
+ *
+ * @param first Начало диапазона
+ * @param last Конец диапазона
+ */
+void radixSort(IpAddress* first, IpAddress* last);
+
+/**
+ * @brief То же для адресов IPv6: 128-битные ключи, до 16 проходов по байтам
+ *
+ * Проходы по байтам, одинаковым у всех адресов (общий префикс сети,
+ * нулевые группы), пропускаются, поэтому типичный журнал сортируется
+ * за несколько проходов.
+ *
+ * @param first Начало диапазона
+ * @param last Конец диапазона
+ */
+void radixSort(Ip6Address* first, Ip6Address* last);
+
+/**
+ * @brief Перестановка строк, упорядочивающая адреса как IpAddress::operator<
+ *
+ * Для случаев, когда вместе с адресами нужно переставить связанные данные
+ * (столбцы строк): сортируются пары (ключ, номер строки) теми же проходами
+ * подсчетом. Сортировка устойчивая - строки с одинаковым адресом
+ * остаются в исходном порядке.
+ *
+ * @param addresses Адреса
+ * @param count Количество адресов (меньше 2^32)
+ * @return order: order[i] - номер строки, которая встает на место i
+ * @throws std::length_error если count не меньше 2^32
+ */
+std::vector<uint32_t> radixSortOrder(const IpAddress* addresses, size_t count);
@@ -0,0 +1,213 @@
+/**
+ * @file ip_stats.cpp
+ * @brief Замеры запуска для --stats: этапы, совпадения, память, выделения
+ */
+
+#include "ip_stats.h"
+#include <sys/resource.h>
+#include <atomic>
+#include <cstdio>
+#include <ostream>
+
+namespace {
+
+std::atomic<bool> gTrackAllocations{false};
+std::atomic<uint64_t> gAllocations{0};
+std::atomic<uint64_t> gAllocatedBytes{0};
+std::atomic<uint64_t> gParseErrors{0};
+
+/**
+ * @brief Пиковый размер резидентной памяти процесса в байтах
+ */
+uint64_t peakRssBytes() {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // в Linux ru_maxrss - в КиБ
+}
+
+double perSecond(uint64_t amount, double seconds) {
+    return seconds > 0 ? static_cast<double>(amount) / seconds : 0;
+}
+
+/**
+ * @brief Строка в кавычках JSON (имена этапов и фильтров - ASCII без управляющих символов,
+ * экранируются только кавычка и обратная косая черта)
+ */
+void writeJsonString(std::ostream& os, const std::string& text) {
+    os << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') os << '\\';
+        os << c;
+    }
+    os << '"';
+}
+
+/**
+ * @brief Число с фиксированной точностью без локали и научной записи
+ */
+std::string fixed(double value, int precision) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+    return buffer;
+}
+
+} // namespace
+
+// ============================================================================
+// ПОДСЧЕТ ВЫДЕЛЕНИЙ
+// ============================================================================
+
+void countAllocation(std::size_t bytes) noexcept {
+    if (gTrackAllocations.load(std::memory_order_relaxed)) {
+        gAllocations.fetch_add(1, std::memory_order_relaxed);
+        gAllocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+void countParseError() {
+    gParseErrors.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ============================================================================
+// RunStats
+// ============================================================================
+
+RunStats* RunStats::active_ = nullptr;
+
+RunStats::RunStats() : start_(std::chrono::steady_clock::now()) {}
+
+RunStats& RunStats::enable() {
+    if (active_ == nullptr) {
+        static RunStats instance;
+        active_ = &instance;
+        gTrackAllocations.store(true, std::memory_order_relaxed);
+    }
+    return *active_;
+}
+
+void RunStats::disable() {
+    active_ = nullptr;
+    gTrackAllocations.store(false, std::memory_order_relaxed);
+}
+
+void RunStats::reset() {
+    start_ = std::chrono::steady_clock::now();
+    stages_.clear();
+    filterNames_.clear();
+    filterMatches_.clear();
+    error_.clear();
+    gAllocations.store(0, std::memory_order_relaxed);
+    gAllocatedBytes.store(0, std::memory_order_relaxed);
+    gParseErrors.store(0, std::memory_order_relaxed);
+}
+
+void RunStats::addStage(std::string name, double seconds, uint64_t rows, uint64_t bytes) {
+    stages_.push_back({std::move(name), seconds, rows, bytes});
+}
+
+void RunStats::addMatches(const std::vector<IpPredicate>& predicates, const std::vector<uint64_t>& matches) {
+    if (filterNames_.empty()) {
+        for (const auto& predicate : predicates) {
+            filterNames_.push_back(describePredicate(predicate));
+        }
+        filterMatches_.assign(predicates.size(), 0);
+    }
+    for (size_t slot = 0; slot < matches.size() && slot < filterMatches_.size(); ++slot) {
+        filterMatches_[slot] += matches[slot];
+    }
+}
+
+void RunStats::report(std::ostream& os, StatsFormat format) const {
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start_;
+    uint64_t allocations = gAllocations.load(std::memory_order_relaxed);
+    uint64_t allocatedBytes = gAllocatedBytes.load(std::memory_order_relaxed);
+    uint64_t parseErrors = gParseErrors.load(std::memory_order_relaxed);
+
+    if (format == StatsFormat::Json) {
+        os << "{\"status\":";
+        writeJsonString(os, error_.empty() ? "ok" : "error");
+        os << ",\"wall_ms\":" << fixed(wall.count() * 1e3, 3)
+           << ",\"peak_rss_bytes\":" << peakRssBytes()
+           << ",\"allocations\":" << allocations
+           << ",\"allocated_bytes\":" << allocatedBytes
+           << ",\"parse_errors\":" << parseErrors
+           << ",\"stages\":[";
+        for (size_t i = 0; i < stages_.size(); ++i) {
+            const Stage& stage = stages_[i];
+            os << (i ? "," : "") << "{\"name\":";
+            writeJsonString(os, stage.name);
+            os << ",\"ms\":" << fixed(stage.seconds * 1e3, 3)
+               << ",\"rows\":" << stage.rows
+               << ",\"bytes\":" << stage.bytes
+               << ",\"rows_per_sec\":" << fixed(perSecond(stage.rows, stage.seconds), 0)
+               << ",\"bytes_per_sec\":" << fixed(perSecond(stage.bytes, stage.seconds), 0) << '}';
+        }
+        os << "],\"filters\":[";
+        for (size_t i = 0; i < filterNames_.size(); ++i) {
+            os << (i ? "," : "") << "{\"filter\":";
+            writeJsonString(os, filterNames_[i]);
+            os << ",\"matches\":" << filterMatches_[i] << '}';
+        }
+        os << ']';
+        if (!error_.empty()) {
+            // сообщение может быть не ASCII, но кавычки и '\' экранированы
+            os << ",\"error\":";
+            writeJsonString(os, error_);
+        }
+        os << "}\n";
+        return;
+    }
+
+    os << "--stats: " << fixed(wall.count() * 1e3, 1) << " мс, пиковый RSS "
+       << fixed(static_cast<double>(peakRssBytes()) / (1 << 20), 1) << " МиБ, выделений "
+       << allocations << " (" << fixed(static_cast<double>(allocatedBytes) / (1 << 20), 1)
+       << " МиБ), ошибок разбора " << parseErrors << '\n';
+    if (!stages_.empty()) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "  %-14s %10s %12s %14s %10s\n",
+                      "stage", "ms", "rows", "rows/s", "MB/s");
+        os << line;
+        for (const auto& stage : stages_) {
+            // "-" - счетчик для этапа не применим
+            std::string rows = stage.rows ? std::to_string(stage.rows) : "-";
+            std::string rate = stage.rows ? fixed(perSecond(stage.rows, stage.seconds), 0) : "-";
+            std::string mbps = stage.bytes ? fixed(perSecond(stage.bytes, stage.seconds) / 1e6, 1) : "-";
+            std::snprintf(line, sizeof(line), "  %-14s %10.1f %12s %14s %10s\n",
+                          stage.name.c_str(), stage.seconds * 1e3, rows.c_str(), rate.c_str(), mbps.c_str());
+            os << line;
+        }
+    }
+    for (size_t i = 0; i < filterNames_.size(); ++i) {
+        os << "  фильтр " << i + 1 << " (" << filterNames_[i] << "): " << filterMatches_[i] << '\n';
+    }
+    if (!error_.empty()) {
+        os << "  завершено с ошибкой: " << error_ << '\n';
+    }
+}
+
+// ============================================================================
+// ОПИСАНИЕ ФИЛЬТРОВ
+// ============================================================================
+
+std::string describePredicate(const IpPredicate& predicate) {
+    switch (predicate.kind) {
+        case IpPredicate::Kind::Prefix: {
+            if (predicate.matchesAll()) return "all";
+            std::string text = "prefix ";
+            for (int shift = 24; shift >= 0 && ((predicate.mask >> shift) & 0xFF) != 0; shift -= 8) {
+                if (shift != 24) text += '.';
+                text += std::to_string((predicate.value >> shift) & 0xFF);
+            }
+            return text;
+        }
+        case IpPredicate::Kind::Any:
+            return "any " + std::to_string(predicate.byte);
+        case IpPredicate::Kind::Ranges:
+            return "ranges " + std::to_string(predicate.ranges->size());
+        case IpPredicate::Kind::Query:
+            return "query " + predicate.program->source();
+    }
+    return "?";
+}
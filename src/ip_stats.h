@@ -0,0 +1,159 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ip_query.h"
+
+/**
+ * @brief Формат отчета --stats
+ */
+enum class StatsFormat {
+    None,  ///< Отчет не нужен, замеры не ведутся
+    Text,  ///< Таблица для человека
+    Json   ///< Один объект JSON в строку (для сбора метрик)
+};
+
+/**
+ * @brief Замеры одного запуска: этапы, совпадения фильтров, память
+ *
+ * Сбор включается один раз в начале main (enable). Пока он не включен,
+ * active() возвращает nullptr и каждая точка замера стоит одну загрузку
+ * указателя и ветвление - инструментирование не убирается из сборки.
+ *
+ * Методы RunStats (enable, этапы, совпадения, отчет) вызываются только из
+ * главного потока. Счетчики выделений и ошибок разбора - атомарные, вне
+ * класса: countAllocation срабатывает в любом потоке, countParseError -
+ * и в рабочих потоках разбора (--threads). report читает их без остановки
+ * потоков, поэтому к моменту отчета рабочие потоки должны быть завершены.
+ */
+class RunStats {
+public:
+    /**
+     * @brief Один этап конвейера
+     */
+    struct Stage {
+        std::string name;
+        double seconds = 0;
+        uint64_t rows = 0;   ///< Обработано строк/адресов (0 - не применимо)
+        uint64_t bytes = 0;  ///< Обработано байт (0 - не применимо)
+    };
+
+    /**
+     * @brief Включить сбор (и подсчет выделений памяти); время запуска отсчитывается отсюда
+     */
+    static RunStats& enable();
+
+    /**
+     * @brief Выключить сбор: active() снова возвращает nullptr, выделения не считаются
+     *
+     * Накопленное не сбрасывается - следующий enable() продолжит с ним (см. reset).
+     * Нужно тестам, запускающим несколько замеров в одном процессе; ip_filter
+     * включает сбор один раз и не выключает.
+     */
+    static void disable();
+
+    /**
+     * @brief Текущий сборщик или nullptr, если --stats не задан
+     */
+    static RunStats* active() { return active_; }
+
+    /**
+     * @brief Забыть этапы, совпадения, ошибку и счетчики; время отсчитывается заново
+     *
+     * Как и disable, нужен тестам. Рабочие потоки в этот момент не должны
+     * считать выделения и ошибки разбора, иначе их вклад попадет в новый замер.
+     */
+    void reset();
+
+    void addStage(std::string name, double seconds, uint64_t rows, uint64_t bytes);
+
+    /**
+     * @brief Число совпадений каждого фильтра пакета (повторный вызов добавляет к прежним)
+     */
+    void addMatches(const std::vector<IpPredicate>& predicates, const std::vector<uint64_t>& matches);
+
+    /**
+     * @brief Отметить, что запуск завершился ошибкой
+     */
+    void setError(std::string message) { error_ = std::move(message); }
+
+    /**
+     * @brief Итоговый отчет: этапы, совпадения, пиковый RSS, выделения, ошибки разбора
+     */
+    void report(std::ostream& os, StatsFormat format) const;
+
+private:
+    RunStats();
+
+    static RunStats* active_;
+
+    std::chrono::steady_clock::time_point start_;
+    std::vector<Stage> stages_;
+    std::vector<std::string> filterNames_;
+    std::vector<uint64_t> filterMatches_;
+    std::string error_;
+};
+
+/**
+ * @brief Замер этапа: от создания до finish()
+ *
+ * Если сбор не включен, ничего не делает. Этап, не дошедший до finish()
+ * (исключение), записывается деструктором без счетчиков.
+ */
+class StageTimer {
+public:
+    explicit StageTimer(const char* name)
+        : stats_(RunStats::active()), name_(name) {
+        if (stats_ != nullptr) start_ = std::chrono::steady_clock::now();
+    }
+
+    ~StageTimer() { finish(0, 0); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    /**
+     * @brief Завершить этап
+     * @param rows Обработано строк (0 - не применимо)
+     * @param bytes Обработано байт (0 - не применимо)
+     */
+    void finish(uint64_t rows, uint64_t bytes) {
+        if (stats_ == nullptr) return;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+        stats_->addStage(name_, elapsed.count(), rows, bytes);
+        stats_ = nullptr;
+    }
+
+private:
+    RunStats* stats_;
+    const char* name_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @brief Учесть выделение памяти, пока сбор включен
+ *
+ * Вызывается заменой глобального operator new из ip_alloc_count.cpp. Она
+ * собирается только в исполняемый файл ip_filter, а не в библиотеку: в
+ * программах без нее (тесты, бенчмарки) выделения в отчете равны нулю.
+ * Счетчики атомарные: operator new вызывается из любого потока.
+ */
+void countAllocation(std::size_t bytes) noexcept;
+
+/**
+ * @brief Учесть строку, которую не удалось разобрать
+ *
+ * Счетчик атомарный и ведется всегда (вызывается только на пути ошибки),
+ * в том числе из рабочих потоков разбора.
+ */
+void countParseError();
+
+/**
+ * @brief Короткое описание фильтра для отчета: "prefix 46.70", "any 46", "ranges 3", "query ...", "all"
+ */
+std::string describePredicate(const IpPredicate& predicate);
@@ -0,0 +1,451 @@
+/**
+ * @file ip_stream.cpp
+ * @brief Обработка данных, не помещающихся в память
+ *
+ * - потоковая фильтрация: строки читаются порциями, совпадения выводятся сразу
+ * - внешняя сортировка: отсортированные прогоны во временном файле,
+ *   слияние группами по k прогонов до одного прохода, в котором
+ *   одновременно вычисляются фильтры
+ */
+
+#include "ip_stream.h"
+#include "ip_format.h"
+#include "ip_input.h"
+#include "ip_parse_simd.h"
+#include "ip_sort.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+// Минимальный бюджет: меньше не имеет смысла даже для тестов
+constexpr size_t kMinBudget = 64u << 10;
+
+// Буфер чтения в потоковом режиме
+constexpr size_t kStreamBuffer = 1u << 20;
+
+// Наибольший буфер текста секции вывода
+constexpr size_t kSectionBuffer = 64u << 10;
+
+// Наименьший буфер чтения прогона при слиянии: от него зависит ширина слияния
+constexpr size_t kMinReaderBytes = 4u << 10;
+
+std::runtime_error ioError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// ============================================================================
+// ВРЕМЕННЫЙ ФАЙЛ
+// ============================================================================
+
+/**
+ * @brief Безымянный временный файл
+ *
+ * Создается через mkstemp и сразу удаляется из каталога: место освобождается
+ * при закрытии, в том числе при аварийном завершении.
+ */
+class TempFile {
+public:
+    explicit TempFile(const std::string& dir) {
+        std::string path = dir + "/ip_filter.XXXXXX";
+        int fd = ::mkstemp(path.data());
+        if (fd < 0) {
+            throw ioError("Не удалось создать временный файл в " + dir);
+        }
+        ::unlink(path.c_str());
+        file_ = ::fdopen(fd, "w+b");
+        if (file_ == nullptr) {
+            ::close(fd);
+            throw ioError("Не удалось открыть временный файл");
+        }
+    }
+
+    TempFile(TempFile&& other) noexcept : file_(std::exchange(other.file_, nullptr)) {}
+    TempFile& operator=(TempFile&& other) noexcept {
+        std::swap(file_, other.file_);  // прежний файл закроется вместе с other
+        return *this;
+    }
+    TempFile(const TempFile&) = delete;
+    ~TempFile() {
+        if (file_ != nullptr) std::fclose(file_);
+    }
+
+    void write(const void* data, size_t size) {
+        if (size > 0 && std::fwrite(data, 1, size, file_) != size) {
+            throw ioError("Ошибка записи временного файла");
+        }
+    }
+
+    size_t read(void* data, size_t size) {
+        size_t n = std::fread(data, 1, size, file_);
+        if (n < size && std::ferror(file_)) {
+            throw ioError("Ошибка чтения временного файла");
+        }
+        return n;
+    }
+
+    /**
+     * @brief Чтение с заданного смещения, не сдвигая позицию записи
+     *
+     * Записанное до этого должно быть сброшено через flush().
+     */
+    size_t readAt(void* data, size_t size, uint64_t offset) {
+        ssize_t n = ::pread(::fileno(file_), data, size, static_cast<off_t>(offset));
+        if (n < 0) {
+            throw ioError("Ошибка чтения временного файла");
+        }
+        return static_cast<size_t>(n);
+    }
+
+    void flush() {
+        if (std::fflush(file_) != 0) {
+            throw ioError("Ошибка записи временного файла");
+        }
+    }
+
+    void rewind() {
+        if (std::fflush(file_) != 0 || std::fseek(file_, 0, SEEK_SET) != 0) {
+            throw ioError("Ошибка перемотки временного файла");
+        }
+    }
+
+private:
+    std::FILE* file_ = nullptr;
+};
+
+// ============================================================================
+// ОТСОРТИРОВАННЫЕ ПРОГОНЫ
+// ============================================================================
+
+/**
+ * @brief Прогон: отрезок файла прогонов (в адресах)
+ */
+struct Run {
+    uint64_t first;
+    uint64_t count;
+};
+
+/**
+ * @brief Прогоны подряд в одном временном файле
+ *
+ * Один дескриптор на любое число прогонов: ширину слияния ограничивает
+ * только память под буферы чтения, а не RLIMIT_NOFILE.
+ */
+class RunFile {
+public:
+    explicit RunFile(const std::string& dir) : file_(dir) {}
+
+    void beginRun() {
+        runs_.push_back({written_, 0});
+    }
+
+    void write(const IpAddress* data, size_t count) {
+        file_.write(data, count * sizeof(IpAddress));
+        written_ += count;
+        runs_.back().count += count;
+    }
+
+    /**
+     * @brief Закончить запись: дальше прогоны только читаются
+     */
+    void finish() {
+        file_.flush();
+    }
+
+    TempFile& file() { return file_; }
+    const std::vector<Run>& runs() const { return runs_; }
+
+private:
+    TempFile file_;
+    std::vector<Run> runs_;
+    uint64_t written_ = 0;
+};
+
+/**
+ * @brief Последовательное чтение адресов прогона через буфер
+ */
+class RunReader {
+public:
+    RunReader(TempFile& file, const Run& run, size_t bufferAddresses)
+        : file_(file), offset_(run.first * sizeof(IpAddress)), left_(run.count),
+          buffer_(static_cast<size_t>(std::min<uint64_t>(bufferAddresses, run.count)), IpAddress(0, 0, 0, 0)) {}
+
+    bool next(IpAddress& ip) {
+        if (pos_ == size_) {
+            if (left_ == 0) return false;
+            size_t want = static_cast<size_t>(std::min<uint64_t>(buffer_.size(), left_));
+            if (file_.readAt(buffer_.data(), want * sizeof(IpAddress), offset_) != want * sizeof(IpAddress)) {
+                throw std::runtime_error("Временный файл короче записанного прогона");
+            }
+            offset_ += want * sizeof(IpAddress);
+            left_ -= want;
+            size_ = want;
+            pos_ = 0;
+        }
+        ip = buffer_[pos_++];
+        return true;
+    }
+
+private:
+    TempFile& file_;
+    uint64_t offset_;
+    uint64_t left_;
+    std::vector<IpAddress> buffer_;
+    size_t pos_ = 0;
+    size_t size_ = 0;
+};
+
+// ============================================================================
+// СЕКЦИИ ВЫВОДА
+// ============================================================================
+
+/**
+ * @brief Секция, которая будет выведена после предыдущих: текст копится во временном файле
+ */
+class DeferredSection {
+public:
+    DeferredSection(const std::string& dir, size_t bufferBytes) : file_(dir), capacity_(bufferBytes) {
+        buffer_.reserve(capacity_);
+    }
+
+    void append(const IpAddress& ip) {
+        if (buffer_.size() + kMaxIpTextLength + 8 > capacity_) flush();
+        size_t used = buffer_.size();
+        buffer_.resize(used + kMaxIpTextLength + 8);
+        used += formatIp(ip, buffer_.data() + used);
+        buffer_[used++] = '\n';
+        buffer_.resize(used);
+    }
+
+    /**
+     * @brief Дописать накопленный текст секции в поток
+     */
+    void copyTo(OutputBuffer& out) {
+        flush();
+        file_.rewind();
+        std::vector<char> chunk(capacity_);
+        for (size_t n; (n = file_.read(chunk.data(), chunk.size())) > 0;) {
+            out.append(std::string_view(chunk.data(), n));
+        }
+    }
+
+private:
+    void flush() {
+        file_.write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+    TempFile file_;
+    size_t capacity_;
+    std::vector<char> buffer_;
+};
+
+/**
+ * @brief Отсортировать порцию и дописать ее в файл прогонов
+ */
+void spillRun(std::vector<IpAddress>& run, RunFile& runs) {
+    radixSort(run.data(), run.data() + run.size());
+    runs.beginRun();
+    runs.write(run.data(), run.size());
+    run.clear();
+}
+
+/**
+ * @brief Элемент кучи слияния: текущий адрес прогона
+ */
+struct MergeHead {
+    IpAddress ip;
+    size_t run;
+};
+
+/**
+ * @brief Вершина кучи - адрес, который идет первым в порядке IpAddress::operator<
+ */
+struct MergeOrder {
+    bool operator()(const MergeHead& a, const MergeHead& b) const {
+        return b.ip < a.ip;
+    }
+};
+
+/**
+ * @brief k-путевое слияние прогонов [first, first + count) с передачей адресов в sink
+ */
+template <typename Sink>
+void mergeRuns(TempFile& file, const Run* first, size_t count, size_t readerAddresses, Sink&& sink) {
+    std::vector<RunReader> readers;
+    readers.reserve(count);
+    std::priority_queue<MergeHead, std::vector<MergeHead>, MergeOrder> heap;
+    for (size_t i = 0; i < count; ++i) {
+        readers.emplace_back(file, first[i], readerAddresses);
+        IpAddress ip(0, 0, 0, 0);
+        if (readers[i].next(ip)) heap.push({ip, i});
+    }
+
+    while (!heap.empty()) {
+        MergeHead head = heap.top();
+        heap.pop();
+        sink(head.ip);
+
+        IpAddress ip(0, 0, 0, 0);
+        if (readers[head.run].next(ip)) heap.push({ip, head.run});
+    }
+}
+
+/**
+ * @brief Промежуточный проход: слить прогоны группами по fanIn в новый файл
+ *
+ * Буферы чтения группы и буфер записи - fanIn + 1 буфер по bufferAddresses.
+ * Прежний файл закрывается вызывающим, так что на диске не больше двух копий.
+ */
+RunFile mergePass(RunFile& source, size_t fanIn, size_t bufferAddresses, const std::string& tmpDir) {
+    RunFile merged(tmpDir);
+    std::vector<IpAddress> pending;
+    pending.reserve(bufferAddresses);
+    const auto& runs = source.runs();
+    for (size_t i = 0; i < runs.size(); i += fanIn) {
+        merged.beginRun();
+        mergeRuns(source.file(), runs.data() + i, std::min(fanIn, runs.size() - i), bufferAddresses,
+                  [&](const IpAddress& ip) {
+                      pending.push_back(ip);
+                      if (pending.size() == bufferAddresses) {
+                          merged.write(pending.data(), pending.size());
+                          pending.clear();
+                      }
+                  });
+        merged.write(pending.data(), pending.size());
+        pending.clear();
+    }
+    merged.finish();
+    return merged;
+}
+
+} // namespace
+
+// ============================================================================
+// ПОТОКОВАЯ ФИЛЬТРАЦИЯ
+// ============================================================================
+
+/**
+ * @brief Фильтрация по мере чтения
+ *
+ * Каждая порция строк разбирается пакетно, совпадения выводятся
+ * и сбрасываются в поток до чтения следующей порции.
+ */
+size_t streamFilter(int fd, const FilterBatch& batch, std::ostream& os) {
+    ChunkReader reader(fd, kStreamBuffer);
+    OutputBuffer out(os);
+    std::vector<IpAddress> parsed;
+    const auto& predicates = batch.predicates();
+    size_t total = 0;
+
+    std::string_view lines;
+    while (reader.next(lines)) {
+        parsed.clear();
+        total += parseIpBatch(lines, parsed);
+        for (const auto& ip : parsed) {
+            bool matched = std::any_of(predicates.begin(), predicates.end(),
+                                       [&](const IpPredicate& p) { return p.matches(ip); });
+            if (matched) {
+                out.append(ip);
+            }
+        }
+        out.flush();
+        os.flush();
+    }
+    return total;
+}
+
+// ============================================================================
+// ВНЕШНЯЯ СОРТИРОВКА
+// ============================================================================
+
+/**
+ * @brief Внешняя сортировка с вычислением фильтров при слиянии
+ *
+ * При чтении бюджет делится так: четверть - буфер чтения входа, половина -
+ * порция адресов вместе с временными массивами поразрядной сортировки (ключи
+ * и буфер раскладки, итого около 12 байт на адрес). При слиянии половина
+ * бюджета идет на буферы прогонов (не меньше kMinReaderBytes на каждый, отсюда
+ * ширина слияния), четверть - на буферы текста секций вывода. Если прогонов
+ * больше ширины, они сливаются группами в промежуточные, пока не уложатся
+ * в один проход.
+ */
+size_t externalSortReport(int fd, const FilterBatch& batch, size_t memoryBudget,
+                          const std::string& tmpDir, std::ostream& os) {
+    size_t budget = std::max(memoryBudget, kMinBudget);
+    size_t runCapacity = budget / 2 / 12;
+
+    std::vector<IpAddress> run;
+    RunFile runs(tmpDir);
+    size_t total = 0;
+    {
+        ChunkReader reader(fd, budget / 4);
+        std::string_view lines;
+        while (reader.next(lines)) {
+            total += parseIpBatch(lines, run);
+            if (run.size() >= runCapacity) {
+                spillRun(run, runs);
+            }
+        }
+    }
+
+    if (runs.runs().empty()) {
+        // все поместилось в память - обычная сортировка и один проход фильтров
+        if (!run.empty()) {
+            radixSort(run.data(), run.data() + run.size());
+            batch.run(run, os);
+        }
+        return total;
+    }
+    if (!run.empty()) {
+        spillRun(run, runs);
+    }
+    std::vector<IpAddress>().swap(run);
+    runs.finish();
+
+    // промежуточные проходы: fanIn буферов чтения и буфер записи
+    const size_t mergeBytes = budget / 2;
+    const size_t fanIn = std::max<size_t>(2, mergeBytes / kMinReaderBytes - 1);
+    while (runs.runs().size() > fanIn) {
+        runs = mergePass(runs, fanIn, mergeBytes / (fanIn + 1) / sizeof(IpAddress), tmpDir);
+    }
+
+    // первая секция выводится сразу, остальные - после нее из временных файлов
+    const auto& predicates = batch.predicates();
+    const size_t sectionBytes = std::clamp(budget / 4 / std::max<size_t>(1, predicates.size()),
+                                           size_t{kMaxIpTextLength + 8}, kSectionBuffer);
+    OutputBuffer out(os, sectionBytes);
+    std::vector<DeferredSection> deferred;
+    deferred.reserve(predicates.size());
+    for (size_t slot = 1; slot < predicates.size(); ++slot) {
+        deferred.emplace_back(tmpDir, sectionBytes);
+    }
+
+    const auto& last = runs.runs();
+    mergeRuns(runs.file(), last.data(), last.size(), mergeBytes / last.size() / sizeof(IpAddress),
+              [&](const IpAddress& ip) {
+                  if (!predicates.empty() && predicates[0].matches(ip)) {
+                      out.append(ip);
+                  }
+                  for (size_t slot = 1; slot < predicates.size(); ++slot) {
+                      if (predicates[slot].matches(ip)) {
+                          deferred[slot - 1].append(ip);
+                      }
+                  }
+              });
+
+    for (auto& section : deferred) {
+        section.copyTo(out);
+    }
+    return total;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include "ip_query.h"
+
+/**
+ * @brief Потоковая фильтрация без накопления пула
+ *
+ * Вход читается порциями строк, каждый адрес, подходящий хотя бы под один
+ * фильтр пакета, выводится сразу (в порядке входа, без сортировки).
+ * Память - только буфер чтения, вывод сбрасывается после каждой порции.
+ *
+ * @param fd Входной дескриптор
+ * @param batch Фильтры
+ * @param os Поток вывода
+ * @return Количество разобранных адресов
+ * @throws std::invalid_argument если адрес в строке некорректный
+ */
+size_t streamFilter(int fd, const FilterBatch& batch, std::ostream& os);
+
+/**
+ * @brief Сортировка и вывод пакета фильтров при ограниченной памяти
+ *
+ * Адреса накапливаются, пока помещаются в бюджет; заполненная порция
+ * сортируется поразрядно и дописывается во временный файл (отсортированный прогон).
+ * Затем прогоны сливаются k-путевым слиянием; если их больше, чем позволяет
+ * бюджет буферов чтения, сначала сливаются группами в промежуточные прогоны.
+ * Результат последнего прохода идет через фильтры:
+ * первая секция выводится сразу, остальные накапливаются во временных файлах
+ * и дописываются по порядку. Если вход поместился в бюджет целиком, временные
+ * файлы не создаются. Вывод совпадает с сортировкой в памяти + FilterBatch::run.
+ *
+ * @param fd Входной дескриптор
+ * @param batch Фильтры (секции вывода)
+ * @param memoryBudget Бюджет памяти в байтах
+ * @param tmpDir Каталог для временных файлов (файлы удаляются сразу после создания)
+ * @param os Поток вывода
+ * @return Количество разобранных адресов
+ * @throws std::invalid_argument если адрес в строке некорректный
+ * @throws std::runtime_error при ошибке ввода-вывода временных файлов
+ */
+size_t externalSortReport(int fd, const FilterBatch& batch, size_t memoryBudget,
+                          const std::string& tmpDir, std::ostream& os);
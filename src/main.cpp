@@ -1,33 +1,427 @@
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <vector>
 #include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
 #include "ip_address.h"
+#include "ip_columns.h"
+#include "ip_dedup.h"
 #include "ip_filter.h"
+#include "ip_format.h"
+#include "ip_input.h"
+#include "ip_invalid.h"
+#include "ip_parallel.h"
+#include "ip_parse_simd.h"
+#include "ip_pool.h"
+#include "ip_runs.h"
+#include "ip_server.h"
+#include "ip_snapshot.h"
+#include "ip_sort.h"
+#include "ip_stats.h"
+#include "ip_stream.h"
+#include "options.h"
+
+namespace {
+
+/**
+ * @brief Дескриптор входа для режимов с чтением порциями: файл или stdin
+ *
+ * Открытый файл закрывается деструктором, stdin остается открытым.
+ */
+class InputFd {
+public:
+    explicit InputFd(const std::string& path) {
+        if (path.empty()) {
+            return;
+        }
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            throw std::runtime_error("Не удалось открыть файл " + path);
+        }
+    }
+
+    ~InputFd() {
+        if (fd_ != STDIN_FILENO) {
+            ::close(fd_);
+        }
+    }
+
+    InputFd(const InputFd&) = delete;
+    InputFd& operator=(const InputFd&) = delete;
+
+    int get() const { return fd_; }
+
+private:
+    int fd_ = STDIN_FILENO;
+};
+
+/**
+ * @brief Вид страниц пула-арены: --huge-pages просит MAP_HUGETLB
+ */
+IpPool::Pages poolPages(const Options& options) {
+    return options.hugePages ? IpPool::Pages::HugeTlb : IpPool::Pages::Transparent;
+}
+
+/**
+ * @brief Секции вывода: фильтры из аргументов или отчет из задания
+ */
+FilterBatch makeBatch(const Options& options) {
+    if (options.filters.empty()) {
+        return standardReport();
+    }
+    FilterBatch batch;
+    for (const auto& predicate : options.filters) {
+        batch.add(predicate);
+    }
+    return batch;
+}
+
+/**
+ * @brief --save-index: снимок отсортированного пула для последующих запусков с --load-index
+ */
+void saveIndexIfRequested(const Options& options, IpSpan ipPool, const uint64_t* counts, bool distinct) {
+    if (options.saveIndex.empty()) {
+        return;
+    }
+    StageTimer stage("save-index");
+    std::unique_ptr<IpIndex> index;
+    if (options.indexPostings) {
+        index = std::make_unique<IpIndex>(ipPool);
+    }
+    saveSnapshot(options.saveIndex, {ipPool, counts, distinct, index.get()});
+    stage.finish(ipPool.size(), 0);
+}
+
+/**
+ * @brief Режим --load-index: пул из снимка, без разбора текста
+ */
+void runSnapshot(const Options& options, const FilterBatch& batch) {
+    StageTimer stage("load-index");
+    Snapshot snapshot = Snapshot::open(options.loadIndex);
+    IpSpan ipPool = snapshot.pool();
+    stage.finish(ipPool.size(), ipPool.size() * sizeof(IpAddress));
+    
+    std::vector<IpAddress> appended;
+    if (!options.appendPath.empty()) {
+        // сортируется только новая порция, пул снимка уже упорядочен - одно линейное слияние
+        StageTimer appendStage("append");
+        InputBuffer input = InputBuffer::fromFile(options.appendPath);
+        IpPool batch(IpPool::maxRowsFor(input.view().size()), poolPages(options));
+        readIpAddresses(input.view(), batch);
+        radixSort(batch.data(), batch.data() + batch.size());
+        appended = mergeSorted(ipPool, batch);
+        appendStage.finish(batch.size(), input.view().size());
+        ipPool = appended;
+    }
+    const bool merged = !options.appendPath.empty();
+    saveIndexIfRequested(options, ipPool, merged ? nullptr : snapshot.counts(), !merged && snapshot.distinct());
+    // сохраненные списки строк отвечают на any N без прохода по пулу
+    const IpIndex* index = !merged && snapshot.hasPostings() ? &snapshot.index() : nullptr;
+    
+    if (options.countHits) {
+        if (snapshot.counts() == nullptr) {
+            throw std::runtime_error("Снимок " + options.loadIndex + " сохранен без счетчиков (нужен --count при сохранении)");
+        }
+        batch.runCounted(ipPool, snapshot.counts(), std::cout, nullptr, index);
+        return;
+    }
+    if (options.unique && !snapshot.distinct()) {
+        // пул отсортирован - повторы стоят подряд
+        std::vector<IpAddress> distinct;
+        std::unique_copy(ipPool.begin(), ipPool.end(), std::back_inserter(distinct),
+                         [](const IpAddress& a, const IpAddress& b) { return a.key() == b.key(); });
+        batch.run(distinct, std::cout);
+        return;
+    }
+    batch.run(ipPool, std::cout, index);
+}
+
+/**
+ * @brief Весь вход в памяти: файл из аргумента (mmap) или stdin
+ */
+InputBuffer openInput(const Options& options) {
+    StageTimer stage("read");
+    InputBuffer input = options.inputPath.empty()
+        ? InputBuffer::fromFd(STDIN_FILENO)
+        : InputBuffer::fromFile(options.inputPath);
+    stage.finish(0, input.view().size());
+    return input;
+}
+
+/**
+ * @brief Режим --where/--sum: строки с числовыми столбцами, условия и свертка по адресу
+ */
+void runColumns(const Options& options, const FilterBatch& batch) {
+    std::vector<unsigned> columns;
+    for (const auto& predicate : options.where) {
+        columns.push_back(predicate.column);
+    }
+    if (options.sumColumn != 0) {
+        columns.push_back(options.sumColumn);
+    }
+    
+    InputBuffer input = openInput(options);
+    ColumnTable table(columns);
+    StageTimer parseStage("parse");
+    table.parse(input.view());
+    parseStage.finish(table.size(), input.view().size());
+    
+    StageTimer whereStage("where");
+    uint64_t rows = table.size();
+    table.filter(options.where);
+    whereStage.finish(rows, 0);
+    
+    StageTimer sortStage("sort");
+    table.sortByAddress();
+    sortStage.finish(table.size(), 0);
+    
+    if (!options.unique) {
+        if (table.size() > 0) {
+            batch.run(table.addresses(), std::cout);
+        }
+        return;
+    }
+    
+    StageTimer aggregateStage("aggregate");
+    ColumnAggregate totals = aggregateByAddress(table, options.sumColumn);
+    aggregateStage.finish(table.size(), 0);
+    if (totals.addresses.empty()) {
+        return;
+    }
+    if (!options.countHits) {
+        batch.run(totals.addresses, std::cout);
+        return;
+    }
+    batch.runCounted(totals.addresses, totals.counts.data(), std::cout,
+                     options.sumColumn != 0 ? totals.sums.data() : nullptr);
+}
+
+/**
+ * @brief Журнал с адресами IPv4 и IPv6
+ */
+void runMixed(std::string_view data, const FilterBatch& batch) {
+    std::vector<IpAddress> ipPool;
+    std::vector<Ip6Address> ip6Pool;
+    StageTimer parseStage("parse");
+    readMixedAddresses(data, ipPool, ip6Pool);
+    parseStage.finish(ipPool.size() + ip6Pool.size(), data.size());
+    
+    StageTimer sortStage("sort");
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    radixSort(ip6Pool.data(), ip6Pool.data() + ip6Pool.size());
+    sortStage.finish(ipPool.size() + ip6Pool.size(), 0);
+    batch.run(ipPool, ip6Pool, std::cout);
+}
+
+/**
+ * @brief Режим --unique/--count: повторы схлопываются при чтении, сортируются только различные адреса
+ */
+void runDistinct(const Options& options, const FilterBatch& batch) {
+    AddressCounter counter(options.countHits);
+    InputFd input(options.inputPath);
+    ChunkReader reader(input.get(), 4u << 20);
+    std::vector<IpAddress> parsed;
+    
+    StageTimer countStage("parse+count");
+    uint64_t rows = 0;
+    uint64_t bytes = 0;
+    std::string_view lines;
+    while (reader.next(lines)) {
+        parsed.clear();
+        parseIpBatch(lines, parsed);
+        counter.add(parsed.data(), parsed.data() + parsed.size());
+        rows += parsed.size();
+        bytes += lines.size();
+    }
+    countStage.finish(rows, bytes);
+    
+    StageTimer sortStage("sort");
+    std::vector<IpAddress> ipPool = counter.sortedAddresses();
+    sortStage.finish(ipPool.size(), 0);
+    if (!options.countHits) {
+        saveIndexIfRequested(options, ipPool, nullptr, true);
+        if (!ipPool.empty()) {
+            batch.run(ipPool, std::cout);
+        }
+        return;
+    }
+    std::vector<uint64_t> counts;
+    counts.reserve(ipPool.size());
+    for (const auto& ip : ipPool) {
+        counts.push_back(counter.count(ip));
+    }
+    saveIndexIfRequested(options, ipPool, counts.data(), true);
+    if (!ipPool.empty()) {
+        batch.runCounted(ipPool, counts.data(), std::cout);
+    }
+}
+
+/**
+ * @brief Режим --serve: пул загружается один раз, запросы - через сокет
+ */
+void runServer(const Options& options) {
+    StageTimer stage("load");
+    PoolServer server(options.serveSocket, {options.inputPath, options.loadIndex, options.threads}, options.workers);
+    stage.finish(server.pool()->rows(), 0);
+    std::cerr << "Сервер: " << options.serveSocket << ", адресов: " << server.pool()->rows() << std::endl;
+    server.run();
+}
+
+/**
+ * @brief Режим --connect: запросы по порядку, строки ответов - в stdout
+ */
+void runClient(const Options& options) {
+    ServerClient client(options.connectSocket);
+    OutputBuffer out(std::cout);
+    for (const auto& line : options.requests) {
+        ServerReply reply = client.request(line);
+        if (!reply.ok) {
+            out.flush();
+            throw std::runtime_error("сервер: " + reply.status);
+        }
+        out.append(reply.data);
+        std::string_view command = std::string_view(line).substr(0, line.find(' '));
+        if (command == "count" || command == "info" || command == "reload" || command == "append") {
+            // у этих запросов нет строк результата, ответ - итоговая строка
+            out.append(reply.status);
+            out.append("\n");
+        }
+    }
+    out.flush();
+}
+
+/**
+ * @brief Выбор режима по аргументам и обработка
+ */
+void run(const Options& options, const FilterBatch& batch) {
+    if (!options.serveSocket.empty()) {
+        runServer(options);
+        return;
+    }
+    
+    if (!options.connectSocket.empty()) {
+        runClient(options);
+        return;
+    }
+    
+    if (!options.loadIndex.empty()) {
+        // готовый отсортированный пул из снимка
+        runSnapshot(options, batch);
+        return;
+    }
+    
+    if (!options.where.empty() || options.sumColumn != 0) {
+        // нужны числовые столбцы строк, а не только адреса
+        runColumns(options, batch);
+        return;
+    }
+    
+    if (options.stream) {
+        // только фильтры: совпадения выводятся по мере чтения
+        InputFd input(options.inputPath);
+        StageTimer stage("stream");
+        stage.finish(streamFilter(input.get(), batch, std::cout), 0);
+        return;
+    }
+    
+    if (options.unique) {
+        // уникальные адреса (и счетчики): память - по числу различных адресов
+        runDistinct(options, batch);
+        return;
+    }
+    
+    if (options.memoryLimit > 0) {
+        // ограниченная память: внешняя сортировка через временные файлы
+        InputFd input(options.inputPath);
+        StageTimer stage("external-sort");
+        stage.finish(externalSortReport(input.get(), batch, options.memoryLimit,
+                                        options.tmpDir, std::cout), 0);
+        return;
+    }
+    
+    // чтение данных: файл из аргумента (mmap) или stdin
+    InputBuffer input = openInput(options);
+    
+    if (hasIp6Lines(input.view())) {
+        // в журнале есть IPv6: два пула, в каждой секции сначала IPv4, затем IPv6
+        if (!options.saveIndex.empty() || options.threads > 1 || options.hugePages) {
+            throw std::invalid_argument("журнал с адресами IPv6: --save-index, --threads и --huge-pages не поддерживаются");
+        }
+        runMixed(input.view(), batch);
+        return;
+    }
+    
+    std::vector<IpAddress> merged;  // -t N: слияние кусков потоков
+    IpPool arena;                   // один поток: арена под наибольшее число строк входа
+    if (options.threads > 1) {
+        // разбор и сортировка кусками в несколько потоков
+        StageTimer stage("parse+sort");
+        merged = parseAndSortParallel(input.view(), options.threads);
+        stage.finish(merged.size(), input.view().size());
+    } else {
+        StageTimer parseStage("parse");
+        arena = IpPool(IpPool::maxRowsFor(input.view().size()), poolPages(options));
+        readIpAddresses(input.view(), arena);
+        parseStage.finish(arena.size(), input.view().size());
+        
+        StageTimer sortStage("sort");
+        radixSort(arena.data(), arena.data() + arena.size());
+        sortStage.finish(arena.size(), 0);
+    }
+    IpSpan ipPool = options.threads > 1 ? IpSpan(merged) : IpSpan(arena);
+    saveIndexIfRequested(options, ipPool, nullptr, false);
+    
+    if (ipPool.empty()) {
+        return;
+    }
+    
+    batch.run(ipPool, std::cout);
+}
+
+} // namespace
 
 int main(int argc, char* argv[]) {
+    // вывод идет крупными блоками через OutputBuffer, синхронизация с stdio не нужна
+    std::ios::sync_with_stdio(false);
+    
+    StatsFormat statsFormat = StatsFormat::None;
+    std::unique_ptr<InvalidLines> invalidLines;  // --skip-invalid: пропущенные строки
     try {
-        std::vector<IpAddress> ipPool;
-        std::string line;
-        
-        // чтение данных 
-        while (std::getline(std::cin, line)) {
-            if (line.empty()) continue;
-            
-            std::string ipStr = extractFirstColumn(line);
-            ipPool.push_back(parseIp(ipStr));
+        Options options = parseOptions(argc, argv);
+        statsFormat = options.stats;
+        if (statsFormat != StatsFormat::None) {
+            RunStats::enable();
         }
-        
-        if (ipPool.empty()) {
-            return 0;
+        if (options.skipInvalid) {
+            invalidLines = std::make_unique<InvalidLines>(options.invalidSamples);
+            InvalidLines::setActive(invalidLines.get());
         }
         
-        processIpAddresses(ipPool);
+        run(options, makeBatch(options));
         
     } catch (const std::exception& e) {
         std::cerr << "Ошибка: " << e.what() << '\n';
+        if (invalidLines) {
+            invalidLines->report(std::cerr);
+        }
+        if (RunStats* stats = RunStats::active()) {
+            stats->setError(e.what());
+            std::cout.flush();
+            stats->report(std::cerr, statsFormat);
+        }
         return 1;
     }
     
+    std::cout.flush();
+    if (invalidLines) {
+        invalidLines->report(std::cerr);
+    }
+    if (RunStats* stats = RunStats::active()) {
+        stats->report(std::cerr, statsFormat);
+    }
     return 0;
 }
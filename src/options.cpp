@@ -0,0 +1,279 @@
+/**
+ * @file options.cpp
+ * @brief Разбор аргументов командной строки
+ */
+
+#include "options.h"
+#include "ip_input.h"
+#include "ip_range.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+/**
+ * @brief Аргумент - десятичное число без знака
+ */
+bool isNumber(std::string_view arg) {
+    return !arg.empty() && std::all_of(arg.begin(), arg.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+/**
+ * @brief Значение аргумента: "--name=value" или следующий аргумент
+ */
+std::string_view takeValue(std::string_view arg, int& i, int argc, char* argv[]) {
+    size_t eq = arg.find('=');
+    if (eq != std::string_view::npos) {
+        return arg.substr(eq + 1);
+    }
+    if (i + 1 >= argc) {
+        throw std::invalid_argument("Не указано значение для " + std::string(arg));
+    }
+    return argv[++i];
+}
+
+unsigned parseUnsigned(std::string_view name, std::string_view value) {
+    unsigned result = 0;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc() || ptr != value.data() + value.size()) {
+        throw std::invalid_argument("Некорректное значение " + std::string(name) + ": " + std::string(value));
+    }
+    return result;
+}
+
+/**
+ * @brief Размер с необязательным суффиксом K/M/G: "512M" -> 536870912
+ */
+size_t parseSize(std::string_view name, std::string_view value) {
+    size_t multiplier = 1;
+    if (!value.empty()) {
+        switch (value.back()) {
+            case 'K': case 'k': multiplier = size_t{1} << 10; break;
+            case 'M': case 'm': multiplier = size_t{1} << 20; break;
+            case 'G': case 'g': multiplier = size_t{1} << 30; break;
+            default: break;
+        }
+    }
+    std::string_view digits = multiplier == 1 ? value : value.substr(0, value.size() - 1);
+    size_t result = 0;
+    auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), result);
+    if (ec != std::errc() || ptr != digits.data() + digits.size() || digits.empty()) {
+        throw std::invalid_argument("Некорректное значение " + std::string(name) + ": " + std::string(value));
+    }
+    return result * multiplier;
+}
+
+/**
+ * @brief Октет 0-255 из строки
+ */
+uint8_t parseOctet(std::string_view name, std::string_view value) {
+    unsigned octet = parseUnsigned(name, value);
+    if (octet > 255) {
+        throw std::invalid_argument("Некорректное значение " + std::string(name) + ": " + std::string(value));
+    }
+    return static_cast<uint8_t>(octet);
+}
+
+/**
+ * @brief Префикс "A[.B[.C[.D]]]" -> фильтр по первым октетам
+ */
+IpPredicate parsePrefixFilter(std::string_view value) {
+    uint8_t octets[4];
+    size_t count = 0;
+    for (;;) {
+        size_t dot = value.find('.');
+        if (count == 4) {
+            throw std::invalid_argument("Некорректное значение --filter: слишком много октетов");
+        }
+        octets[count++] = parseOctet("--filter", value.substr(0, dot));
+        if (dot == std::string_view::npos) break;
+        value.remove_prefix(dot + 1);
+    }
+    return IpPredicate::prefixOf(octets, count);
+}
+
+/**
+ * @brief Блоклист из файла -> один фильтр по набору диапазонов
+ */
+IpPredicate loadBlocklist(std::string_view path) {
+    InputBuffer input = InputBuffer::fromFile(std::string(path));
+    try {
+        return IpPredicate::rangeSet(RangeSet::parse(input.view()));
+    } catch (const std::invalid_argument& e) {
+        throw std::invalid_argument("Некорректный --blocklist " + std::string(path) + ", " + e.what());
+    }
+}
+
+/**
+ * @brief Совпадает ли аргумент с именем опции (в т.ч. в форме "--name=value")
+ */
+bool isOption(std::string_view arg, std::string_view name) {
+    return arg == name || (arg.size() > name.size() && arg.substr(0, name.size()) == name
+                           && arg[name.size()] == '=');
+}
+
+/**
+ * @brief Имя фильтра для parseFilter по аргументу ("--cidr=..." -> "cidr", "-q" -> "query"), иначе пусто
+ */
+std::string_view filterName(std::string_view arg) {
+    if (arg == "-q") return "query";
+    for (std::string_view name : {"filter", "any", "cidr", "range", "query", "blocklist"}) {
+        if (arg.substr(0, 2) == "--" && isOption(arg.substr(2), name)) return name;
+    }
+    return {};
+}
+
+} // namespace
+
+IpPredicate parseFilter(std::string_view name, std::string_view value) {
+    if (name == "filter") return parsePrefixFilter(value);
+    if (name == "any") return IpPredicate::any(parseOctet("--any", value));
+    if (name == "cidr") return IpPredicate::range(parseCidr(value));
+    if (name == "range") return IpPredicate::range(parseRange(value));
+    if (name == "query") return IpPredicate::query(value);
+    if (name == "blocklist") return loadBlocklist(value);
+    throw std::invalid_argument("Неизвестный фильтр: " + std::string(name));
+}
+
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+
+        if (isOption(arg, "--threads") || arg == "-t") {
+            options.threads = parseUnsigned("--threads", takeValue(arg, i, argc, argv));
+            if (options.threads == 0) {
+                options.threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+        } else if (std::string_view name = filterName(arg); !name.empty()) {
+            options.filters.push_back(parseFilter(name, takeValue(arg, i, argc, argv)));
+        } else if (arg == "--stream") {
+            options.stream = true;
+        } else if (isOption(arg, "--mem-limit")) {
+            options.memoryLimit = parseSize("--mem-limit", takeValue(arg, i, argc, argv));
+        } else if (isOption(arg, "--tmp-dir")) {
+            options.tmpDir = takeValue(arg, i, argc, argv);
+        } else if (arg == "--unique") {
+            options.unique = true;
+        } else if (arg == "--count") {
+            options.unique = true;
+            options.countHits = true;
+        } else if (isOption(arg, "--save-index")) {
+            options.saveIndex = takeValue(arg, i, argc, argv);
+        } else if (isOption(arg, "--load-index")) {
+            options.loadIndex = takeValue(arg, i, argc, argv);
+        } else if (isOption(arg, "--append")) {
+            options.appendPath = takeValue(arg, i, argc, argv);
+        } else if (arg == "--index-postings") {
+            options.indexPostings = true;
+        } else if (isOption(arg, "--where")) {
+            options.where.push_back(parseColumnPredicate(takeValue(arg, i, argc, argv)));
+        } else if (isOption(arg, "--sum")) {
+            options.sumColumn = parseColumnName(takeValue(arg, i, argc, argv));
+            options.unique = true;
+            options.countHits = true;
+        } else if (arg == "--stats" || arg == "--stats=text") {
+            options.stats = StatsFormat::Text;
+        } else if (arg == "--stats=json") {
+            options.stats = StatsFormat::Json;
+        } else if (isOption(arg, "--skip-invalid")) {
+            options.skipInvalid = true;
+            // значение необязательно: через '=' или следующим аргументом, если это число
+            if (arg.find('=') != std::string_view::npos
+                || (i + 1 < argc && isNumber(argv[i + 1]))) {
+                options.invalidSamples = parseUnsigned("--skip-invalid", takeValue(arg, i, argc, argv));
+            }
+        } else if (arg == "--huge-pages") {
+            options.hugePages = true;
+        } else if (isOption(arg, "--serve")) {
+            options.serveSocket = takeValue(arg, i, argc, argv);
+        } else if (isOption(arg, "--workers")) {
+            options.workers = parseUnsigned("--workers", takeValue(arg, i, argc, argv));
+        } else if (isOption(arg, "--connect")) {
+            options.connectSocket = takeValue(arg, i, argc, argv);
+        } else if (isOption(arg, "--request")) {
+            options.requests.emplace_back(takeValue(arg, i, argc, argv));
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            throw std::invalid_argument("Неизвестный аргумент: " + std::string(arg));
+        } else if (options.inputPath.empty()) {
+            options.inputPath = arg;
+        } else {
+            throw std::invalid_argument("Лишний аргумент: " + std::string(arg));
+        }
+    }
+
+    if (options.stream && options.filters.empty()) {
+        throw std::invalid_argument("--stream требует хотя бы одного фильтра (--filter, --any, --cidr, --range, -q, --blocklist)");
+    }
+    if (options.stream && options.unique) {
+        throw std::invalid_argument("--stream несовместим с --unique/--count");
+    }
+    if (options.threads > 1 && (options.stream || options.memoryLimit > 0 || options.unique)) {
+        throw std::invalid_argument("--threads работает только при сортировке в памяти (несовместим с --stream, --mem-limit и --unique/--count)");
+    }
+    if (!options.saveIndex.empty() && (options.stream || options.memoryLimit > 0)) {
+        throw std::invalid_argument("--save-index требует сортировки в памяти (несовместим с --stream и --mem-limit)");
+    }
+    if (options.indexPostings && options.saveIndex.empty()) {
+        throw std::invalid_argument("--index-postings требует --save-index");
+    }
+    if (!options.loadIndex.empty() && (options.stream || !options.inputPath.empty())) {
+        throw std::invalid_argument("--load-index заменяет входной файл (несовместим с FILE и --stream)");
+    }
+    if (!options.appendPath.empty() && (options.loadIndex.empty() || options.unique)) {
+        throw std::invalid_argument("--append требует --load-index и несовместим с --unique/--count");
+    }
+    bool usesColumns = !options.where.empty() || options.sumColumn != 0;
+    if (usesColumns && (options.stream || options.memoryLimit > 0
+                        || !options.loadIndex.empty() || !options.saveIndex.empty())) {
+        throw std::invalid_argument("--where/--sum несовместимы с --stream, --mem-limit и снимками");
+    }
+    if (usesColumns && options.threads > 1) {
+        throw std::invalid_argument("--where/--sum разбирают строки в одном потоке (несовместимы с --threads)");
+    }
+    if (!options.serveSocket.empty()) {
+        if (options.inputPath.empty() == options.loadIndex.empty()) {
+            throw std::invalid_argument("--serve требует входного файла или --load-index (stdin нельзя перечитать)");
+        }
+        if (!options.filters.empty() || options.stream || options.unique || options.memoryLimit > 0
+            || usesColumns || !options.saveIndex.empty()) {
+            throw std::invalid_argument("--serve: фильтры и режимы вывода задаются запросами, а не аргументами");
+        }
+        if (options.skipInvalid) {
+            // пропуски в reload/append попали бы только в отчет при выходе сервера
+            throw std::invalid_argument("--serve несовместим с --skip-invalid");
+        }
+    }
+    if (options.hugePages) {
+        // пул-арена есть только у разбора в один поток в памяти и у пакета --append
+        bool arena = options.threads <= 1 && !options.stream && !options.unique && options.memoryLimit == 0
+                  && !usesColumns && options.serveSocket.empty()
+                  && (options.loadIndex.empty() || !options.appendPath.empty());
+        if (!arena) {
+            throw std::invalid_argument("--huge-pages действует только на пул разбора в один поток в памяти "
+                                        "(несовместим с --threads, --stream, --mem-limit, --unique/--count, "
+                                        "--where/--sum, --serve и --load-index без --append)");
+        }
+    }
+    if (options.connectSocket.empty() != options.requests.empty()) {
+        throw std::invalid_argument("--connect и --request задаются вместе");
+    }
+    if (!options.connectSocket.empty() && !options.serveSocket.empty()) {
+        throw std::invalid_argument("--connect несовместим с --serve");
+    }
+    if (options.workers == 0) {
+        options.workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (options.tmpDir.empty()) {
+        const char* tmp = std::getenv("TMPDIR");
+        options.tmpDir = (tmp != nullptr && *tmp != '\0') ? tmp : "/tmp";
+    }
+
+    return options;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ip_columns.h"
+#include "ip_query.h"
+#include "ip_stats.h"
+
+/**
+ * @brief Параметры командной строки
+ */
+struct Options {
+    std::string inputPath;             ///< Путь к входному файлу (пусто - stdin)
+    unsigned threads = 1;              ///< Число потоков разбора и сортировки
+    std::vector<IpPredicate> filters;  ///< Фильтры --filter/--any/--cidr/--range/-q/--blocklist в порядке аргументов (пусто - отчет из задания)
+    bool stream = false;               ///< Выводить совпадения по мере чтения, без сортировки
+    size_t memoryLimit = 0;            ///< Бюджет памяти для внешней сортировки (0 - без ограничения)
+    std::string tmpDir;                ///< Каталог для временных файлов внешней сортировки
+    bool unique = false;               ///< Выводить каждый адрес один раз
+    bool countHits = false;            ///< Выводить каждый адрес один раз со счетчиком вхождений
+    std::string saveIndex;             ///< Куда сохранить снимок отсортированного пула (пусто - не сохранять)
+    std::string loadIndex;             ///< Снимок, из которого взять пул вместо разбора входа
+    std::string appendPath;            ///< Новые строки журнала, вливаемые в пул снимка (пусто - нет)
+    bool indexPostings = false;        ///< Сохранять в снимок списки строк индекса
+    std::vector<ColumnPredicate> where;  ///< Условия на числовые столбцы (все должны выполняться)
+    unsigned sumColumn = 0;            ///< Столбец для суммирования по адресу (0 - нет)
+    StatsFormat stats = StatsFormat::None;  ///< Отчет о замерах в stderr
+    bool skipInvalid = false;          ///< Пропускать строки с некорректным адресом вместо ошибки
+    size_t invalidSamples = 0;         ///< Сколько пропущенных строк показать в stderr
+    bool hugePages = false;            ///< Пул в явных больших страницах (MAP_HUGETLB), если они настроены
+    std::string serveSocket;           ///< Сокет, на котором отвечать на запросы (пусто - обычный запуск)
+    unsigned workers = 0;              ///< Потоки обработки запросов сервера (0 - по числу ядер)
+    std::string connectSocket;         ///< Сокет сервера, которому отправить запросы --request
+    std::vector<std::string> requests; ///< Запросы клиента в порядке аргументов
+};
+
+/**
+ * @brief Разбор аргументов командной строки
+ *
+ * Поддерживаемые аргументы:
+ *   [FILE]              входной файл (по умолчанию stdin)
+ *   -t, --threads N     число потоков разбора и сортировки в памяти (0 - по числу ядер)
+ *   --filter A[.B[.C[.D]]]  вывести адреса с заданными первыми октетами (можно несколько)
+ *   --any N             вывести адреса, содержащие октет N (можно несколько)
+ *   --cidr A.B.C.D/LEN  вывести адреса сети (можно несколько)
+ *   --range A.B.C.D-E.F.G.H  вывести адреса диапазона, границы включены (можно несколько)
+ *   -q, --query EXPR    вывести адреса, для которых выполняется выражение
+ *                       ("o1==46 && o2==70", "any==46", "cidr 10.0.0.0/8 && o4!=0"; см. QueryProgram)
+ *   --blocklist FILE    вывести адреса, попадающие в любой диапазон из файла
+ *                       (CIDR, диапазон или адрес на строку, '#' - комментарий)
+ *   --stream            только фильтры: выводить совпадения по мере чтения, без сортировки
+ *   --mem-limit SIZE    бюджет памяти (например 512M); больший ввод сортируется
+ *                       внешней сортировкой через временные файлы
+ *   --tmp-dir DIR       каталог временных файлов (по умолчанию $TMPDIR или /tmp)
+ *   --unique            схлопнуть повторы: каждый адрес один раз
+ *   --count             как --unique, плюс число вхождений через табуляцию
+ *   --save-index FILE   сохранить отсортированный пул (и счетчики при --count) в снимок
+ *   --index-postings    добавить в снимок списки строк индекса по октетам
+ *   --load-index FILE   взять пул из снимка вместо разбора входа
+ *   --append FILE       с --load-index: разобрать и отсортировать только новые строки FILE
+ *                       и слить их с пулом снимка за линейное время (вместе с --save-index
+ *                       того же файла - инкрементальное обновление снимка)
+ *   --where COND        оставить строки, где числовой столбец удовлетворяет условию
+ *                       ("c2>1000", операторы < <= > >= = == !=; можно несколько - все сразу)
+ *   --sum cN            как --count, плюс сумма столбца N по строкам адреса
+ *   --stats[=json]      после работы вывести в stderr время и скорость этапов, пиковый RSS,
+ *                       число выделений памяти, ошибок разбора и совпадений каждого фильтра
+ *   --skip-invalid [N]  пропускать строки с некорректным адресом (или столбцом --where/--sum),
+ *                       в конце вывести в stderr их число и первые N строк (по умолчанию 0);
+ *                       N - через '=' или следующим аргументом (файл с числовым именем - ./N)
+ *   --huge-pages        разместить пул в явных больших страницах (MAP_HUGETLB); если они
+ *                       не настроены (vm.nr_hugepages), используются прозрачные (THP);
+ *                       только для разбора в один поток в памяти и пакета --append
+ *   --serve SOCKET      загрузить и отсортировать пул (FILE или --load-index) один раз
+ *                       и отвечать на запросы через Unix-сокет (см. PoolServer); сокет
+ *                       создается с правами 0600, пул снимка читается из отображения
+ *   --workers N         потоки обработки запросов сервера (0 - по числу ядер)
+ *   --connect SOCKET    клиент: отправить серверу запросы --request и вывести ответы
+ *   --request LINE      запрос клиента ("filter 46.70", "count cidr 10.0.0.0/8", "reload"; можно несколько)
+ *
+ * @throws std::invalid_argument при неизвестном или некорректном аргументе
+ * @throws std::runtime_error если не удалось прочитать файл --blocklist
+ */
+Options parseOptions(int argc, char* argv[]);
+
+/**
+ * @brief Фильтр по имени и значению: ("filter", "46.70"), ("cidr", "10.0.0.0/8"), ("query", "any==46")
+ *
+ * Имена - как у опций без "--": filter, any, cidr, range, query, blocklist.
+ * Используется разбором аргументов и запросами к серверу.
+ *
+ * @throws std::invalid_argument если имя неизвестно или значение некорректно
+ * @throws std::runtime_error если не удалось прочитать файл blocklist
+ */
+IpPredicate parseFilter(std::string_view name, std::string_view value);
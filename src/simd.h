@@ -0,0 +1,34 @@
+#pragma once
+
+/**
+ * @file simd.h
+ * @brief Определение доступного набора SIMD-инструкций во время выполнения
+ *
+ * Ядра с интринсиками компилируются с __attribute__((target(...))),
+ * а нужная реализация выбирается один раз при старте по результату detectSimdLevel().
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#define IP_FILTER_X86 1
+#endif
+
+/**
+ * @brief Уровень SIMD, доступный процессору
+ */
+enum class SimdLevel {
+    Scalar,  ///< без векторных инструкций
+    Sse41,   ///< SSE4.1 (16 байт за инструкцию)
+    Avx2     ///< AVX2 (32 байта за инструкцию)
+};
+
+/**
+ * @brief Определить лучший доступный уровень SIMD
+ */
+inline SimdLevel detectSimdLevel() {
+#ifdef IP_FILTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+    if (__builtin_cpu_supports("sse4.1")) return SimdLevel::Sse41;
+#endif
+    return SimdLevel::Scalar;
+}
@@ -1,9 +1,32 @@
 #include <gtest/gtest.h>
 #include "ip_address.h"
 #include "ip_filter.h"
+#include "ip_input.h"
+#include "ip_invalid.h"
+#include "ip_parse_simd.h"
+#include "ip_pool.h"
+#include "ip_sort.h"
+#include "ip_parallel.h"
+#include "ip_index.h"
+#include "ip_query.h"
+#include "ip_format.h"
+#include "ip_match.h"
+#include "ip_dedup.h"
+#include "ip_range.h"
+#include "ip_snapshot.h"
+#include "ip_columns.h"
+#include "ip_stats.h"
+#include "ip_expr.h"
+#include "ip_runs.h"
+#include "ip_server.h"
+#include <cstdio>
+#include <sys/stat.h>
+#include <fstream>
+#include <thread>
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <iterator>
 
 // тест на конструктор
 TEST(IpAddressTest, Constructor) {
@@ -36,6 +59,139 @@ TEST(ParseIpTest, ValidAddress) {
     EXPECT_EQ(ip.octets[3], 1);
 }
 
+TEST(ParseIpTest, InvalidAddress) {
+    EXPECT_THROW(parseIp("1.2.3"), std::invalid_argument);
+    EXPECT_THROW(parseIp("1.2.3.4.5"), std::invalid_argument);
+    EXPECT_THROW(parseIp("1..3.4"), std::invalid_argument);
+    EXPECT_THROW(parseIp("a.b.c.d"), std::invalid_argument);
+    EXPECT_THROW(parseIp(""), std::invalid_argument);
+    EXPECT_THROW(parseIp("1.2.3.256"), std::invalid_argument);
+}
+
+// все реализации векторного разбора должны совпадать со скалярной
+TEST(ParseIpTest, SimdKernelsAgree) {
+    const char* samples[] = {
+        "192.168.1.1", "0.0.0.0", "255.255.255.255", "1.22.133.4", "046.070.1.1",
+        "1.2.3", "1.2.3.4.5", "1.2.3.256", "999.1.1.1", "1..2.3", ".1.2.3", "1.2.3.",
+        "1.2.3.4x", "1234.1.1.1", "", "1.2.3.4\t5"
+    };
+    SimdLevel best = detectSimdLevel();
+    for (const char* s : samples) {
+        IpAddress expected(0, 0, 0, 0);
+        bool ok = parseIpWith(SimdLevel::Scalar, s, expected);
+        for (SimdLevel level : {SimdLevel::Sse41, SimdLevel::Avx2}) {
+            if (static_cast<int>(level) > static_cast<int>(best)) continue;
+            IpAddress actual(1, 1, 1, 1);
+            ASSERT_EQ(parseIpWith(level, s, actual), ok) << s;
+            if (ok) {
+                EXPECT_TRUE(std::equal(actual.octets, actual.octets + 4, expected.octets)) << s;
+            }
+        }
+    }
+    EXPECT_THROW(parseIpSimd("10.0.300.1"), std::invalid_argument);
+    EXPECT_EQ(parseIpSimd("10.0.30.1").octets[2], 30);
+}
+
+// пакетный разбор длинного буфера: векторные окна и хвост в конце данных
+TEST(ParseIpTest, BatchMatchesScalar) {
+    std::string data;
+    std::vector<IpAddress> expected;
+    for (int i = 0; i < 500; ++i) {
+        IpAddress ip(static_cast<uint8_t>(i * 7), static_cast<uint8_t>(i), static_cast<uint8_t>(255 - i % 256), static_cast<uint8_t>(i % 10));
+        std::ostringstream line;
+        line << ip << '\t' << i * 13 << "\t" << i % 3 << (i % 50 == 0 ? "\r\n\n" : "\n");
+        data += line.str();
+        expected.push_back(ip);
+    }
+    std::vector<IpAddress> actual;
+    EXPECT_EQ(parseIpBatch(data, actual), expected.size());
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+        EXPECT_TRUE(std::equal(actual[i].octets, actual[i].octets + 4, expected[i].octets)) << i;
+    }
+    
+    std::vector<IpAddress> bad;
+    EXPECT_THROW(parseIpBatch("1.2.3.4\t1\t2\n1.2.3\t1\t2\n", bad), std::invalid_argument);
+}
+
+// код ошибки вместо исключения; --skip-invalid пропускает строку и идет дальше
+TEST(ParseIpTest, ErrorCodesAndSkipInvalid) {
+    IpAddress ip(9, 9, 9, 9);
+    EXPECT_EQ(tryParseIp("10.0.0.1", ip), IpParseError::None);
+    EXPECT_EQ(ip.key(), 0x0A000001u);
+    EXPECT_EQ(tryParseIp("", ip), IpParseError::Empty);
+    EXPECT_EQ(tryParseIp("1.2.3", ip), IpParseError::MissingDot);
+    EXPECT_EQ(tryParseIp("1234.1.1.1", ip), IpParseError::MissingDot);
+    EXPECT_EQ(tryParseIp("1.2.3.4.5", ip), IpParseError::TrailingData);
+    EXPECT_EQ(tryParseIp("1.2.3.256", ip), IpParseError::BadOctet);
+    EXPECT_EQ(tryParseIp("1.-2.3.4", ip), IpParseError::BadOctet);
+    EXPECT_EQ(tryParseIp("1..3.4", ip), IpParseError::BadOctet);
+    EXPECT_EQ(ip.key(), 0x0A000001u);  // при ошибке результат не меняется
+
+    InvalidLines invalid(1);
+    std::vector<IpAddress> pool;
+    EXPECT_EQ(parseIpBatch("1.2.3.4\t1\nbad\t2\r\n5.6.7.8\n1.2.3.999\n", pool, &invalid), 2u);
+    ASSERT_EQ(pool.size(), 2u);
+    EXPECT_EQ(pool[1].key(), 0x05060708u);
+    EXPECT_EQ(invalid.count(), 2u);
+    ASSERT_EQ(invalid.samples().size(), 1u);
+    EXPECT_EQ(invalid.samples()[0].line, "bad\t2");
+
+    // столбцы: строка с плохим полем снимается целиком
+    InvalidLines::setActive(&invalid);
+    ColumnTable table({2, 3});
+    table.parse("1.1.1.1\t1\t2\n2.2.2.2\t3\tx\n3.3.3.3\t4\n4.4.4.4\t5\t6\n");
+    InvalidLines::setActive(nullptr);
+    EXPECT_EQ(invalid.count(), 4u);
+    ASSERT_EQ(table.size(), 2u);
+    EXPECT_EQ(table.column(2), (std::vector<int64_t>{1, 5}));
+    EXPECT_EQ(table.column(3), (std::vector<int64_t>{2, 6}));
+}
+
+// арена растет кусками, не перемещая уже добавленные адреса
+TEST(IpPoolTest, GrowsInPlace) {
+    const size_t rows = 3 * IpPool::kChunkBytes / sizeof(IpAddress) + 5;
+    IpPool pool(rows);
+    EXPECT_TRUE(pool.empty());
+    pool.push_back(IpAddress(1, 2, 3, 4));
+    const IpAddress* first = pool.data();
+    for (size_t i = 1; i < rows; ++i) {
+        pool.push_back(IpAddress::fromKey(static_cast<uint32_t>(i)));
+    }
+    EXPECT_EQ(pool.data(), first);
+    ASSERT_EQ(pool.size(), rows);
+    EXPECT_EQ(pool.data()[0].key(), 0x01020304u);
+    EXPECT_EQ(pool.data()[rows - 1].key(), rows - 1);
+    EXPECT_THROW(pool.push_back(IpAddress(0, 0, 0, 0)), std::length_error);
+
+    // разбор в арену - тот же пул, что и в вектор; граница резерва по размеру входа
+    const std::string data = "0.0.0.0\n10.0.0.1\t5\n\n0.0.0.1";
+    IpPool parsed(IpPool::maxRowsFor(data.size()), IpPool::Pages::HugeTlb);
+    std::vector<IpAddress> expected;
+    readIpAddresses(data, parsed);
+    readIpAddresses(data, expected);
+    IpSpan span = parsed;
+    ASSERT_EQ(span.size(), expected.size());
+    EXPECT_TRUE(std::equal(span.begin(), span.end(), expected.begin(),
+                           [](const IpAddress& a, const IpAddress& b) { return a.key() == b.key(); }));
+
+    IpPool moved = std::move(parsed);
+    EXPECT_EQ(moved.size(), 3u);
+    EXPECT_TRUE(parsed.empty());
+}
+
+// тест разбора строк напрямую из буфера (без getline)
+TEST(ReadInputTest, LinesFromBuffer) {
+    std::vector<IpAddress> ipPool;
+    readIpAddresses("1.2.3.4\t111\t0\n\n10.0.0.1\t5\t6\r\n46.70.1.1", ipPool);
+    
+    ASSERT_EQ(ipPool.size(), 3u);
+    EXPECT_EQ(ipPool[0].octets[3], 4);
+    EXPECT_EQ(ipPool[1].octets[0], 10);
+    EXPECT_EQ(ipPool[1].octets[3], 1);
+    EXPECT_EQ(ipPool[2].octets[1], 70);
+}
+
 // тест для сортировки
 TEST(SortTest, ReverseLexicographic) {
     std::vector<IpAddress> ipPool = {
@@ -62,6 +218,65 @@ TEST(SortTest, ReverseLexicographic) {
     EXPECT_EQ(ipPool[3].octets[1], 1);
 }
 
+// поразрядная сортировка должна давать тот же порядок, что и std::sort с operator<
+TEST(SortTest, RadixMatchesComparisonSort) {
+    std::vector<IpAddress> ipPool;
+    uint32_t state = 12345;
+    for (int i = 0; i < 5000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        // часть адресов с общим префиксом, чтобы проходы не пропускались целиком
+        ipPool.push_back(IpAddress::fromKey(i % 3 == 0 ? (state & 0x0000FFFF) | 0x2E460000 : state));
+    }
+    std::vector<IpAddress> expected = ipPool;
+    std::sort(expected.begin(), expected.end());
+    
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    
+    for (size_t i = 0; i < ipPool.size(); ++i) {
+        ASSERT_EQ(ipPool[i].key(), expected[i].key()) << i;
+    }
+}
+
+// многопоточный разбор и сортировка дают тот же результат, что однопоточные
+TEST(SortTest, ParallelMatchesSingleThread) {
+    std::string data;
+    uint32_t state = 777;
+    for (int i = 0; i < 40000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        std::ostringstream line;
+        line << IpAddress::fromKey(state) << '\t' << i << "\t0\n";
+        data += line.str();
+    }
+    
+    // перекос: три четверти строк - один адрес, границы диапазонов слияния совпадают
+    std::string skewed;
+    for (int i = 0; i < 40000; ++i) {
+        skewed += i % 4 == 0 ? "10.0.0." + std::to_string(i % 256) + "\t1\t1\n" : "46.70.1.1\t1\t1\n";
+    }
+    
+    for (const std::string* input : {&data, &skewed}) {
+        std::vector<IpAddress> expected;
+        readIpAddresses(*input, expected);
+        radixSort(expected.data(), expected.data() + expected.size());
+        
+        for (unsigned threads : {2u, 5u, 8u}) {
+            std::vector<IpAddress> parsed = parseAndSortParallel(*input, threads);
+            ASSERT_EQ(parsed.size(), expected.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQ(parsed[i].key(), expected[i].key()) << threads << ' ' << i;
+            }
+        }
+    }
+    
+    EXPECT_THROW(parseAndSortParallel(data + "1.2.3\t1\t1\n", 4), std::invalid_argument);
+}
+
+TEST(IpAddressTest, KeyRoundTrip) {
+    IpAddress ip(46, 70, 1, 255);
+    EXPECT_EQ(ip.key(), 0x2E4601FFu);
+    EXPECT_EQ(IpAddress::fromKey(ip.key()).octets[3], 255);
+}
+
 // тесты для variadic-template
 TEST(FilterTest, SingleOctet) {
     std::vector<IpAddress> ipPool = {
@@ -116,3 +331,831 @@ TEST(FilterTest, TwoOctets) {
     EXPECT_TRUE(output.find("46.71.1.1") == std::string::npos);
     EXPECT_TRUE(output.find("47.70.1.1") == std::string::npos);
 }
+
+// индекс: префиксные запросы и списки строк совпадают с линейным проходом
+TEST(IpIndexTest, MatchesLinearScan) {
+    std::vector<IpAddress> ipPool;
+    uint32_t state = 99;
+    for (int i = 0; i < 3000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        // узкий диапазон значений октетов, чтобы совпадений было много
+        ipPool.push_back(IpAddress(static_cast<uint8_t>(state >> 28), static_cast<uint8_t>((state >> 20) % 8),
+                                   static_cast<uint8_t>((state >> 12) % 8), static_cast<uint8_t>(state % 8)));
+    }
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    IpIndex index(ipPool);
+    
+    for (int a = 0; a < 16; ++a) {
+        for (int b = 0; b < 8; ++b) {
+            RowRange range = index.prefix(a, b);
+            size_t expected = std::count_if(ipPool.begin(), ipPool.end(), [&](const IpAddress& ip) {
+                return ip.octets[0] == a && ip.octets[1] == b;
+            });
+            ASSERT_EQ(range.size(), expected);
+            for (size_t row = range.first; row < range.last; ++row) {
+                ASSERT_TRUE(checkOctets(ipPool[row], 0, a, b));
+            }
+        }
+    }
+    
+    for (int v = 0; v < 16; ++v) {
+        std::vector<uint32_t> expected;
+        for (size_t row = 0; row < ipPool.size(); ++row) {
+            if (ipPool[row].contains(static_cast<uint8_t>(v))) expected.push_back(static_cast<uint32_t>(row));
+        }
+        EXPECT_EQ(index.any(static_cast<uint8_t>(v)), expected);
+    }
+    
+    EXPECT_TRUE(index.prefix(200).empty());
+}
+
+// any N по спискам строк индекса дает те же строки, что проход по пулу
+TEST(FilterBatchTest, AnyFromIndexMatchesScan) {
+    std::vector<IpAddress> ipPool;
+    uint32_t state = 7;
+    for (int i = 0; i < 5000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        ipPool.push_back(IpAddress(static_cast<uint8_t>(state >> 29), static_cast<uint8_t>((state >> 16) % 8),
+                                   static_cast<uint8_t>((state >> 8) % 8), static_cast<uint8_t>(state % 8)));
+    }
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    IpIndex index(ipPool);
+
+    FilterBatch batch;
+    batch.add(IpPredicate::any(3));
+    batch.add(IpPredicate::prefix(5));
+    batch.add(IpPredicate::any(0));
+    batch.add(IpPredicate::any(200));
+    EXPECT_EQ(batch.matchRows(ipPool, PoolOrder::Sorted, &index), batch.matchRows(ipPool));
+}
+
+// пакет фильтров за один проход выводит то же, что последовательные фильтры
+TEST(FilterBatchTest, MatchesSequentialFilters) {
+    std::vector<IpAddress> ipPool = {
+        IpAddress(46, 70, 2, 2), IpAddress(46, 70, 1, 1), IpAddress(46, 1, 1, 1), IpAddress(10, 1, 1, 1),
+        IpAddress(2, 46, 1, 1), IpAddress(1, 10, 1, 46), IpAddress(1, 2, 1, 1), IpAddress(1, 1, 1, 1)
+    };
+    
+    std::ostringstream expected;
+    auto old_cout = std::cout.rdbuf(expected.rdbuf());
+    for (const auto& ip : ipPool) std::cout << ip << '\n';
+    filter(ipPool, 1);
+    filter(ipPool, 46, 70);
+    filter_any(ipPool, 46);
+    std::cout.rdbuf(old_cout);
+    
+    FilterBatch batch;
+    batch.add(IpPredicate::all());
+    batch.add(IpPredicate::prefix(1));
+    batch.add(IpPredicate::prefix(46, 70));
+    EXPECT_EQ(batch.add(IpPredicate::any(46)), 3u);
+    
+    std::ostringstream actual;
+    batch.run(ipPool, actual);
+    EXPECT_EQ(actual.str(), expected.str());
+    
+    auto results = batch.match(ipPool);
+    EXPECT_EQ(results[1].size(), 3u);
+    EXPECT_EQ(results[2].size(), 2u);
+    EXPECT_EQ(results[3].size(), 5u);
+}
+
+// быстрый форматтер совпадает с operator<< на всех значениях октетов
+TEST(FormatTest, MatchesStreamOperator) {
+    std::ostringstream expected;
+    std::ostringstream actual;
+    {
+        OutputBuffer out(actual, 64);  // маленький буфер, чтобы сбросы происходили по ходу
+        for (int v = 0; v < 256; ++v) {
+            IpAddress ip(static_cast<uint8_t>(v), static_cast<uint8_t>(255 - v), static_cast<uint8_t>(v / 3), 7);
+            expected << ip << '\n';
+            out.append(ip);
+        }
+        out.append("end\n");
+        expected << "end\n";
+    }
+    EXPECT_EQ(actual.str(), expected.str());
+    
+    char buf[32];
+    EXPECT_EQ(std::string(buf, formatIp(IpAddress(255, 255, 255, 255), buf)), "255.255.255.255");
+}
+
+// литеральные фильтры: маска вычисляется при компиляции
+TEST(FilterTest, CompileTimePrefix) {
+    static_assert(makePrefixMask(46, 70).mask == 0xFFFF0000u, "mask");
+    static_assert(makePrefixMask(46, 70).value == 0x2E460000u, "value");
+    
+    std::vector<IpAddress> ipPool = {
+        IpAddress(46, 70, 2, 2), IpAddress(46, 70, 1, 1), IpAddress(46, 71, 1, 1), IpAddress(1, 70, 1, 1)
+    };
+    
+    std::ostringstream runtime;
+    std::ostringstream literal;
+    auto old_cout = std::cout.rdbuf(runtime.rdbuf());
+    filter(ipPool, 46, 70);
+    std::cout.rdbuf(literal.rdbuf());
+    filter<46, 70>(ipPool);
+    std::cout.rdbuf(old_cout);
+    
+    EXPECT_EQ(runtime.str(), "46.70.2.2\n46.70.1.1\n");
+    EXPECT_EQ(literal.str(), runtime.str());
+    EXPECT_EQ(countPrefixMatches(ipPool.data(), ipPool.data() + ipPool.size(), makePrefixMask(46)), 3u);
+}
+
+// векторные ядра карт совпадений совпадают с поэлементной проверкой
+TEST(MatchKernelTest, AllLevelsMatchScalar) {
+    std::vector<IpAddress> ipPool;
+    uint32_t state = 4242;
+    for (int i = 0; i < 64 * 5 + 37; ++i) {  // несколько полных блоков и хвост
+        state = state * 1664525u + 1013904223u;
+        ipPool.push_back(IpAddress(static_cast<uint8_t>(state >> 24) % 64, static_cast<uint8_t>(state >> 16) % 64,
+                                   static_cast<uint8_t>(state >> 8) % 64, static_cast<uint8_t>(state) % 64));
+    }
+    const PrefixMask prefix = makePrefixMask(3);
+    SimdLevel best = detectSimdLevel();
+    
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Sse41, SimdLevel::Avx2}) {
+        if (static_cast<int>(level) > static_cast<int>(best)) continue;
+        std::vector<uint64_t> any(bitmapWords(ipPool.size()));
+        std::vector<uint64_t> pre(bitmapWords(ipPool.size()));
+        std::vector<uint64_t> range(bitmapWords(ipPool.size()));
+        matchAnyOctetWith(level, ipPool.data(), ipPool.size(), 7, any.data());
+        matchPrefixWith(level, ipPool.data(), ipPool.size(), prefix, pre.data());
+        matchKeyRangeWith(level, ipPool.data(), ipPool.size(), 0x00FF0000u, 10u << 16, 40u << 16, range.data());
+        for (size_t i = 0; i < ipPool.size(); ++i) {
+            ASSERT_EQ((any[i / 64] >> (i % 64)) & 1, ipPool[i].contains(7) ? 1u : 0u) << i;
+            ASSERT_EQ((pre[i / 64] >> (i % 64)) & 1, prefix.matches(ipPool[i].key()) ? 1u : 0u) << i;
+            bool inRange = ipPool[i].octets[1] >= 10 && ipPool[i].octets[1] <= 40;
+            ASSERT_EQ((range[i / 64] >> (i % 64)) & 1, inRange ? 1u : 0u) << i;
+        }
+    }
+}
+
+// счетчик адресов: уникальные адреса по убыванию и число вхождений
+TEST(AddressCounterTest, CountsAndOrder) {
+    AddressCounter counter(true, 4);  // маленькая начальная емкость, чтобы проверить перестроение
+    std::vector<IpAddress> input;
+    for (int i = 0; i < 1000; ++i) {
+        input.push_back(IpAddress(static_cast<uint8_t>(i % 37), 0, 0, static_cast<uint8_t>(i % 3)));
+    }
+    input.push_back(IpAddress(0, 0, 0, 0));
+    counter.add(input.data(), input.data() + input.size());
+    
+    std::vector<IpAddress> expected = input;
+    std::sort(expected.begin(), expected.end());
+    expected.erase(std::unique(expected.begin(), expected.end(),
+                               [](const IpAddress& a, const IpAddress& b) { return a.key() == b.key(); }),
+                   expected.end());
+    
+    std::vector<IpAddress> actual = counter.sortedAddresses();
+    ASSERT_EQ(actual.size(), expected.size());
+    EXPECT_EQ(counter.distinct(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+        EXPECT_EQ(actual[i].key(), expected[i].key());
+    }
+    EXPECT_EQ(counter.count(IpAddress(0, 0, 0, 0)), 11u);  // i = 0, 111, ..., 999 и явный 0.0.0.0
+    EXPECT_EQ(counter.count(IpAddress(200, 0, 0, 0)), 0u);
+    
+    FilterBatch batch;
+    batch.add(IpPredicate::prefix(36));
+    std::vector<uint64_t> counts;
+    for (const auto& ip : actual) counts.push_back(counter.count(ip));
+    std::ostringstream out;
+    batch.runCounted(actual, counts.data(), out);
+    EXPECT_EQ(out.str(), "36.0.0.2\t9\n36.0.0.1\t9\n36.0.0.0\t9\n");
+}
+
+// разбор CIDR и диапазонов
+TEST(RangeTest, Parse) {
+    AddressRange net = parseCidr("10.0.0.0/12");
+    EXPECT_EQ(net.first, IpAddress(10, 0, 0, 0).key());
+    EXPECT_EQ(net.last, IpAddress(10, 15, 255, 255).key());
+    EXPECT_EQ(parseCidr("0.0.0.0/0").last, 0xFFFFFFFFu);
+    EXPECT_EQ(parseCidr("1.2.3.4/32").first, parseCidr("1.2.3.4/32").last);
+    
+    AddressRange range = parseRange("1.2.3.4-1.2.4.0");
+    EXPECT_EQ(range.first, IpAddress(1, 2, 3, 4).key());
+    EXPECT_EQ(range.last, IpAddress(1, 2, 4, 0).key());
+    EXPECT_EQ(parseAddressRange("5.6.7.8").first, IpAddress(5, 6, 7, 8).key());
+    
+    EXPECT_THROW(parseCidr("10.0.0.1/8"), std::invalid_argument);   // биты вне префикса
+    EXPECT_THROW(parseCidr("10.0.0.0/33"), std::invalid_argument);
+    EXPECT_THROW(parseCidr("10.0.0.0/"), std::invalid_argument);
+    EXPECT_THROW(parseRange("1.2.3.5-1.2.3.4"), std::invalid_argument);
+    EXPECT_THROW(RangeSet::parse("10.0.0.0/8\nbad\n"), std::invalid_argument);
+}
+
+// набор диапазонов: склейка пересекающихся и смежных, проверка адреса
+TEST(RangeTest, RangeSetNormalize) {
+    RangeSet set = RangeSet::parse("# блоклист\n10.0.0.0/24\n10.0.1.0/24  # смежная сеть\n"
+                                   "10.0.0.128-10.0.0.200\n\n255.255.255.0/24\n255.255.255.255\n");
+    ASSERT_EQ(set.size(), 2u);
+    EXPECT_EQ(set.ranges()[0].last, IpAddress(10, 0, 1, 255).key());
+    EXPECT_TRUE(set.contains(IpAddress(10, 0, 1, 7)));
+    EXPECT_TRUE(set.contains(IpAddress(255, 255, 255, 255)));
+    EXPECT_FALSE(set.contains(IpAddress(10, 0, 2, 0)));
+    EXPECT_FALSE(set.contains(IpAddress(9, 255, 255, 255)));
+}
+
+// срез пула по диапазону и слияние с набором совпадают с поэлементной проверкой
+TEST(RangeTest, SortedPoolQueries) {
+    std::vector<IpAddress> ipPool;
+    uint32_t state = 99;
+    for (int i = 0; i < 20000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        ipPool.push_back(IpAddress::fromKey(state % (1u << 20) | 0x0A000000u));  // 10.0.0.0/12
+    }
+    std::vector<IpAddress> unsorted = ipPool;
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    
+    AddressRange net = parseCidr("10.4.0.0/14");
+    RowRange rows = rangeRows(ipPool, net);
+    size_t expected = std::count_if(ipPool.begin(), ipPool.end(),
+                                    [&](const IpAddress& ip) { return net.contains(ip.key()); });
+    EXPECT_EQ(rows.size(), expected);
+    for (size_t i = rows.first; i < rows.last; ++i) {
+        EXPECT_TRUE(net.contains(ipPool[i].key()));
+    }
+    
+    std::vector<AddressRange> ranges;
+    for (int i = 0; i < 500; ++i) {
+        state = state * 1664525u + 1013904223u;
+        uint32_t first = 0x0A000000u | state % (1u << 20);
+        ranges.push_back({first, first + state % 512});
+    }
+    FilterBatch batch;
+    batch.add(IpPredicate::rangeSet(RangeSet(ranges)));
+    batch.add(IpPredicate::range(net));
+    
+    // отсортированный пул - слиянием, неотсортированный - поэлементно
+    for (const auto* pool : {&ipPool, &unsorted}) {
+        auto results = batch.match(*pool);
+        for (size_t slot = 0; slot < batch.size(); ++slot) {
+            std::vector<IpAddress> brute;
+            for (const auto& ip : *pool) {
+                if (batch.predicates()[slot].matches(ip)) brute.push_back(ip);
+            }
+            ASSERT_EQ(results[slot].size(), brute.size()) << slot;
+            for (size_t i = 0; i < brute.size(); ++i) {
+                EXPECT_EQ(results[slot][i].key(), brute[i].key());
+            }
+        }
+    }
+}
+
+// снимок: пул, счетчики и списки строк читаются обратно без изменений
+TEST(SnapshotTest, RoundTrip) {
+    std::vector<IpAddress> ipPool;
+    std::vector<uint64_t> counts;
+    for (int i = 0; i < 1001; ++i) {  // нечетное число адресов - счетчики требуют выравнивания
+        ipPool.push_back(IpAddress(static_cast<uint8_t>(i % 7), static_cast<uint8_t>(i), 1, static_cast<uint8_t>(i * 3)));
+        counts.push_back(static_cast<uint64_t>(i) + 1);
+    }
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    IpIndex index(ipPool);
+    
+    std::string path = ::testing::TempDir() + "ip_filter_snapshot_test.bin";
+    saveSnapshot(path, {ipPool, counts.data(), true, &index});
+    {
+        Snapshot snapshot = Snapshot::open(path);
+        ASSERT_EQ(snapshot.pool().size(), ipPool.size());
+        EXPECT_TRUE(snapshot.distinct());
+        ASSERT_NE(snapshot.counts(), nullptr);
+        for (size_t i = 0; i < ipPool.size(); ++i) {
+            EXPECT_EQ(snapshot.pool()[i].key(), ipPool[i].key());
+            EXPECT_EQ(snapshot.counts()[i], counts[i]);
+        }
+        EXPECT_EQ(snapshot.index().any(3), index.any(3));
+        EXPECT_EQ(snapshot.index().prefix(5).size(), index.prefix(5).size());
+    }
+    
+    saveSnapshot(path, {ipPool, nullptr, false, nullptr});
+    Snapshot plain = Snapshot::open(path);
+    EXPECT_EQ(plain.counts(), nullptr);
+    EXPECT_FALSE(plain.distinct());
+    EXPECT_EQ(plain.index().any(3), index.any(3));  // списки строятся заново
+    
+    // одновременные писатели одного пути: у каждого свой временный файл, снимок всегда целый
+    std::vector<IpAddress> small(ipPool.begin(), ipPool.begin() + 10);
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 4; ++w) {
+        writers.emplace_back([&, w] {
+            for (int i = 0; i < 20; ++i) {
+                saveSnapshot(path, {w % 2 ? IpSpan(small) : IpSpan(ipPool), nullptr, false, nullptr});
+            }
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    Snapshot last = Snapshot::open(path);
+    EXPECT_TRUE(last.pool().size() == small.size() || last.pool().size() == ipPool.size());
+    std::remove(path.c_str());
+}
+
+// поврежденный, обрезанный или чужой файл не загружается
+TEST(SnapshotTest, RejectsCorruption) {
+    std::vector<IpAddress> ipPool(100, IpAddress(1, 2, 3, 4));
+    std::string path = ::testing::TempDir() + "ip_filter_snapshot_bad.bin";
+    saveSnapshot(path, {ipPool, nullptr, false, nullptr});
+    
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    auto rewrite = [&](const std::string& content) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << content;
+    };
+    
+    std::string flipped = bytes;
+    flipped[100] ^= 1;  // байт адреса
+    rewrite(flipped);
+    EXPECT_THROW(Snapshot::open(path), std::runtime_error);
+    EXPECT_NO_THROW(Snapshot::open(path, false));  // без проверки суммы - только заголовок
+    
+    rewrite(bytes.substr(0, bytes.size() - 4));
+    EXPECT_THROW(Snapshot::open(path, false), std::runtime_error);
+    
+    std::string header = bytes;
+    header[20] ^= 1;  // число адресов
+    rewrite(header);
+    EXPECT_THROW(Snapshot::open(path, false), std::runtime_error);
+    
+    rewrite("1.2.3.4\t1\t1\n");
+    EXPECT_THROW(Snapshot::open(path), std::runtime_error);
+    
+    // таблица списков строк: границы вне списка и номер строки вне пула
+    IpIndex index(ipPool);
+    saveSnapshot(path, {ipPool, nullptr, false, &index});
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    const size_t postings = 64 + ipPool.size() * sizeof(IpAddress);
+    EXPECT_NO_THROW(Snapshot::open(path, false));
+    
+    std::string offsets = bytes;
+    offsets[postings + 10 * sizeof(uint32_t) + 3] = '\x7f';
+    rewrite(offsets);
+    EXPECT_THROW(Snapshot::open(path, false), std::runtime_error);
+    
+    std::string rows = bytes;
+    rows[postings + IpIndex::kPostingOffsets * sizeof(uint32_t) + 3] = '\x7f';
+    rewrite(rows);
+    EXPECT_THROW(Snapshot::open(path), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+// разбор условий на столбцы
+TEST(ColumnTest, ParsePredicate) {
+    ColumnPredicate gt = parseColumnPredicate("c2>1000");
+    EXPECT_EQ(gt.column, 2u);
+    EXPECT_TRUE(gt.matches(1001));
+    EXPECT_FALSE(gt.matches(1000));
+    EXPECT_TRUE(parseColumnPredicate("c3<=-5").matches(-5));
+    EXPECT_TRUE(parseColumnPredicate("c2!=0").matches(1));
+    EXPECT_TRUE(parseColumnPredicate("c2==7").matches(7));
+    EXPECT_TRUE(parseColumnPredicate("c2=7").matches(7));
+    
+    EXPECT_THROW(parseColumnPredicate("c1>0"), std::invalid_argument);  // c1 - адрес
+    EXPECT_THROW(parseColumnPredicate("c2>"), std::invalid_argument);
+    EXPECT_THROW(parseColumnPredicate("c2~5"), std::invalid_argument);
+    EXPECT_THROW(parseColumnPredicate("x2>5"), std::invalid_argument);
+}
+
+// перестановка сортировки устойчива: равные адреса в исходном порядке
+TEST(ColumnTest, SortOrderIsStable) {
+    std::vector<IpAddress> input;
+    for (int i = 0; i < 1000; ++i) {
+        input.push_back(IpAddress(static_cast<uint8_t>(i % 5), 0, static_cast<uint8_t>(i % 3), 1));
+    }
+    std::vector<uint32_t> order = radixSortOrder(input.data(), input.size());
+    ASSERT_EQ(order.size(), input.size());
+    for (size_t i = 1; i < order.size(); ++i) {
+        const IpAddress& prev = input[order[i - 1]];
+        const IpAddress& cur = input[order[i]];
+        ASSERT_FALSE(cur < prev);
+        if (prev.key() == cur.key()) {
+            EXPECT_LT(order[i - 1], order[i]);
+        }
+    }
+    
+    // номера строк - uint32_t: пул от 2^32 строк отвергается до обращения к данным
+    const size_t huge = size_t{1} << 32;
+    EXPECT_THROW(radixSortOrder(input.data(), huge), std::length_error);
+    FilterBatch batch;
+    batch.add(IpPredicate::any(1));
+    EXPECT_THROW(batch.matchRows(IpSpan(input.data(), huge)), std::length_error);
+}
+
+// таблица столбцов: условия, сортировка вместе со столбцами и свертка по адресу
+TEST(ColumnTest, FilterSortAggregate) {
+    ColumnTable table({3, 2});
+    table.parse("1.1.1.1\t10\t1\n2.2.2.2\t2000\t2\r\n\n1.1.1.1\t3000\t-4\n"
+                "3.3.3.3\t5000\t8\tлишний столбец\n2.2.2.2\t4000\t16");
+    ASSERT_EQ(table.size(), 5u);
+    EXPECT_EQ(table.column(2)[3], 5000);
+    EXPECT_THROW(table.column(4), std::invalid_argument);
+    
+    table.filter({parseColumnPredicate("c2>1000")});
+    ASSERT_EQ(table.size(), 4u);
+    table.sortByAddress();
+    EXPECT_EQ(table.addresses()[0].key(), IpAddress(3, 3, 3, 3).key());
+    EXPECT_EQ(table.column(3), (std::vector<int64_t>{8, 2, 16, -4}));
+    
+    ColumnAggregate totals = aggregateByAddress(table, 3);
+    ASSERT_EQ(totals.addresses.size(), 3u);
+    EXPECT_EQ(totals.counts, (std::vector<uint64_t>{1, 2, 1}));
+    EXPECT_EQ(totals.sums, (std::vector<int64_t>{8, 18, -4}));
+    
+    FilterBatch batch;
+    batch.add(IpPredicate::all());
+    std::ostringstream out;
+    batch.runCounted(totals.addresses, totals.counts.data(), out, totals.sums.data());
+    EXPECT_EQ(out.str(), "3.3.3.3\t1\t8\n2.2.2.2\t2\t18\n1.1.1.1\t1\t-4\n");
+    
+    // переполнение суммы - ошибка, а не перенос через знак
+    ColumnTable huge({2});
+    huge.parse("1.1.1.1\t9223372036854775807\n1.1.1.1\t1\n2.2.2.2\t-1\n");
+    huge.sortByAddress();
+    EXPECT_THROW(aggregateByAddress(huge, 2), std::runtime_error);
+    
+    ColumnTable bad({2});
+    EXPECT_THROW(bad.parse("1.1.1.1\n"), std::invalid_argument);
+    EXPECT_THROW(bad.parse("1.1.1.1\tx\n"), std::invalid_argument);
+}
+
+namespace {
+
+std::string text6(const Ip6Address& ip) {
+    char buffer[kMaxIp6TextLength];
+    return std::string(buffer, formatIp6(ip, buffer));
+}
+
+} // namespace
+
+// IPv6: разбор всех форм записи и каноническая запись RFC 5952
+TEST(Ip6Test, ParseAndFormat) {
+    EXPECT_EQ(text6(parseIp6("2001:0DB8:0:0:0:0:0:1")), "2001:db8::1");
+    EXPECT_EQ(text6(parseIp6("::")), "::");
+    EXPECT_EQ(text6(parseIp6("::1")), "::1");
+    EXPECT_EQ(text6(parseIp6("fe80::")), "fe80::");
+    EXPECT_EQ(text6(parseIp6("2001:db8:0:1:0:0:0:1")), "2001:db8:0:1::1");  // сжимается самый длинный ряд
+    EXPECT_EQ(text6(parseIp6("2001:db8:0:1:1:1:1:1")), "2001:db8:0:1:1:1:1:1"); // одиночный ноль не сжимается
+    EXPECT_EQ(text6(parseIp6("::ffff:192.168.1.1")), "::ffff:192.168.1.1");
+    
+    Ip6Address ip = parseIp6("1:2:3:4:5:6:7:8");
+    EXPECT_EQ(ip.octets[0], 0);
+    EXPECT_EQ(ip.octets[1], 1);
+    EXPECT_EQ(ip.octets[15], 8);
+    EXPECT_EQ(Ip6Address::fromKey(ip.key()).key(), ip.key());
+    
+    EXPECT_THROW(parseIp6("1:2:3:4:5:6:7"), std::invalid_argument);
+    EXPECT_THROW(parseIp6("1::2::3"), std::invalid_argument);
+    EXPECT_THROW(parseIp6("12345::"), std::invalid_argument);
+    EXPECT_THROW(parseIp6("1:2:3:4:5:6:7:8:9"), std::invalid_argument);
+    EXPECT_THROW(parseIp6("g::1"), std::invalid_argument);
+}
+
+// IPv6: сортировка по убыванию и фильтры по октетам
+TEST(Ip6Test, SortAndFilter) {
+    std::vector<Ip6Address> pool;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        uint32_t x = i * 2654435761u;
+        pool.push_back(Ip6Address::fromKey((Uint128(x) << 96) | (Uint128(i) << 7) | (x & 0xff)));
+    }
+    std::vector<Ip6Address> expected = pool;
+    std::sort(expected.begin(), expected.end());
+    radixSort(pool.data(), pool.data() + pool.size());
+    ASSERT_TRUE(std::equal(pool.begin(), pool.end(), expected.begin(),
+                           [](const Ip6Address& a, const Ip6Address& b) { return a.key() == b.key(); }));
+    EXPECT_GT(pool.front().key(), pool.back().key());
+    
+    std::vector<Ip6Address> small = {parseIp6("2001:db8::1"), parseIp6("fe80::2e"), parseIp6("::46")};
+    radixSort(small.data(), small.data() + small.size());
+    std::ostringstream out;
+    for (const auto& ip : small) out << ip << '\n';
+    EXPECT_EQ(out.str(), "fe80::2e\n2001:db8::1\n::46\n");
+    
+    std::ostringstream any;
+    std::streambuf* old = std::cout.rdbuf(any.rdbuf());
+    filter_any(small, 0x46);
+    filter(small, 0x20, 0x01);
+    std::cout.rdbuf(old);
+    EXPECT_EQ(any.str(), "::46\n2001:db8::1\n");
+    
+    // фильтры IPv4 видят только отображенные адреса ::ffff:a.b.c.d
+    IpPredicate prefix = IpPredicate::prefix(0x20, 0x01);
+    EXPECT_FALSE(prefix.matches(small[1]));
+    EXPECT_FALSE(IpPredicate::any(0x2e).matches(small[0]));
+    EXPECT_TRUE(IpPredicate::all().matches(small[0]));
+    EXPECT_TRUE(IpPredicate::prefix(10, 1).matches(parseIp6("::ffff:10.1.2.3")));
+    EXPECT_TRUE(IpPredicate::range(parseCidr("10.0.0.0/8")).matches(parseIp6("::ffff:10.1.2.3")));
+    EXPECT_FALSE(IpPredicate::prefix(10, 1).matches(parseIp6("::10.1.2.3")));
+}
+
+// смешанный журнал: адреса IPv4 идут пакетом, IPv6 - отдельным пулом
+TEST(Ip6Test, MixedInput) {
+    std::vector<IpAddress> v4;
+    std::vector<Ip6Address> v6;
+    readMixedAddresses("1.2.3.4\ta\n2001:db8::1\tb\r\n5.6.7.8\n\n::1\n9.9.9.9\tc\n::ffff:1.0.0.1", v4, v6);
+    ASSERT_EQ(v4.size(), 3u);
+    ASSERT_EQ(v6.size(), 3u);
+    EXPECT_EQ(v4[2].key(), IpAddress(9, 9, 9, 9).key());
+    EXPECT_EQ(text6(v6[0]), "2001:db8::1");
+    
+    FilterBatch batch;
+    batch.add(IpPredicate::all());
+    batch.add(IpPredicate::any(1));
+    radixSort(v4.data(), v4.data() + v4.size());
+    radixSort(v6.data(), v6.data() + v6.size());
+    std::ostringstream out;
+    batch.run(v4, v6, out);
+    EXPECT_EQ(out.str(), "9.9.9.9\n5.6.7.8\n1.2.3.4\n2001:db8::1\n::ffff:1.0.0.1\n::1\n1.2.3.4\n::ffff:1.0.0.1\n");
+    
+    EXPECT_THROW(readMixedAddresses("1::2::3\n", v4, v6), std::invalid_argument);
+
+    // IPv6 - только ':' в первом столбце
+    EXPECT_FALSE(hasIp6Lines("1.2.3.4\t12:00\n5.6.7.8\thttp://x\n"));
+    EXPECT_TRUE(hasIp6Lines("1.2.3.4\t12:00\n::1\t1\n"));
+    EXPECT_TRUE(hasIp6Lines("1.2.3.4\n2001:db8::1"));
+    EXPECT_FALSE(hasIp6Lines(""));
+}
+
+// --stats: описания фильтров и отчет JSON с этапами и совпадениями
+TEST(StatsTest, ReportsStagesAndMatches) {
+    EXPECT_EQ(describePredicate(IpPredicate::all()), "all");
+    EXPECT_EQ(describePredicate(IpPredicate::prefix(46, 70)), "prefix 46.70");
+    EXPECT_EQ(describePredicate(IpPredicate::any(46)), "any 46");
+    EXPECT_EQ(describePredicate(IpPredicate::range(parseCidr("10.0.0.0/8"))), "ranges 1");
+    
+    RunStats& stats = RunStats::enable();
+    stats.reset();
+    FilterBatch batch;
+    batch.add(IpPredicate::prefix(1));
+    batch.add(IpPredicate::any(46));
+    std::vector<IpAddress> pool = {IpAddress(46, 1, 1, 1), IpAddress(1, 46, 0, 0), IpAddress(1, 2, 3, 4)};
+    radixSort(pool.data(), pool.data() + pool.size());
+    std::ostringstream out;
+    batch.run(pool, out);
+    
+    std::ostringstream json;
+    stats.report(json, StatsFormat::Json);
+    const std::string report = json.str();
+    EXPECT_NE(report.find("\"status\":\"ok\""), std::string::npos);
+    EXPECT_NE(report.find("{\"name\":\"filter\""), std::string::npos);
+    EXPECT_NE(report.find("{\"filter\":\"prefix 1\",\"matches\":2}"), std::string::npos);
+    EXPECT_NE(report.find("{\"filter\":\"any 46\",\"matches\":2}"), std::string::npos);
+    EXPECT_EQ(report.back(), '\n');
+    
+    // остальные тесты идут без сбора
+    stats.reset();
+    RunStats::disable();
+    EXPECT_EQ(RunStats::active(), nullptr);
+}
+
+// -q: склейка равенств октетов в маску, свертка констант, границы и ошибки разбора
+TEST(QueryTest, CompileAndSimplify) {
+    using Op = QueryProgram::Instruction::Op;
+    
+    QueryProgram prefix = QueryProgram::compile("o2 == 70 && o1==46");
+    ASSERT_EQ(prefix.code().size(), 1u);
+    EXPECT_EQ(prefix.code()[0].op, Op::Mask);
+    EXPECT_EQ(prefix.code()[0].mask, 0xFFFF0000u);
+    EXPECT_EQ(prefix.code()[0].value, IpAddress(46, 70, 0, 0).key());
+    EXPECT_EQ(prefix.bounds().first, IpAddress(46, 70, 0, 0).key());
+    EXPECT_EQ(prefix.bounds().last, IpAddress(46, 70, 255, 255).key());
+    
+    EXPECT_EQ(QueryProgram::compile("!!any==5").code().size(), 1u);
+    EXPECT_EQ(QueryProgram::compile("o3>=0 && any==5").code().size(), 1u);  // o3>=0 - всегда истина
+    EXPECT_EQ(QueryProgram::compile("o1==1 && o1==2").code()[0].op, Op::Const);
+    EXPECT_FALSE(QueryProgram::compile("any==5 || o1==1").bounded());
+    
+    // || - объемлющий диапазон, && - пересечение
+    QueryProgram either = QueryProgram::compile("(o1<10 || cidr 20.0.0.0/8) && o4!=0");
+    EXPECT_EQ(either.bounds().first, 0u);
+    EXPECT_EQ(either.bounds().last, IpAddress(20, 255, 255, 255).key());
+    QueryProgram empty = QueryProgram::compile("ip<1.0.0.0 && ip>2.0.0.0 && any==3");
+    EXPECT_GT(empty.bounds().first, empty.bounds().last);
+    
+    // одиночные условия - обычные фильтры с векторными ядрами
+    EXPECT_EQ(IpPredicate::query("o1==46 && o2==70").kind, IpPredicate::Kind::Prefix);
+    EXPECT_EQ(IpPredicate::query("o2==70").kind, IpPredicate::Kind::Query);
+    EXPECT_EQ(IpPredicate::query("o1==46 && o3==1").kind, IpPredicate::Kind::Query);
+    EXPECT_EQ(describePredicate(IpPredicate::query("o2==70")), "query o2==70");
+    EXPECT_EQ(IpPredicate::query("any==46").kind, IpPredicate::Kind::Any);
+    EXPECT_EQ(IpPredicate::query("range 1.0.0.0-1.0.0.9").kind, IpPredicate::Kind::Ranges);
+    EXPECT_EQ(IpPredicate::query("o1==46 && any==70").kind, IpPredicate::Kind::Query);
+    
+    for (const char* bad : {"", "o5==1", "o1==256", "o1=1", "any<3", "(o1==1", "o1==1 &&", "ip==1.2.3",
+                            "cidr 10.0.0.1/8", "o1==1 o2==2", "foo"}) {
+        EXPECT_THROW(QueryProgram::compile(bad), std::invalid_argument) << bad;
+    }
+    try {
+        QueryProgram::compile("o1==1 && bar");
+        FAIL();
+    } catch (const std::invalid_argument& e) {
+        EXPECT_NE(std::string(e.what()).find("позиция 10"), std::string::npos) << e.what();
+    }
+    
+    // вложенность ограничена при разборе, а не после него (иначе - переполнение стека)
+    const std::string deep = std::string(20000, '(') + "all" + std::string(20000, ')');
+    EXPECT_THROW(QueryProgram::compile(deep), std::invalid_argument);
+    EXPECT_THROW(QueryProgram::compile(std::string(120000, '!') + "all"), std::invalid_argument);
+    EXPECT_NO_THROW(QueryProgram::compile(std::string(8, '(') + "o1==1" + std::string(8, ')')));
+}
+
+// байт-код над картами, поэлементная проверка и пакет на отсортированном и
+// неотсортированном пуле совпадают с условием, записанным на C++
+TEST(QueryTest, MatchesBruteForce) {
+    std::vector<IpAddress> ipPool;
+    uint32_t state = 7;
+    for (int i = 0; i < 10000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        ipPool.push_back(IpAddress(static_cast<uint8_t>(state >> 24) % 16, static_cast<uint8_t>(state >> 16),
+                                   static_cast<uint8_t>(state >> 8) % 8, static_cast<uint8_t>(state)));
+    }
+    std::vector<IpAddress> unsorted = ipPool;
+    radixSort(ipPool.data(), ipPool.data() + ipPool.size());
+    
+    struct Case {
+        const char* text;
+        bool (*expected)(const IpAddress&);
+    };
+    const Case cases[] = {
+        {"o1==3 && (o2<50 || o4>=250) && !any==5",
+         [](const IpAddress& ip) { return ip.octets[0] == 3 && (ip.octets[1] < 50 || ip.octets[3] >= 250) && !ip.contains(5); }},
+        {"any==1 || o3==2",
+         [](const IpAddress& ip) { return ip.contains(1) || ip.octets[2] == 2; }},
+        {"cidr 4.0.0.0/7 && !(o4==0 || o4>200) && o2!=7",
+         [](const IpAddress& ip) { return (ip.octets[0] == 4 || ip.octets[0] == 5) && ip.octets[3] != 0 && ip.octets[3] <= 200 && ip.octets[1] != 7; }},
+        {"(o1<=2 || ip>=14.128.0.0) && o4>10",
+         [](const IpAddress& ip) { return (ip.octets[0] <= 2 || ip.key() >= IpAddress(14, 128, 0, 0).key()) && ip.octets[3] > 10; }},
+        {"range 1.2.0.0-9.0.0.0 && o1>=9",
+         [](const IpAddress& ip) { return ip.key() >= IpAddress(9, 0, 0, 0).key() && ip.key() <= IpAddress(9, 0, 0, 0).key(); }},
+    };
+    
+    FilterBatch batch;
+    for (const auto& c : cases) {
+        batch.add(IpPredicate::query(c.text));
+        QueryProgram program = QueryProgram::compile(c.text);
+        std::vector<uint64_t> bitmap(bitmapWords(unsorted.size()));
+        std::vector<uint64_t> scratch;
+        program.match(unsorted.data(), unsorted.size(), bitmap.data(), scratch);
+        for (size_t i = 0; i < unsorted.size(); ++i) {
+            ASSERT_EQ(program.matches(unsorted[i]), c.expected(unsorted[i])) << c.text << " " << i;
+            ASSERT_EQ((bitmap[i / 64] >> (i % 64)) & 1, c.expected(unsorted[i]) ? 1u : 0u) << c.text << " " << i;
+        }
+    }
+    
+    // отсортированный пул - только строки внутри границ, неотсортированный - полный проход
+    for (const auto* pool : {&ipPool, &unsorted}) {
+        auto results = batch.match(*pool);
+        for (size_t slot = 0; slot < batch.size(); ++slot) {
+            std::vector<IpAddress> brute;
+            std::copy_if(pool->begin(), pool->end(), std::back_inserter(brute), cases[slot].expected);
+            ASSERT_EQ(results[slot].size(), brute.size()) << cases[slot].text;
+            for (size_t i = 0; i < brute.size(); ++i) {
+                EXPECT_EQ(results[slot][i].key(), brute[i].key());
+            }
+        }
+    }
+}
+
+// сервер: ответы совпадают с пакетом фильтров, ошибки не рвут соединение,
+// reload подменяет пул, пока другие клиенты продолжают запросы
+TEST(ServerTest, QueriesAndHotSwap) {
+    const std::string dataPath = ::testing::TempDir() + "ip_filter_server_test.tsv";
+    const std::string nextPath = ::testing::TempDir() + "ip_filter_server_next.tsv";
+    const std::string socketPath = ::testing::TempDir() + "ip_filter_server_test.sock";
+    std::ofstream(dataPath) << "1.2.3.4\tx\n46.70.1.1\n46.70.9.9\n46.1.1.1\n10.0.0.1\n";
+    std::ofstream(nextPath) << "46.70.2.2\n8.8.8.8\n";
+    
+    PoolServer server(socketPath, {dataPath, "", 1}, 4);
+    struct stat socketStat{};
+    ASSERT_EQ(::stat(socketPath.c_str(), &socketStat), 0);
+    EXPECT_EQ(socketStat.st_mode & 0777, 0600u);  // только владелец
+    // живой сокет и обычный файл не заменяются
+    EXPECT_THROW(PoolServer(socketPath, {dataPath, "", 1}, 1), std::runtime_error);
+    EXPECT_THROW(PoolServer(nextPath, {dataPath, "", 1}, 1), std::runtime_error);
+    EXPECT_EQ(::stat(nextPath.c_str(), &socketStat), 0);
+    EXPECT_TRUE(S_ISREG(socketStat.st_mode));
+    std::thread loop([&server] { server.run(); });
+    {
+        ServerClient client(socketPath);
+        ServerReply reply = client.request("filter 46.70");
+        EXPECT_TRUE(reply.ok);
+        EXPECT_EQ(reply.data, "46.70.9.9\n46.70.1.1\n");
+        EXPECT_EQ(reply.status, "2");
+        EXPECT_EQ(client.request("count any 1").status, "4");
+        EXPECT_EQ(client.request("cidr 10.0.0.0/8").data, "10.0.0.1\n");
+        EXPECT_EQ(client.request("query o1==46 && o2!=70").data, "46.1.1.1\n");
+        EXPECT_EQ(client.request("count query all").status, "5");
+        
+        ServerReply error = client.request("filter 300");
+        EXPECT_FALSE(error.ok);
+        EXPECT_NE(error.status.find("300"), std::string::npos);
+        EXPECT_FALSE(client.request("unknown 1").ok);
+        EXPECT_TRUE(client.request("info").ok);  // соединение живо после ошибок
+        
+        // пока одни клиенты спрашивают, пул подменяется: каждый ответ - от одной из версий
+        std::vector<std::thread> readers;
+        std::vector<std::string> answers(8);
+        for (size_t i = 0; i < answers.size(); ++i) {
+            readers.emplace_back([&socketPath, &answers, i] {
+                ServerClient reader(socketPath);
+                for (int j = 0; j < 50; ++j) {
+                    std::string count = reader.request("count filter 46.70").status;
+                    if (count != "2" && count != "1") answers[i] = count;
+                }
+            });
+        }
+        std::shared_ptr<const ServedPool> before = server.pool();
+        ServerReply reload = client.request("reload " + nextPath);
+        for (auto& reader : readers) reader.join();
+        for (const auto& answer : answers) EXPECT_EQ(answer, "");
+        
+        EXPECT_EQ(reload.status, "rows=2 runs=1 generation=2 source=" + nextPath);
+        EXPECT_EQ(before->rows(), 5u);  // старая версия жива, пока ее держат
+        EXPECT_EQ(client.request("filter 46").data, "46.70.2.2\n");
+        EXPECT_FALSE(client.request("reload /nonexistent/file").ok);
+        EXPECT_EQ(server.pool()->generation, 2u);
+        EXPECT_TRUE(client.request("shutdown").ok);
+    }
+    loop.join();
+    std::remove(dataPath.c_str());
+    std::remove(nextPath.c_str());
+}
+
+// серии: слияние совпадает с полной сортировкой, уплотнение держит набор логарифмическим
+TEST(RunsTest, MergeAndCompaction) {
+    std::vector<SortedRun> runs;
+    std::vector<IpAddress> all;
+    uint32_t state = 11;
+    for (int step = 0; step < 200; ++step) {
+        std::vector<IpAddress> batch;
+        size_t size = 1 + (step * 37) % 300;
+        for (size_t i = 0; i < size; ++i) {
+            state = state * 1664525u + 1013904223u;
+            batch.push_back(IpAddress::fromKey(state % 5000));  // повторы между сериями
+        }
+        all.insert(all.end(), batch.begin(), batch.end());
+        runs.push_back(makeRun(std::move(batch)));
+        
+        for (RowRange range = compactionRange(runs); !range.empty(); range = compactionRange(runs)) {
+            std::vector<IpSpan> spans;
+            for (size_t i = range.first; i < range.last; ++i) spans.emplace_back(*runs[i]);
+            SortedRun merged = std::make_shared<const AddressRun>(mergeSorted(spans));
+            runs.erase(runs.begin() + range.first, runs.begin() + range.last);
+            runs.push_back(merged);
+        }
+        // каждая серия хотя бы вдвое больше всех более новых
+        size_t tail = 0;
+        for (size_t i = runs.size(); i-- > 1;) {
+            tail += runs[i]->size();
+            ASSERT_GE(runs[i - 1]->size(), 2 * tail) << step;
+        }
+    }
+    EXPECT_LE(runs.size(), 8u);
+    
+    std::vector<IpSpan> spans;
+    for (const auto& run : runs) spans.emplace_back(*run);
+    std::vector<IpAddress> merged = mergeSorted(spans);
+    radixSort(all.data(), all.data() + all.size());
+    ASSERT_EQ(merged.size(), all.size());
+    for (size_t i = 0; i < all.size(); ++i) {
+        ASSERT_EQ(merged[i].key(), all[i].key()) << i;
+    }
+}
+
+// append: новые серии видны сразу, ответы совпадают с полностью отсортированным пулом
+TEST(ServerTest, AppendAndCompaction) {
+    const std::string dataPath = ::testing::TempDir() + "ip_filter_append_base.tsv";
+    const std::string batchPath = ::testing::TempDir() + "ip_filter_append_batch.tsv";
+    const std::string socketPath = ::testing::TempDir() + "ip_filter_append_test.sock";
+    std::ofstream(dataPath) << "46.70.1.1\n1.1.1.1\n";
+    
+    PoolServer server(socketPath, {dataPath, "", 1}, 2);
+    std::vector<std::string> expected = {"46.70.1.1", "1.1.1.1"};
+    for (int i = 0; i < 20; ++i) {
+        std::string address = "46.70." + std::to_string(i) + ".9";
+        std::ofstream(batchPath) << address << "\n";
+        expected.push_back(address);
+        EXPECT_TRUE(server.handle("append " + batchPath).compare(0, 3, "OK ") == 0);
+    }
+    while (server.compactOnce()) {
+    }
+    EXPECT_EQ(server.pool()->generation, 21u);
+    EXPECT_LE(server.pool()->runs.size(), 4u);
+    
+    std::vector<IpAddress> sorted;
+    for (const auto& address : expected) sorted.push_back(parseIp(address));
+    radixSort(sorted.data(), sorted.data() + sorted.size());
+    std::ostringstream rows;
+    for (const auto& ip : sorted) rows << ip << '\n';
+    EXPECT_EQ(server.handle("query all"), rows.str() + "OK 22\n");
+    EXPECT_EQ(server.handle("count filter 46.70"), "OK 21\n");
+    EXPECT_NE(server.handle("append /nonexistent/file").find("ERR"), std::string::npos);
+    std::remove(dataPath.c_str());
+    std::remove(batchPath.c_str());
+}
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+DATA_FILE="$(dirname "$0")/../test_data/ip_filter.tsv"
+
+# --stats пишет только в stderr: вывод тот же
+"$EXECUTABLE_PATH" "$DATA_FILE" > "$TMP_DIR/plain.txt"
+"$EXECUTABLE_PATH" --stats=json "$DATA_FILE" > "$TMP_DIR/stats.txt" 2> "$TMP_DIR/stats.json"
+if ! cmp -s "$TMP_DIR/plain.txt" "$TMP_DIR/stats.txt"; then
+    echo "Test 10: Failed - --stats changes the report"
+    exit 1
+fi
+
+for key in '"status":"ok"' '"name":"parse","ms":' '"rows":1000,' '"peak_rss_bytes":' \
+           '"allocations":' '"parse_errors":0' '"filter":"any 46","matches":'; do
+    if ! grep -qF "$key" "$TMP_DIR/stats.json"; then
+        echo "Test 10: Failed - no $key in JSON report"
+        cat "$TMP_DIR/stats.json"
+        exit 1
+    fi
+done
+
+# ошибка разбора: отчет все равно выводится и учитывает ее
+printf '1.2.3.4\nbad\n' | "$EXECUTABLE_PATH" --stats=json > /dev/null 2> "$TMP_DIR/error.json"
+if ! grep -qF '"status":"error"' "$TMP_DIR/error.json" || ! grep -qF '"parse_errors":1' "$TMP_DIR/error.json"; then
+    echo "Test 10: Failed - error run is not reported"
+    cat "$TMP_DIR/error.json"
+    exit 1
+fi
+
+echo "Test 10: stats tests passed"
+exit 0
@@ -0,0 +1,52 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+DATA_FILE="$(dirname "$0")/../test_data/ip_filter.tsv"
+
+# запрос из одного условия - то же, что соответствующий фильтр
+check_same() {
+    "$EXECUTABLE_PATH" $1 "$DATA_FILE" > "$TMP_DIR/expected.txt"
+    "$EXECUTABLE_PATH" -q "$2" "$DATA_FILE" > "$TMP_DIR/actual.txt"
+    if ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt"; then
+        echo "Test 11: Failed - -q '$2' differs from $1"
+        exit 1
+    fi
+}
+
+check_same "--filter 46.70" "o1==46 && o2==70"
+check_same "--any 46" "any==46"
+check_same "--cidr 46.0.0.0/8" "cidr 46.0.0.0/8"
+
+# составное условие сверяется с awk по отсортированному выводу
+"$EXECUTABLE_PATH" "$DATA_FILE" | head -n 1000 \
+    | awk -F. '$1 == 46 && ($2 < 50 || $4 >= 250) && $1 != 70 && $2 != 70 && $3 != 70 && $4 != 70' \
+    > "$TMP_DIR/expected.txt"
+"$EXECUTABLE_PATH" -q "o1==46 && (o2<50 || o4>=250) && !any==70" "$DATA_FILE" > "$TMP_DIR/actual.txt"
+if [ ! -s "$TMP_DIR/expected.txt" ] || ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt"; then
+    echo "Test 11: Failed - compound query"
+    diff "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt" | head
+    exit 1
+fi
+
+# ошибка разбора - с позицией и ненулевым кодом выхода
+if "$EXECUTABLE_PATH" -q "o1==46 && o9==1" "$DATA_FILE" > /dev/null 2> "$TMP_DIR/error.txt"; then
+    echo "Test 11: Failed - invalid query accepted"
+    exit 1
+fi
+if ! grep -qF "позиция 11" "$TMP_DIR/error.txt"; then
+    echo "Test 11: Failed - no error position"
+    cat "$TMP_DIR/error.txt"
+    exit 1
+fi
+
+echo "Test 11: query tests passed"
+exit 0
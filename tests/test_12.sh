@@ -0,0 +1,78 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+SERVER_PID=
+trap '[ -n "$SERVER_PID" ] && kill $SERVER_PID 2>/dev/null; rm -rf "$TMP_DIR"' EXIT
+
+DATA_FILE="$(dirname "$0")/../test_data/ip_filter.tsv"
+SOCKET="$TMP_DIR/ip_filter.sock"
+
+"$EXECUTABLE_PATH" --serve "$SOCKET" --workers 2 "$DATA_FILE" 2> "$TMP_DIR/server.log" &
+SERVER_PID=$!
+for _ in $(seq 1 50); do
+    [ -S "$SOCKET" ] && break
+    sleep 0.1
+done
+
+# ответы сервера совпадают с обычным запуском
+"$EXECUTABLE_PATH" --filter 1 --filter 46.70 --any 46 "$DATA_FILE" > "$TMP_DIR/expected.txt"
+"$EXECUTABLE_PATH" --connect "$SOCKET" --request "filter 1" --request "filter 46.70" --request "any 46" \
+    > "$TMP_DIR/actual.txt"
+if ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt"; then
+    echo "Test 12: Failed - server answers differ from a regular run"
+    exit 1
+fi
+
+# count и reload нового файла
+head -n 10 "$DATA_FILE" > "$TMP_DIR/small.tsv"
+RELOAD=$("$EXECUTABLE_PATH" --connect "$SOCKET" --request "count query all" --request "reload $TMP_DIR/small.tsv" \
+         --request "count query all")
+if [ "$RELOAD" != "$(printf '1000\nrows=10 runs=1 generation=2 source=%s\n10' "$TMP_DIR/small.tsv")" ]; then
+    echo "Test 12: Failed - unexpected count/reload output: $RELOAD"
+    exit 1
+fi
+
+# append: новые строки видны сразу, пул не перечитывается
+APPEND=$("$EXECUTABLE_PATH" --connect "$SOCKET" --request "append $TMP_DIR/small.tsv" --request "count query all")
+if [ "$(echo "$APPEND" | tail -n 1)" != "20" ]; then
+    echo "Test 12: Failed - unexpected append output: $APPEND"
+    exit 1
+fi
+
+# ошибка запроса - код выхода клиента, сервер продолжает работать
+if "$EXECUTABLE_PATH" --connect "$SOCKET" --request "cidr 10.0.0.1/8" > /dev/null 2>&1; then
+    echo "Test 12: Failed - invalid request accepted"
+    exit 1
+fi
+
+# запрос с глубокой вложенностью (40 КБ, меньше предела запроса) - ошибка, а не падение сервера
+DEEP="count query $(printf '%.0s(' $(seq 1 20000))all$(printf '%.0s)' $(seq 1 20000))"
+if "$EXECUTABLE_PATH" --connect "$SOCKET" --request "$DEEP" > /dev/null 2>&1; then
+    echo "Test 12: Failed - deeply nested query accepted"
+    exit 1
+fi
+if ! kill -0 $SERVER_PID 2>/dev/null \
+    || [ "$("$EXECUTABLE_PATH" --connect "$SOCKET" --request "count query all")" != "20" ]; then
+    echo "Test 12: Failed - server did not survive a deeply nested query"
+    exit 1
+fi
+
+# SIGTERM: сервер завершается и удаляет сокет
+kill -TERM $SERVER_PID
+wait $SERVER_PID
+STATUS=$?
+SERVER_PID=
+if [ $STATUS -ne 0 ] || [ -e "$SOCKET" ]; then
+    echo "Test 12: Failed - server did not shut down cleanly (status $STATUS)"
+    exit 1
+fi
+
+echo "Test 12: server tests passed"
+exit 0
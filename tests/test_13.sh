@@ -0,0 +1,71 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+DATA_FILE="$(dirname "$0")/../test_data/ip_filter.tsv"
+
+# журнал с испорченными строками: вставлены каждые 100 строк
+awk '{ print } NR % 100 == 0 { print "garbage" NR "\t1\t1"; print "1.2.3.300\t1\t1" }' "$DATA_FILE" > "$TMP_DIR/dirty.tsv"
+BAD_LINES=$(( $(wc -l < "$DATA_FILE") / 100 * 2 ))
+
+# без --skip-invalid - ошибка
+if "$EXECUTABLE_PATH" "$TMP_DIR/dirty.tsv" > /dev/null 2>&1; then
+    echo "Test 13: Failed - dirty input accepted without --skip-invalid"
+    exit 1
+fi
+
+# с --skip-invalid вывод тот же, что на чистом журнале, в stderr - число и образцы
+"$EXECUTABLE_PATH" "$DATA_FILE" > "$TMP_DIR/expected.txt"
+for args in "" "-t 4" "--unique"; do
+    if [ "$args" = "--unique" ]; then
+        "$EXECUTABLE_PATH" --unique "$DATA_FILE" > "$TMP_DIR/expected.txt"
+    fi
+    if ! "$EXECUTABLE_PATH" $args --skip-invalid=2 "$TMP_DIR/dirty.tsv" > "$TMP_DIR/actual.txt" 2> "$TMP_DIR/error.txt"; then
+        echo "Test 13: Failed - --skip-invalid $args exited with error"
+        cat "$TMP_DIR/error.txt"
+        exit 1
+    fi
+    if ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt"; then
+        echo "Test 13: Failed - --skip-invalid $args output differs"
+        exit 1
+    fi
+    if ! grep -qF "Пропущено строк с некорректным адресом: $BAD_LINES" "$TMP_DIR/error.txt" \
+        || [ "$(grep -c '^  ' "$TMP_DIR/error.txt")" -ne 2 ]; then
+        echo "Test 13: Failed - --skip-invalid $args report"
+        cat "$TMP_DIR/error.txt"
+        exit 1
+    fi
+done
+
+# поточный режим тоже пропускает строки
+"$EXECUTABLE_PATH" --stream --filter 46 "$DATA_FILE" > "$TMP_DIR/expected.txt"
+"$EXECUTABLE_PATH" --stream --filter 46 --skip-invalid "$TMP_DIR/dirty.tsv" > "$TMP_DIR/actual.txt" 2> /dev/null
+if ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt"; then
+    echo "Test 13: Failed - --stream --skip-invalid output differs"
+    exit 1
+fi
+
+# число образцов можно задать и следующим аргументом
+"$EXECUTABLE_PATH" --skip-invalid 2 "$TMP_DIR/dirty.tsv" > /dev/null 2> "$TMP_DIR/error.txt"
+if [ "$(grep -c '^  ' "$TMP_DIR/error.txt")" -ne 2 ]; then
+    echo "Test 13: Failed - --skip-invalid N with a separate value"
+    cat "$TMP_DIR/error.txt"
+    exit 1
+fi
+
+# сервер отвергает --skip-invalid: пропуски при reload/append некуда сообщить
+if "$EXECUTABLE_PATH" --serve "$TMP_DIR/sock" --skip-invalid "$DATA_FILE" > /dev/null 2>&1; then
+    echo "Test 13: Failed - --serve accepted --skip-invalid"
+    exit 1
+fi
+
+echo "Test 13: skip-invalid tests passed"
+exit 0
@@ -0,0 +1,50 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+# ~200k строк, чтобы данные разбились на несколько кусков
+awk 'BEGIN { srand(42); for (i = 0; i < 200000; i++)
+    printf "%d.%d.%d.%d\t%d\t%d\n", int(rand()*256), int(rand()*256), int(rand()*256), int(rand()*256), i, i % 7 }' \
+    > "$TMP_DIR/input.tsv"
+
+"$EXECUTABLE_PATH" "$TMP_DIR/input.tsv" > "$TMP_DIR/expected.txt"
+
+for THREADS in 2 3 8; do
+    "$EXECUTABLE_PATH" --threads "$THREADS" "$TMP_DIR/input.tsv" > "$TMP_DIR/actual.txt"
+    if ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt"; then
+        echo "Test 3: Failed - output with --threads $THREADS differs from single-threaded run"
+        exit 1
+    fi
+done
+
+# режимы без сортировки в памяти потоки не используют - -t отвергается, а не теряется
+for args in "--stream --filter 1" "--mem-limit 1M" "--unique"; do
+    if "$EXECUTABLE_PATH" -t 4 $args "$TMP_DIR/input.tsv" > /dev/null 2>&1; then
+        echo "Test 3: Failed - --threads accepted with $args"
+        exit 1
+    fi
+done
+
+# --huge-pages: тот же вывод в один поток, отвергается там, где пула-арены нет
+"$EXECUTABLE_PATH" --huge-pages "$TMP_DIR/input.tsv" > "$TMP_DIR/actual.txt"
+if ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt"; then
+    echo "Test 3: Failed - output with --huge-pages differs"
+    exit 1
+fi
+for args in "-t 4" "--stream --filter 1" "--unique" "--where c2>0"; do
+    if "$EXECUTABLE_PATH" --huge-pages $args "$TMP_DIR/input.tsv" > /dev/null 2>&1; then
+        echo "Test 3: Failed - --huge-pages accepted with $args"
+        exit 1
+    fi
+done
+
+echo "Test 3: multithreaded output matches single-threaded output"
+exit 0
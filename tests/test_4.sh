@@ -0,0 +1,62 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+awk 'BEGIN { srand(7); for (i = 0; i < 100000; i++)
+    printf "%d.%d.%d.%d\t%d\t%d\n", int(rand()*64), int(rand()*256), int(rand()*256), int(rand()*256), i, i % 5 }' \
+    > "$TMP_DIR/input.tsv"
+
+# внешняя сортировка с маленьким бюджетом дает тот же отчет, что и в памяти
+"$EXECUTABLE_PATH" "$TMP_DIR/input.tsv" > "$TMP_DIR/expected.txt"
+"$EXECUTABLE_PATH" --mem-limit 256K --tmp-dir "$TMP_DIR" < "$TMP_DIR/input.tsv" > "$TMP_DIR/actual.txt"
+if ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt"; then
+    echo "Test 4: Failed - --mem-limit output differs from in-memory run"
+    exit 1
+fi
+
+# временные файлы удалены
+if [ -n "$(ls "$TMP_DIR" | grep ip_filter)" ]; then
+    echo "Test 4: Failed - temporary files left in $TMP_DIR"
+    exit 1
+fi
+
+# много прогонов при малом бюджете и 64 дескрипторах: слияние в несколько проходов
+awk 'BEGIN { srand(11); for (i = 0; i < 300000; i++)
+    printf "%d.%d.%d.%d\t%d\t%d\n", int(rand()*256), int(rand()*256), int(rand()*256), int(rand()*256), i, i % 5 }' \
+    > "$TMP_DIR/many_runs.tsv"
+"$EXECUTABLE_PATH" "$TMP_DIR/many_runs.tsv" > "$TMP_DIR/many_expected.txt"
+if ! (ulimit -n 64 && "$EXECUTABLE_PATH" --mem-limit 64K --tmp-dir "$TMP_DIR" "$TMP_DIR/many_runs.tsv" > "$TMP_DIR/many_actual.txt"); then
+    echo "Test 4: Failed - --mem-limit 64K with ulimit -n 64 exited with an error"
+    exit 1
+fi
+if ! cmp -s "$TMP_DIR/many_expected.txt" "$TMP_DIR/many_actual.txt"; then
+    echo "Test 4: Failed - multi-pass merge output differs from in-memory run"
+    exit 1
+fi
+
+# пользовательские фильтры: секции в порядке аргументов
+"$EXECUTABLE_PATH" --filter 46.70 --any 1 "$TMP_DIR/input.tsv" > "$TMP_DIR/filters.txt"
+"$EXECUTABLE_PATH" --filter 46.70 --any 1 --mem-limit 256K --tmp-dir "$TMP_DIR" "$TMP_DIR/input.tsv" > "$TMP_DIR/filters_ext.txt"
+if ! cmp -s "$TMP_DIR/filters.txt" "$TMP_DIR/filters_ext.txt"; then
+    echo "Test 4: Failed - filter sections differ between in-memory and external sort"
+    exit 1
+fi
+
+# потоковый режим: совпадения в порядке входа
+cut -f1 "$TMP_DIR/input.tsv" | grep -E '^46\.70\.' > "$TMP_DIR/stream_expected.txt"
+"$EXECUTABLE_PATH" --stream --filter 46.70 < "$TMP_DIR/input.tsv" > "$TMP_DIR/stream_actual.txt"
+if ! cmp -s "$TMP_DIR/stream_expected.txt" "$TMP_DIR/stream_actual.txt"; then
+    echo "Test 4: Failed - --stream output differs from input-order matches"
+    exit 1
+fi
+
+echo "Test 4: streaming and external sort tests passed"
+exit 0
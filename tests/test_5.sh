@@ -0,0 +1,64 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+awk 'BEGIN { srand(11); for (i = 0; i < 50000; i++)
+    printf "%d.%d.%d.%d\t%d\t%d\n", int(rand()*16), int(rand()*256), int(rand()*256), int(rand()*256), i, i % 5 }' \
+    > "$TMP_DIR/input.tsv"
+
+# --cidr и --range с границами по октетам совпадают с --filter
+"$EXECUTABLE_PATH" --filter 3.70 "$TMP_DIR/input.tsv" > "$TMP_DIR/expected.txt"
+"$EXECUTABLE_PATH" --cidr 3.70.0.0/16 "$TMP_DIR/input.tsv" > "$TMP_DIR/cidr.txt"
+"$EXECUTABLE_PATH" --range 3.70.0.0-3.70.255.255 "$TMP_DIR/input.tsv" > "$TMP_DIR/range.txt"
+if ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/cidr.txt" || ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/range.txt"; then
+    echo "Test 5: Failed - --cidr/--range output differs from --filter"
+    exit 1
+fi
+
+# блоклист: объединение сетей, повторы и пересечения не дублируют адреса
+cat > "$TMP_DIR/blocklist.txt" <<'LIST'
+# сети
+3.70.0.0/16
+3.70.128.0/17   # вложена в предыдущую
+5.0.0.0/8
+LIST
+"$EXECUTABLE_PATH" --filter 5 --filter 3.70 "$TMP_DIR/input.tsv" | sort -t. -k1,1nr -k2,2nr -k3,3nr -k4,4nr \
+    > "$TMP_DIR/block_expected.txt"
+"$EXECUTABLE_PATH" --blocklist "$TMP_DIR/blocklist.txt" "$TMP_DIR/input.tsv" > "$TMP_DIR/block_actual.txt"
+if ! cmp -s "$TMP_DIR/block_expected.txt" "$TMP_DIR/block_actual.txt"; then
+    echo "Test 5: Failed - --blocklist output differs from union of networks"
+    exit 1
+fi
+
+# тот же блоклист в потоковом режиме и при внешней сортировке
+"$EXECUTABLE_PATH" --blocklist "$TMP_DIR/blocklist.txt" --mem-limit 128K --tmp-dir "$TMP_DIR" \
+    "$TMP_DIR/input.tsv" > "$TMP_DIR/block_ext.txt"
+if ! cmp -s "$TMP_DIR/block_expected.txt" "$TMP_DIR/block_ext.txt"; then
+    echo "Test 5: Failed - --blocklist differs under external sort"
+    exit 1
+fi
+"$EXECUTABLE_PATH" --stream --blocklist "$TMP_DIR/blocklist.txt" < "$TMP_DIR/input.tsv" \
+    | sort -t. -k1,1nr -k2,2nr -k3,3nr -k4,4nr > "$TMP_DIR/block_stream.txt"
+if ! cmp -s "$TMP_DIR/block_expected.txt" "$TMP_DIR/block_stream.txt"; then
+    echo "Test 5: Failed - --blocklist differs in streaming mode"
+    exit 1
+fi
+
+# некорректная запись блоклиста - ошибка с номером строки
+printf '1.2.3.0/24\n1.2.3.4/24\n' > "$TMP_DIR/bad.txt"
+if "$EXECUTABLE_PATH" --blocklist "$TMP_DIR/bad.txt" "$TMP_DIR/input.tsv" > /dev/null 2> "$TMP_DIR/err.txt" \
+    || ! grep -q "строка 2" "$TMP_DIR/err.txt"; then
+    echo "Test 5: Failed - invalid blocklist entry not reported"
+    exit 1
+fi
+
+echo "Test 5: CIDR, range and blocklist tests passed"
+exit 0
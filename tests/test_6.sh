@@ -0,0 +1,62 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+awk 'BEGIN { srand(13); for (i = 0; i < 50000; i++)
+    printf "%d.%d.%d.%d\t%d\t%d\n", int(rand()*64), int(rand()*4), int(rand()*256), int(rand()*16), i, i % 5 }' \
+    > "$TMP_DIR/input.tsv"
+
+# отчет по снимку совпадает с отчетом по тексту
+"$EXECUTABLE_PATH" --save-index "$TMP_DIR/pool.snap" "$TMP_DIR/input.tsv" > "$TMP_DIR/expected.txt"
+"$EXECUTABLE_PATH" --load-index "$TMP_DIR/pool.snap" > "$TMP_DIR/actual.txt"
+if ! cmp -s "$TMP_DIR/expected.txt" "$TMP_DIR/actual.txt"; then
+    echo "Test 6: Failed - report from snapshot differs from text input"
+    exit 1
+fi
+
+# фильтры и --unique поверх снимка с повторами
+"$EXECUTABLE_PATH" --unique --filter 46.1 --any 3 "$TMP_DIR/input.tsv" > "$TMP_DIR/unique_expected.txt"
+"$EXECUTABLE_PATH" --unique --filter 46.1 --any 3 --load-index "$TMP_DIR/pool.snap" > "$TMP_DIR/unique_actual.txt"
+if ! cmp -s "$TMP_DIR/unique_expected.txt" "$TMP_DIR/unique_actual.txt"; then
+    echo "Test 6: Failed - --unique over snapshot differs"
+    exit 1
+fi
+
+# счетчики сохраняются в снимок --count
+"$EXECUTABLE_PATH" --count --save-index "$TMP_DIR/counts.snap" --index-postings "$TMP_DIR/input.tsv" > "$TMP_DIR/count_expected.txt"
+"$EXECUTABLE_PATH" --count --load-index "$TMP_DIR/counts.snap" > "$TMP_DIR/count_actual.txt"
+if ! cmp -s "$TMP_DIR/count_expected.txt" "$TMP_DIR/count_actual.txt"; then
+    echo "Test 6: Failed - --count over snapshot differs"
+    exit 1
+fi
+
+# any N по сохраненным спискам строк - те же строки, что и проход по пулу
+"$EXECUTABLE_PATH" --unique --any 3 --filter 46 --any 200 "$TMP_DIR/input.tsv" > "$TMP_DIR/any_expected.txt"
+"$EXECUTABLE_PATH" --any 3 --filter 46 --any 200 --load-index "$TMP_DIR/counts.snap" > "$TMP_DIR/any_actual.txt"
+if ! cmp -s "$TMP_DIR/any_expected.txt" "$TMP_DIR/any_actual.txt"; then
+    echo "Test 6: Failed - any N over snapshot postings differs"
+    exit 1
+fi
+if "$EXECUTABLE_PATH" --count --load-index "$TMP_DIR/pool.snap" > /dev/null 2>&1; then
+    echo "Test 6: Failed - --count accepted a snapshot without counts"
+    exit 1
+fi
+
+# поврежденный снимок отвергается
+cp "$TMP_DIR/pool.snap" "$TMP_DIR/bad.snap"
+printf '\xff' | dd of="$TMP_DIR/bad.snap" bs=1 seek=1000 conv=notrunc 2> /dev/null
+if "$EXECUTABLE_PATH" --load-index "$TMP_DIR/bad.snap" > /dev/null 2>&1; then
+    echo "Test 6: Failed - corrupted snapshot accepted"
+    exit 1
+fi
+
+echo "Test 6: snapshot tests passed"
+exit 0
@@ -0,0 +1,58 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+awk 'BEGIN { srand(17); for (i = 0; i < 30000; i++)
+    printf "%d.%d.%d.%d\t%d\t%d\n", int(rand()*8), int(rand()*4), int(rand()*4), int(rand()*8), int(rand()*3000), i % 5 }' \
+    > "$TMP_DIR/input.tsv"
+
+SORT_IP="sort -t. -k1,1nr -k2,2nr -k3,3nr -k4,4nr"
+
+# --where: те же строки, что отбирает awk, в порядке пула
+awk -F'\t' '$2 > 1000 && $3 != 0 { print $1 }' "$TMP_DIR/input.tsv" | $SORT_IP > "$TMP_DIR/where_expected.txt"
+"$EXECUTABLE_PATH" --where 'c2>1000' --where 'c3!=0' --filter 0 --filter 1 --filter 2 --filter 3 \
+    --filter 4 --filter 5 --filter 6 --filter 7 "$TMP_DIR/input.tsv" | $SORT_IP > "$TMP_DIR/where_actual.txt"
+if ! cmp -s "$TMP_DIR/where_expected.txt" "$TMP_DIR/where_actual.txt"; then
+    echo "Test 7: Failed - --where selects different rows than awk"
+    exit 1
+fi
+
+# --sum: число строк и сумма столбца по адресу
+awk -F'\t' '{ n[$1]++; s[$1] += $2 } END { for (ip in n) printf "%s\t%d\t%d\n", ip, n[ip], s[ip] }' \
+    "$TMP_DIR/input.tsv" | sort > "$TMP_DIR/sum_expected.txt"
+"$EXECUTABLE_PATH" --sum c2 --filter 0 --filter 1 --filter 2 --filter 3 --filter 4 --filter 5 --filter 6 \
+    --filter 7 "$TMP_DIR/input.tsv" | sort > "$TMP_DIR/sum_actual.txt"
+if ! cmp -s "$TMP_DIR/sum_expected.txt" "$TMP_DIR/sum_actual.txt"; then
+    echo "Test 7: Failed - --sum totals differ from awk"
+    exit 1
+fi
+
+# без условий на столбцы вывод прежний
+"$EXECUTABLE_PATH" "$TMP_DIR/input.tsv" > "$TMP_DIR/plain.txt"
+"$EXECUTABLE_PATH" --where 'c2>=0' "$TMP_DIR/input.tsv" > "$TMP_DIR/where_all.txt"
+if ! cmp -s "$TMP_DIR/plain.txt" "$TMP_DIR/where_all.txt"; then
+    echo "Test 7: Failed - always-true --where changes the report"
+    exit 1
+fi
+
+# --threads со столбцами отвергается, переполнение суммы - ошибка
+if "$EXECUTABLE_PATH" -t 4 --where 'c2>=0' "$TMP_DIR/input.tsv" > /dev/null 2>&1; then
+    echo "Test 7: Failed - --threads accepted with --where"
+    exit 1
+fi
+printf '1.1.1.1\t9223372036854775807\t1\n1.1.1.1\t1\t1\n' > "$TMP_DIR/huge.tsv"
+if "$EXECUTABLE_PATH" --sum c2 "$TMP_DIR/huge.tsv" > /dev/null 2>&1; then
+    echo "Test 7: Failed - --sum overflow accepted"
+    exit 1
+fi
+
+echo "Test 7: column filter and aggregation tests passed"
+exit 0
@@ -0,0 +1,72 @@
+#!/bin/bash
+
+EXECUTABLE_PATH=$1
+
+if [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+awk 'BEGIN { srand(23); for (i = 0; i < 20000; i++)
+    printf "%d.%d.%d.%d\t%d\t0\n", int(rand()*256), int(rand()*256), int(rand()*256), int(rand()*256), i }' \
+    > "$TMP_DIR/v4.tsv"
+printf '2001:db8::1\t1\t0\n0100::5\t6\t0\nfe80::2e:1\t2\t0\n2001:db8:0:1:0:0:0:2\t3\t0\n::ffff:10.0.0.1\t4\t0\n::ffff:1.2.3.4\t7\t0\n::1\t5\t0\n' \
+    > "$TMP_DIR/v6.tsv"
+cat "$TMP_DIR/v4.tsv" "$TMP_DIR/v6.tsv" "$TMP_DIR/v4.tsv" > "$TMP_DIR/mixed.tsv"
+
+# секции IPv4 не меняются от добавления IPv6 (кроме удвоения строк)
+cat "$TMP_DIR/v4.tsv" "$TMP_DIR/v4.tsv" > "$TMP_DIR/v4x2.tsv"
+"$EXECUTABLE_PATH" "$TMP_DIR/v4x2.tsv" > "$TMP_DIR/v4_report.txt"
+"$EXECUTABLE_PATH" "$TMP_DIR/mixed.tsv" | grep -v ':' > "$TMP_DIR/mixed_v4.txt"
+if ! cmp -s "$TMP_DIR/v4_report.txt" "$TMP_DIR/mixed_v4.txt"; then
+    echo "Test 8: Failed - IPv4 part of the report changed"
+    exit 1
+fi
+
+# адреса IPv6: канонический вид, по убыванию, после IPv4 в каждой секции;
+# фильтры IPv4 (1, 46.70, 46) видят только отображенный ::ffff:1.2.3.4
+"$EXECUTABLE_PATH" "$TMP_DIR/mixed.tsv" | grep ':' > "$TMP_DIR/mixed_v6.txt"
+cat > "$TMP_DIR/v6_expected.txt" <<'END'
+fe80::2e:1
+2001:db8:0:1::2
+2001:db8::1
+100::5
+::ffff:10.0.0.1
+::ffff:1.2.3.4
+::1
+::ffff:1.2.3.4
+END
+if ! cmp -s "$TMP_DIR/v6_expected.txt" "$TMP_DIR/mixed_v6.txt"; then
+    echo "Test 8: Failed - unexpected IPv6 lines"
+    diff "$TMP_DIR/v6_expected.txt" "$TMP_DIR/mixed_v6.txt"
+    exit 1
+fi
+
+# ':' вне первого столбца - обычный журнал IPv4: работают -t и --save-index
+awk -F'\t' '{ print $1 "\t12:30:00\t" $3 }' "$TMP_DIR/v4.tsv" > "$TMP_DIR/v4_time.tsv"
+"$EXECUTABLE_PATH" "$TMP_DIR/v4.tsv" > "$TMP_DIR/v4_plain.txt"
+if ! "$EXECUTABLE_PATH" -t 4 --save-index "$TMP_DIR/v4.snap" "$TMP_DIR/v4_time.tsv" > "$TMP_DIR/v4_time.txt" \
+    || ! cmp -s "$TMP_DIR/v4_plain.txt" "$TMP_DIR/v4_time.txt" || [ ! -s "$TMP_DIR/v4.snap" ]; then
+    echo "Test 8: Failed - ':' in a data column switched to IPv6 mode"
+    exit 1
+fi
+
+# журнал с IPv6: снимок и потоки не поддерживаются - ошибка, а не молчаливый пропуск
+for args in "--save-index $TMP_DIR/mixed.snap" "-t 4"; do
+    if "$EXECUTABLE_PATH" $args "$TMP_DIR/mixed.tsv" > /dev/null 2>&1; then
+        echo "Test 8: Failed - '$args' accepted for an IPv6 log"
+        exit 1
+    fi
+done
+
+# некорректный адрес IPv6 - ошибка
+if printf '1::2::3\t1\t1\n' | "$EXECUTABLE_PATH" > /dev/null 2>&1; then
+    echo "Test 8: Failed - invalid IPv6 address accepted"
+    exit 1
+fi
+
+echo "Test 8: IPv6 tests passed"
+exit 0
@@ -0,0 +1,50 @@
+#!/bin/bash
+
+DATAGEN_PATH=$1
+EXECUTABLE_PATH=$2
+
+if [ -z "$DATAGEN_PATH" ] || [ -z "$EXECUTABLE_PATH" ]; then
+    echo "Usage: $0 <path_to_datagen> <path_to_executable>"
+    exit 1
+fi
+
+TMP_DIR=$(mktemp -d)
+trap 'rm -rf "$TMP_DIR"' EXIT
+
+# одинаковые параметры - одинаковый файл, другое зерно - другой
+"$DATAGEN_PATH" --rows 50K --seed 5 --dist zipf -o "$TMP_DIR/a.tsv"
+"$DATAGEN_PATH" --rows 50K --seed 5 --dist zipf > "$TMP_DIR/b.tsv"
+"$DATAGEN_PATH" --rows 50K --seed 6 --dist zipf -o "$TMP_DIR/c.tsv"
+if ! cmp -s "$TMP_DIR/a.tsv" "$TMP_DIR/b.tsv" || cmp -s "$TMP_DIR/a.tsv" "$TMP_DIR/c.tsv"; then
+    echo "Test 9: Failed - generator output is not determined by the seed"
+    exit 1
+fi
+
+if [ "$(wc -l < "$TMP_DIR/a.tsv")" -ne 50000 ]; then
+    echo "Test 9: Failed - wrong row count"
+    exit 1
+fi
+
+# доля повторов: различных адресов примерно (1 - rate) * rows
+for dist in uniform clustered; do
+    "$DATAGEN_PATH" --rows 100K --dup-rate 0.75 --dist $dist -o "$TMP_DIR/$dist.tsv"
+    distinct=$(cut -f1 "$TMP_DIR/$dist.tsv" | sort -u | wc -l)
+    if [ "$distinct" -lt 23000 ] || [ "$distinct" -gt 27000 ]; then
+        echo "Test 9: Failed - $dist: $distinct distinct addresses, expected about 25000"
+        exit 1
+    fi
+done
+
+# журнал читается ip_filter, в clustered есть совпадения для 46.70
+if ! "$EXECUTABLE_PATH" --filter 46.70 "$TMP_DIR/clustered.tsv" | grep -q '^46\.70\.'; then
+    echo "Test 9: Failed - clustered data has no 46.70 rows"
+    exit 1
+fi
+
+if "$DATAGEN_PATH" --dup-rate 1.5 > /dev/null 2>&1; then
+    echo "Test 9: Failed - invalid duplicate rate accepted"
+    exit 1
+fi
+
+echo "Test 9: data generator tests passed"
+exit 0